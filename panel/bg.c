@@ -22,8 +22,8 @@
  * -----------------
  * bg->cache          — owned by FbBg; destroyed in fb_bg_changed() and
  *                      fb_bg_finalize().
- * slices returned by fb_bg_get_xroot_pix_for_win/area — (transfer full) to
- * caller; caller must cairo_surface_destroy() them.
+ * slices returned by fb_bg_get_xroot_pix_for_win/area/scaled — (transfer
+ * full) to caller; caller must cairo_surface_destroy() them.
  *
  * See also: docs/MEMORY_MODEL.md §3.
  */
@@ -417,6 +417,50 @@ fb_bg_get_xroot_pix_for_area(FbBg *bg, gint x, gint y, gint width, gint height)
     return gbgpix;  /* (transfer full) to caller */
 }
 
+/**
+ * fb_bg_get_xroot_pix_scaled - scale an area of the cached root pixmap.
+ * @bg:     FbBg instance.
+ * @x:      Root-window X of the top-left corner.
+ * @y:      Root-window Y of the top-left corner.
+ * @width:  Area width in pixels.
+ * @height: Area height in pixels.
+ * @dest_w: Width of the result.
+ * @dest_h: Height of the result.
+ *
+ * Returns: (transfer full) new cairo_image_surface_t (CAIRO_FORMAT_RGB24)
+ *   of @dest_w x @dest_h, or NULL if no root pixmap is available or a size
+ *   is not positive.  Caller must cairo_surface_destroy() the returned surface.
+ */
+cairo_surface_t *
+fb_bg_get_xroot_pix_scaled(FbBg *bg, gint x, gint y, gint width, gint height,
+    gint dest_w, gint dest_h)
+{
+    cairo_surface_t *gbgpix;
+    cairo_t *cr;
+
+    if (width <= 0 || height <= 0 || dest_w <= 0 || dest_h <= 0)
+        return NULL;
+    if (!fb_bg_ensure_cache(bg))
+        return NULL;
+
+    gbgpix = cairo_image_surface_create(CAIRO_FORMAT_RGB24, dest_w, dest_h);
+    if (cairo_surface_status(gbgpix) != CAIRO_STATUS_SUCCESS) {
+        ERR("cairo_image_surface_create failed\n");
+        cairo_surface_destroy(gbgpix);
+        return NULL;
+    }
+
+    cr = cairo_create(gbgpix);
+    cairo_scale(cr, (double) dest_w / width, (double) dest_h / height);
+    cairo_set_source_surface(cr, bg->cache, -x, -y);
+    /* GOOD box-filters reductions; BILINEAR would sample 4 pixels only */
+    cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_GOOD);
+    cairo_paint(cr);
+    cairo_destroy(cr);
+    DBG("%dx%d%+d%+d -> %dx%d\n", width, height, x, y, dest_w, dest_h);
+    return gbgpix;  /* (transfer full) to caller */
+}
+
 /**
  * fb_bg_get_xroot_pix_for_win - crop a background slice matching @widget's area.
  * @bg:     FbBg instance.
@@ -518,6 +562,19 @@ void fb_bg_notify_changed_bg(FbBg *bg)
     return;
 }
 
+/**
+ * fb_bg_notify_changed_default - emit "changed" on default_bg, if any.
+ *
+ * Takes no reference: with no holders there is no singleton and no one to
+ * notify, and creating one here would only fill a cache nobody reads.
+ */
+void fb_bg_notify_changed_default(void)
+{
+    if (default_bg)
+        fb_bg_notify_changed_bg(default_bg);
+    return;
+}
+
 /**
  * fb_bg_get_for_display - obtain the FbBg singleton for the default display.
  *
@@ -17,13 +17,16 @@
  * --------------------------------
  * When the wallpaper changes, call fb_bg_notify_changed_bg().  This
  * emits the "changed" GObject signal, which connected GtkBgbox widgets
- * use to refresh their cached background slices.
+ * use to refresh their cached background slices.  The panel's root window
+ * filter uses fb_bg_notify_changed_default(), which reaches the singleton
+ * whenever anyone (a transparent panel, the pager) holds it.
  *
  * SURFACE OWNERSHIP
  * -----------------
  * fb_bg_get_xroot_pix_for_win()  → (transfer full) caller owns the surface;
- * fb_bg_get_xroot_pix_for_area() → (transfer full) caller owns the surface.
- * Both return cairo_image_surface_t (CPU-side, not tied to an X drawable).
+ * fb_bg_get_xroot_pix_for_area() → (transfer full) caller owns the surface;
+ * fb_bg_get_xroot_pix_scaled()   → (transfer full) caller owns the surface.
+ * All three return cairo_image_surface_t (CPU-side, not tied to an X drawable).
  * The caller must call cairo_surface_destroy() when done.
  *
  * See also: docs/MEMORY_MODEL.md §3 (cairo surface lifecycle).
@@ -142,6 +145,27 @@ cairo_surface_t  *fb_bg_get_xroot_pix_for_win(FbBg *bg, GtkWidget *widget);
  */
 cairo_surface_t  *fb_bg_get_xroot_pix_for_area(FbBg *bg, gint x, gint y, gint width, gint height);
 
+/**
+ * fb_bg_get_xroot_pix_scaled - get a background area scaled to a given size.
+ * @bg:     FbBg instance (must not be NULL).
+ * @x:      Root-window X coordinate of the top-left corner.
+ * @y:      Root-window Y coordinate of the top-left corner.
+ * @width:  Width of the area in pixels.
+ * @height: Height of the area in pixels.
+ * @dest_w: Width of the returned surface.
+ * @dest_h: Height of the returned surface.
+ *
+ * Scales from the cached root pixmap with CAIRO_FILTER_GOOD, so large
+ * reductions are box-filtered instead of aliased.  Meant for thumbnails
+ * (the pager); the full-size area is never copied.
+ *
+ * Returns: (transfer full) new cairo_image_surface_t (CAIRO_FORMAT_RGB24)
+ *   of @dest_w x @dest_h, or NULL if no root pixmap is set or a size is
+ *   not positive.  Caller must cairo_surface_destroy() the returned surface.
+ */
+cairo_surface_t  *fb_bg_get_xroot_pix_scaled(FbBg *bg, gint x, gint y,
+                      gint width, gint height, gint dest_w, gint dest_h);
+
 /**
  * fb_bg_get_xrootpmap - return the cached X11 root Pixmap ID.
  * @bg: FbBg instance.
@@ -162,6 +186,15 @@ Pixmap            fb_bg_get_xrootpmap        (FbBg *bg);
  */
 void              fb_bg_notify_changed_bg    (FbBg *bg);
 
+/**
+ * fb_bg_notify_changed_default - emit "changed" on the singleton, if alive.
+ *
+ * For the _XROOTPMAP_ID PropertyNotify handler: the singleton exists only
+ * while someone holds a reference (a transparent panel, the pager with
+ * wallpaper enabled), and nothing needs to be told otherwise.
+ */
+void              fb_bg_notify_changed_default(void);
+
 /**
  * fb_bg_get_for_display - obtain the FbBg singleton for the default display.
  *
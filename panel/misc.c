@@ -282,22 +282,27 @@ void resolve_atoms()
  *
  * Must be called once after gtk_init() and before any X11 or icon operations.
  * Sets the global icon_theme to gtk_icon_theme_get_default() (borrowed ref —
- * do NOT g_object_unref; see fb_free).
+ * do NOT g_object_unref; see fb_free) and creates the pixbuf cache, so its
+ * icon-theme handler runs before any plugin's.
  */
 void fb_init()
 {
     resolve_atoms();
     icon_theme = gtk_icon_theme_get_default();
+    fb_pixbuf_cache_init();
 }
 
 /**
- * fb_free - no-op cleanup for fbpanel globals.
+ * fb_free - release fbpanel globals.
  *
- * icon_theme is a borrowed reference from gtk_icon_theme_get_default() and
- * must NOT be g_object_unref()'d.  Atoms are server-side and need no cleanup.
+ * Empties the pixbuf and window icon caches.  icon_theme is a borrowed
+ * reference from gtk_icon_theme_get_default() and must NOT be
+ * g_object_unref()'d.  Atoms are server-side and need no cleanup.
  */
 void fb_free()
 {
+    fb_pixbuf_cache_free();
+    wmicon_cache_free();
     // MUST NOT be ref'd or unref'd
     // g_object_unref(icon_theme);
 }
@@ -168,17 +168,19 @@ char **get_utf8_property_list(Window win, Atom atom, int *count);
  * fb_init - initialise fbpanel's X11 atoms and icon theme.
  *
  * Interns all a_NET_xxx, a_WM_xxx, a_UTF8_STRING, a_XROOTPMAP_ID atoms via
- * XInternAtom, and caches the default GtkIconTheme* as the global
- * icon_theme.  Must be called once after gtk_init() and before any
- * X11 property query or icon load.
+ * XInternAtom, caches the default GtkIconTheme* as the global
+ * icon_theme and creates the shared pixbuf cache (widgets.h).  Must be
+ * called once after gtk_init() and before any X11 property query or icon
+ * load.
  */
 void fb_init(void);
 
 /**
  * fb_free - release fbpanel's global X11 resources.
  *
- * Currently a no-op: icon_theme is a borrowed reference to the default
- * theme singleton (gtk_icon_theme_get_default) and must NOT be unref'd.
+ * Empties the shared pixbuf and window icon caches.  icon_theme is a
+ * borrowed reference to the default theme singleton
+ * (gtk_icon_theme_get_default) and must NOT be unref'd.
  * Atoms are interned for the lifetime of the X server connection.
  */
 void fb_free(void);
@@ -300,6 +302,8 @@ guint32 gcolor2rgb24(GdkRGBA *color);
 gchar *gdk_color_to_RRGGBB(GdkRGBA *color);
 
 #include "widgets.h"
+#include "wmicon.h"
+#include "winthumb.h"
 
 
 /**
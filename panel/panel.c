@@ -42,7 +42,7 @@
  * It receives all PropertyNotify events on the root window and:
  *   - translates EWMH property changes to FbEv signals (fb_ev_trigger)
  *   - updates p->curdesk / p->desknum caches
- *   - calls fb_bg_notify_changed_bg() when _XROOTPMAP_ID changes
+ *   - calls fb_bg_notify_changed_default() when _XROOTPMAP_ID changes
  *   - calls gtk_main_quit() when _NET_DESKTOP_GEOMETRY changes (triggers restart)
  *
  * AUTOHIDE STATE MACHINE
@@ -242,7 +242,7 @@ panel_set_wm_strut(panel *p)
  *   _NET_DESKTOP_NAMES          -> trigger EV_DESKTOP_NAMES
  *   _NET_ACTIVE_WINDOW          -> trigger EV_ACTIVE_WINDOW
  *   _NET_CLIENT_LIST_STACKING   -> trigger EV_CLIENT_LIST_STACKING
- *   _XROOTPMAP_ID               -> notify FbBg of wallpaper change (if transparent)
+ *   _XROOTPMAP_ID               -> notify FbBg of wallpaper change (if anyone holds it)
  *   _NET_DESKTOP_GEOMETRY       -> call gtk_main_quit() to restart panel (screen resize)
  *
  * Non-root PropertyNotify events and all other event types return GDK_FILTER_CONTINUE.
@@ -291,8 +291,7 @@ panel_event_filter(GdkXEvent *xevent, GdkEvent *event, panel *p)
             //      XA_CARDINAL, &p->wa_len);
             //print_wmdata(p);
         } else if (at == a_XROOTPMAP_ID) {
-            if (p->transparent)
-                fb_bg_notify_changed_bg(p->bg);
+            fb_bg_notify_changed_default();
         } else if (at == a_NET_DESKTOP_GEOMETRY) {
             DBG("a_NET_DESKTOP_GEOMETRY\n");
             gtk_main_quit();
@@ -15,12 +15,27 @@
  * PIXBUF TRIPLE LIFETIME
  * ----------------------
  * pix[0] — normal; created in fb_image_new() and refreshed on icon-theme change.
- * pix[1] — highlight; created lazily by fb_button_new(); NULL for plain fb_images.
- * pix[2] — press; created lazily by fb_button_new(); NULL for plain fb_images.
- *
- * On icon-theme change (fb_image_icon_theme_changed), pix[0] is always rebuilt.
- * pix[1] and pix[2] are only rebuilt when conf->hicolor != 0 (button mode);
- * plain images (hicolor==0) skip the highlight/press rebuild.
+ * pix[1] — highlight; built by fb_image_get_pix() on the first enter-notify.
+ * pix[2] — press; built by fb_image_get_pix() on the first button press.
+ *
+ * Most launcher buttons are never hovered, so only pix[0] is paid for up
+ * front.  On icon-theme change (fb_image_icon_theme_changed) pix[0] is
+ * reloaded and pix[1]/pix[2] are dropped, to be rebuilt on next use.  Plain
+ * images have no crossing/press handlers and never get variants.
+ *
+ * PIXBUF CACHE
+ * ------------
+ * Every pixbuf produced here goes through one process-wide LRU cache keyed
+ * by (icon name + file path, width, height, variant), where the variant
+ * encodes the fallback flag and, for button images, the highlight/press
+ * kind and hicolor.  Plugins loading the same icon at the same size —
+ * launchbar and menu buttons, meters, icons, the default.xpm fallback of
+ * taskbar and pager — share one immutable GdkPixbuf instead of each
+ * rasterising its own.  The cache holds one reference per entry and evicts
+ * least-recently-used entries beyond PIXBUF_CACHE_MAX bytes (users keep
+ * their own references).  Its GtkIconTheme::changed handler is connected
+ * in fb_init(), before any plugin's, and drops every theme-dependent entry,
+ * so the per-image reloads that follow hit the theme once per icon.
  *
  * BUTTON EVENT ROUTING
  * --------------------
@@ -32,6 +47,11 @@
  */
 
 #include <gtk/gtk.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 #include "panel.h"
 #include "misc.h"
@@ -48,24 +68,219 @@
 /** Maximum pixbuf size in either dimension (clamped in fb_pixbuf_new). */
 #define MAX_SIZE 192
 
+/** Cache budget: sum of rowstride * height over cached pixbufs. */
+#define PIXBUF_CACHE_MAX (4 << 20)
+
 /**
- * fb_pixbuf_new - load a GdkPixbuf from an icon name and/or a file path.
- * @iname:        Icon name for gtk_icon_theme_load_icon(); may be NULL.
- * @fname:        File path for gdk_pixbuf_new_from_file_at_size(); may be NULL.
- * @width:        Desired width; used as the size hint for icon lookup.
- * @height:       Desired height; used when loading from a file.
- * @use_fallback: If TRUE and both sources fail, load "gtk-missing-image".
+ * PIX_VARIANT - cache variant of an fb_pixbuf_new() result.
+ * @kind:     0 normal, 1 highlight, 2 press (fb_image_conf_t::pix index).
+ * @hicolor:  highlight colour (0 for normal images).
+ * @fallback: use_fallback flag of the load.
+ */
+#define PIX_VARIANT(kind, hicolor, fallback) \
+    ((gulong) (hicolor) << 8 | (kind) << 1 | ((fallback) ? 1 : 0))
+
+/**
+ * fb_pixbuf_entry - one cached pixbuf.
+ * @key:    "name\037WxH\037variant"; also the hash table key.
+ * @pb:     the cached pixbuf; the cache owns one reference.
+ * @bytes:  rowstride * height of @pb, charged to pixbuf_cache_bytes.
+ * @themed: TRUE if the pixbuf depends on the icon theme.
+ * @link:   embedded node of pixbuf_lru (head = most recently used).
+ */
+typedef struct {
+    gchar *key;
+    GdkPixbuf *pb;
+    gsize bytes;
+    gboolean themed;
+    GList link;
+} fb_pixbuf_entry;
+
+static GHashTable *pixbuf_cache;        /* key -> fb_pixbuf_entry */
+static GQueue pixbuf_lru = G_QUEUE_INIT;
+static gsize pixbuf_cache_bytes;
+static gulong pixbuf_cache_itc_id;
+
+/**
+ * fb_pixbuf_entry_free - hash table value destructor.
+ * @data: fb_pixbuf_entry. (transfer full)
  *
- * Tries sources in order: icon name → file path → fallback.
- * The size passed to icon_theme is clamped to MIN(192, MAX(width, height)) so
- * the theme never has to produce an excessively large icon.
- * GTK_ICON_LOOKUP_FORCE_SIZE ensures the theme scales to exactly that size.
+ * Unlinks the entry from the LRU queue, uncharges its bytes and drops the
+ * cache's pixbuf reference.
+ */
+static void
+fb_pixbuf_entry_free(gpointer data)
+{
+    fb_pixbuf_entry *e = data;
+
+    g_queue_unlink(&pixbuf_lru, &e->link);
+    pixbuf_cache_bytes -= e->bytes;
+    g_object_unref(G_OBJECT(e->pb));
+    g_free(e->key);
+    g_free(e);
+}
+
+static gboolean
+fb_pixbuf_entry_themed(gpointer key, gpointer value, gpointer data)
+{
+    return ((fb_pixbuf_entry *) value)->themed;
+}
+
+/**
+ * fb_pixbuf_cache_theme_changed - GtkIconTheme::changed handler.
  *
- * Returns: (transfer full) GdkPixbuf*, or NULL if all sources failed.
- *          Caller must g_object_unref() the result when done.
+ * Drops all theme-dependent entries; file and XPM pixbufs stay cached.
+ */
+static void
+fb_pixbuf_cache_theme_changed(GtkIconTheme *theme, gpointer data)
+{
+    DBG("dropping themed pixbufs\n");
+    g_hash_table_foreach_remove(pixbuf_cache, fb_pixbuf_entry_themed, NULL);
+}
+
+/**
+ * fb_pixbuf_cache_init - create the pixbuf cache (idempotent).
+ *
+ * Called from fb_init() so that the cache's icon-theme handler runs before
+ * any plugin's.
+ */
+void
+fb_pixbuf_cache_init(void)
+{
+    if (pixbuf_cache)
+        return;
+    pixbuf_cache = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+        fb_pixbuf_entry_free);
+    pixbuf_cache_itc_id = g_signal_connect(G_OBJECT(icon_theme), "changed",
+        G_CALLBACK(fb_pixbuf_cache_theme_changed), NULL);
+}
+
+/**
+ * fb_pixbuf_cache_free - drop every entry and the icon-theme handler.
+ */
+void
+fb_pixbuf_cache_free(void)
+{
+    if (!pixbuf_cache)
+        return;
+    g_signal_handler_disconnect(G_OBJECT(icon_theme), pixbuf_cache_itc_id);
+    g_hash_table_destroy(pixbuf_cache);
+    pixbuf_cache = NULL;
+}
+
+static gchar *
+fb_pixbuf_cache_key(const gchar *name, int width, int height, gulong variant)
+{
+    return g_strdup_printf("%s\037%dx%d\037%lx", name, width, height, variant);
+}
+
+/**
+ * fb_pixbuf_cache_lookup - find a cached pixbuf and mark it recently used.
+ * @name:    source identifier (icon name, file path, ...). (transfer none)
+ * @width:   requested width.
+ * @height:  requested height.
+ * @variant: caller-defined variant (0 for a plain load).
+ *
+ * Returns: (transfer full) a new reference to the shared pixbuf, or NULL.
  */
 GdkPixbuf *
-fb_pixbuf_new(gchar *iname, gchar *fname, int width, int height,
+fb_pixbuf_cache_lookup(const gchar *name, int width, int height,
+        gulong variant)
+{
+    fb_pixbuf_entry *e;
+    gchar *key;
+
+    fb_pixbuf_cache_init();
+    key = fb_pixbuf_cache_key(name, width, height, variant);
+    e = g_hash_table_lookup(pixbuf_cache, key);
+    g_free(key);
+    if (!e)
+        return NULL;
+    g_queue_unlink(&pixbuf_lru, &e->link);
+    g_queue_push_head_link(&pixbuf_lru, &e->link);
+    g_object_ref(G_OBJECT(e->pb));
+    return e->pb;
+}
+
+/**
+ * fb_pixbuf_cache_insert - add a pixbuf to the cache.
+ * @name, @width, @height, @variant: key, as for fb_pixbuf_cache_lookup().
+ * @themed: TRUE to drop the entry when the icon theme changes.
+ * @pb:     pixbuf to share; NULL is ignored. (transfer none; the cache takes
+ *          its own reference, and @pb must not be modified afterwards)
+ *
+ * Replaces an existing entry with the same key, then evicts from the LRU
+ * tail until the cache fits PIXBUF_CACHE_MAX (the newest entry always
+ * stays).
+ */
+void
+fb_pixbuf_cache_insert(const gchar *name, int width, int height,
+        gulong variant, gboolean themed, GdkPixbuf *pb)
+{
+    fb_pixbuf_entry *e;
+
+    if (!pb)
+        return;
+    fb_pixbuf_cache_init();
+    e = g_new0(fb_pixbuf_entry, 1);
+    e->key = fb_pixbuf_cache_key(name, width, height, variant);
+    e->pb = pb;
+    g_object_ref(G_OBJECT(pb));
+    e->bytes = (gsize) gdk_pixbuf_get_rowstride(pb) * gdk_pixbuf_get_height(pb);
+    e->themed = themed;
+    e->link.data = e;
+    /* replace, not insert: the old entry owns (and frees) the old key */
+    g_hash_table_replace(pixbuf_cache, e->key, e);
+    g_queue_push_head_link(&pixbuf_lru, &e->link);
+    pixbuf_cache_bytes += e->bytes;
+    while (pixbuf_cache_bytes > PIXBUF_CACHE_MAX && pixbuf_lru.length > 1)
+        g_hash_table_remove(pixbuf_cache,
+            ((fb_pixbuf_entry *) pixbuf_lru.tail->data)->key);
+    DBG("%s: %d entries, %lu bytes\n", e->key, pixbuf_lru.length,
+        (gulong) pixbuf_cache_bytes);
+}
+
+/**
+ * fb_pixbuf_name - cache name of an (icon name, file path) pair.
+ *
+ * Returns: (transfer full) string; g_free() it.
+ */
+static gchar *
+fb_pixbuf_name(const gchar *iname, const gchar *fname)
+{
+    return g_strdup_printf("%s\037%s", iname ? iname : "", fname ? fname : "");
+}
+
+/**
+ * fb_pixbuf_new_from_xpm - shared pixbuf decoded from compiled-in XPM data.
+ * @name: identifier of the image, e.g. "default.xpm". (transfer none)
+ * @data: XPM data; only decoded on a cache miss. (transfer none)
+ *
+ * Returns: (transfer full) GdkPixbuf*, shared and immutable; caller must
+ *          g_object_unref() it.
+ */
+GdkPixbuf *
+fb_pixbuf_new_from_xpm(const gchar *name, const char **data)
+{
+    GdkPixbuf *pb;
+    gchar *xname;
+
+    xname = g_strconcat("xpm:", name, NULL);
+    if (!(pb = fb_pixbuf_cache_lookup(xname, 0, 0, 0))) {
+        pb = gdk_pixbuf_new_from_xpm_data(data);
+        fb_pixbuf_cache_insert(xname, 0, 0, 0, FALSE, pb);
+    }
+    g_free(xname);
+    return pb;
+}
+
+/**
+ * fb_pixbuf_load - load a GdkPixbuf from an icon name and/or a file path.
+ *
+ * Uncached worker of fb_pixbuf_new(); same arguments and result.
+ */
+static GdkPixbuf *
+fb_pixbuf_load(gchar *iname, gchar *fname, int width, int height,
         gboolean use_fallback)
 {
     GdkPixbuf *pb = NULL;
@@ -83,6 +298,99 @@ fb_pixbuf_new(gchar *iname, gchar *fname, int width, int height,
     return pb;
 }
 
+/**
+ * fb_pixbuf_new - load a GdkPixbuf from an icon name and/or a file path.
+ * @iname:        Icon name for gtk_icon_theme_load_icon(); may be NULL.
+ * @fname:        File path for gdk_pixbuf_new_from_file_at_size(); may be NULL.
+ * @width:        Desired width; used as the size hint for icon lookup.
+ * @height:       Desired height; used when loading from a file.
+ * @use_fallback: If TRUE and both sources fail, load "gtk-missing-image".
+ *
+ * Tries sources in order: icon name → file path → fallback.
+ * The size passed to icon_theme is clamped to MIN(192, MAX(width, height)) so
+ * the theme never has to produce an excessively large icon.
+ * GTK_ICON_LOOKUP_FORCE_SIZE ensures the theme scales to exactly that size.
+ *
+ * Results are shared through the pixbuf cache; a failed load is not cached
+ * and is retried on the next call.
+ *
+ * Returns: (transfer full) GdkPixbuf*, or NULL if all sources failed.
+ *          The pixbuf is shared and must not be modified; caller must
+ *          g_object_unref() the result when done.
+ */
+GdkPixbuf *
+fb_pixbuf_new(gchar *iname, gchar *fname, int width, int height,
+        gboolean use_fallback)
+{
+    GdkPixbuf *pb;
+    gchar *name;
+    gulong variant = PIX_VARIANT(0, 0, use_fallback);
+
+    name = fb_pixbuf_name(iname, fname);
+    if (!(pb = fb_pixbuf_cache_lookup(name, width, height, variant))) {
+        pb = fb_pixbuf_load(iname, fname, width, height, use_fallback);
+        fb_pixbuf_cache_insert(name, width, height, variant,
+            iname || use_fallback, pb);
+    }
+    g_free(name);
+    return pb;
+}
+
+/**
+ * fb_pixbuf_add_row - saturating add of a colour to one row of RGBA pixels.
+ * @row:   First pixel of the row (R, G, B, A bytes).
+ * @n:     Number of pixels.
+ * @extra: R, G, B addends.
+ *
+ * Pixels with A == 0 are left untouched.  Four pixels at a time with SSE2
+ * or NEON: the addend vector is masked per 32-bit lane by "alpha != 0" and
+ * added with unsigned saturation.  The lane masks only depend on byte
+ * positions, so this is independent of endianness.  The scalar loop handles
+ * the tail and builds without SIMD.
+ */
+static void
+fb_pixbuf_add_row(guchar *row, int n, const guchar extra[3])
+{
+    int i;
+
+#if defined(__SSE2__)
+    const __m128i add = _mm_setr_epi8(
+        extra[0], extra[1], extra[2], 0, extra[0], extra[1], extra[2], 0,
+        extra[0], extra[1], extra[2], 0, extra[0], extra[1], extra[2], 0);
+    const __m128i amask = _mm_setr_epi8(0, 0, 0, -1, 0, 0, 0, -1,
+        0, 0, 0, -1, 0, 0, 0, -1);
+    __m128i v, clear;
+
+    for (; n >= 4; n -= 4, row += 16) {
+        v = _mm_loadu_si128((const __m128i *) row);
+        clear = _mm_cmpeq_epi32(_mm_and_si128(v, amask), _mm_setzero_si128());
+        v = _mm_adds_epu8(v, _mm_andnot_si128(clear, add));
+        _mm_storeu_si128((__m128i *) row, v);
+    }
+#elif defined(__ARM_NEON)
+    const guint8 addb[16] = {
+        extra[0], extra[1], extra[2], 0, extra[0], extra[1], extra[2], 0,
+        extra[0], extra[1], extra[2], 0, extra[0], extra[1], extra[2], 0 };
+    static const guint8 amaskb[16] = {
+        0, 0, 0, 0xFF, 0, 0, 0, 0xFF, 0, 0, 0, 0xFF, 0, 0, 0, 0xFF };
+    const uint8x16_t add = vld1q_u8(addb);
+    const uint32x4_t amask = vreinterpretq_u32_u8(vld1q_u8(amaskb));
+    uint8x16_t v, keep;
+
+    for (; n >= 4; n -= 4, row += 16) {
+        v = vld1q_u8(row);
+        keep = vreinterpretq_u8_u32(vtstq_u32(vreinterpretq_u32_u8(v), amask));
+        vst1q_u8(row, vqaddq_u8(v, vandq_u8(add, keep)));
+    }
+#endif
+    for (; n > 0; n--, row += 4) {
+        if (row[3] == 0)
+            continue;
+        for (i = 0; i < 3; i++)
+            row[i] = MIN(row[i] + extra[i], 255);
+    }
+}
+
 /**
  * fb_pixbuf_make_back_image - create a hover-highlight pixbuf from a base image.
  * @front:   Base pixbuf to highlight; may be NULL (returns NULL immediately).
@@ -90,8 +398,9 @@ fb_pixbuf_new(gchar *iname, gchar *fname, int width, int height,
  *           R/G/B values and clamped to 255.  0x000000 produces a no-op copy.
  *
  * Creates a new RGBA pixbuf (via gdk_pixbuf_add_alpha) and additively blends
- * @hicolor into each non-transparent pixel.  The alpha channel is preserved;
- * fully transparent pixels (A == 0) are skipped.
+ * @hicolor into each non-transparent pixel, a row at a time with
+ * fb_pixbuf_add_row().  The alpha channel is preserved; fully transparent
+ * pixels (A == 0) are skipped.
  *
  * On allocation failure (gdk_pixbuf_add_alpha returns NULL), returns @front
  * with an extra g_object_ref() — the caller still receives a (transfer full)
@@ -103,8 +412,8 @@ static GdkPixbuf *
 fb_pixbuf_make_back_image(GdkPixbuf *front, gulong hicolor)
 {
     GdkPixbuf *back;
-    guchar *src, *up, extra[3];
-    int i;
+    guchar *src, extra[3];
+    int i, w, h, stride;
 
     if(!front)
     {
@@ -116,19 +425,13 @@ fb_pixbuf_make_back_image(GdkPixbuf *front, gulong hicolor)
         return front;
     }
     src = gdk_pixbuf_get_pixels (back);
+    w = gdk_pixbuf_get_width(back);
+    h = gdk_pixbuf_get_height(back);
+    stride = gdk_pixbuf_get_rowstride(back);
     for (i = 2; i >= 0; i--, hicolor >>= 8)
         extra[i] = hicolor & 0xFF;
-    for (up = src + gdk_pixbuf_get_height(back) * gdk_pixbuf_get_rowstride (back);
-            src < up; src+=4) {
-        if (src[3] == 0)
-            continue;
-        for (i = 0; i < 3; i++) {
-            if (src[i] + extra[i] >= 255)
-                src[i] = 255;
-            else
-                src[i] += extra[i];
-        }
-    }
+    for (i = 0; i < h; i++, src += stride)
+        fb_pixbuf_add_row(src, w, extra);
     return back;
 }
 
@@ -212,8 +515,8 @@ fb_pixbuf_make_press_image(GdkPixbuf *front)
  *           redundant gtk_image_set_from_pixbuf() calls.
  * @pix:     Array of PIXBBUF_NUM (3) GdkPixbuf* refs, each (transfer full).
  *           pix[0] = normal; pix[1] = highlight; pix[2] = press.
- *           pix[1] and pix[2] are NULL for plain fb_image_new() images until
- *           the first icon-theme-changed event (see BUG-008).
+ *           pix[1] and pix[2] are NULL until fb_image_get_pix() first needs
+ *           them; they stay NULL for plain fb_image_new() images.
  */
 typedef struct {
     gchar *iname, *fname;
@@ -228,6 +531,52 @@ static void fb_image_free(GObject *image);
 static void fb_image_icon_theme_changed(GtkIconTheme *icon_theme,
         GtkWidget *image);
 
+/**
+ * fb_image_get_pix - return pixbuf slot @i, deriving it on first use.
+ * @conf: fb_image_conf_t of a button image. (transfer none)
+ * @i:    0 normal, 1 highlight, 2 press.
+ *
+ * The highlight and press variants are only built when the button is first
+ * hovered or pressed, and are looked up in the pixbuf cache under the same
+ * name and size as pix[0] first, so buttons showing the same icon share
+ * them.  With hicolor == 0 the highlight is pix[0] itself.
+ *
+ * Returns: (transfer none) conf->pix[@i]; may be NULL.
+ */
+static GdkPixbuf *
+fb_image_get_pix(fb_image_conf_t *conf, int i)
+{
+    gchar *name;
+    gulong variant;
+
+    if (!i || !conf->pix[0])
+        return conf->pix[0];
+    if (conf->pix[i])
+        return conf->pix[i];
+    if (i == 1 && !conf->hicolor) {
+        g_object_ref(G_OBJECT(conf->pix[0]));
+        return conf->pix[1] = conf->pix[0];
+    }
+    if (i == 2)
+        fb_image_get_pix(conf, 1);
+    /* fb_image_new() always loads with use_fallback, hence the fallback bit */
+    name = fb_pixbuf_name(conf->iname, conf->fname);
+    variant = PIX_VARIANT(i, conf->hicolor, TRUE);
+    conf->pix[i] = fb_pixbuf_cache_lookup(name, conf->width, conf->height,
+        variant);
+    if (!conf->pix[i]) {
+        conf->pix[i] = (i == 1)
+            ? fb_pixbuf_make_back_image(conf->pix[0], conf->hicolor)
+            : fb_pixbuf_make_press_image(conf->pix[1]);
+        fb_pixbuf_cache_insert(name, conf->width, conf->height, variant,
+            TRUE, conf->pix[i]);
+    }
+    g_free(name);
+    DBG("%s/%s - built pix[%d]=%p\n", conf->iname, conf->fname, i,
+        conf->pix[i]);
+    return conf->pix[i];
+}
+
 /**
  * fb_image_new - create a self-updating GtkImage widget.
  * @iname:  Icon name; passed to fb_pixbuf_new(); may be NULL.
@@ -309,16 +658,12 @@ fb_image_free(GObject *image)
  *              icon_theme is used via fb_pixbuf_new).
  * @image:      GtkWidget* (GtkImage) whose pixbufs need refreshing.
  *
- * Unrefs all three pixbuf slots (setting them to NULL), then rebuilds:
- *   pix[0] — fresh load from icon name / file path with use_fallback=TRUE
- *   pix[1] — highlight version via fb_pixbuf_make_back_image
- *   pix[2] — press version via fb_pixbuf_make_press_image
+ * Unrefs all three pixbuf slots (setting them to NULL), then reloads pix[0]
+ * from icon name / file path with use_fallback=TRUE through the pixbuf
+ * cache, whose own handler has already dropped the stale themed entries.
+ * pix[1] and pix[2] stay NULL until fb_image_get_pix() needs them again.
  *
- * pix[1] and pix[2] are only rebuilt when conf->hicolor is non-zero (i.e.
- * the image is used as a button with hover highlighting).  Plain images
- * (created via fb_image_new()) have hicolor==0 and skip the rebuild.
- *
- * Sets the image to display pix[0] (normal state) after rebuilding.
+ * Sets the image to display pix[0] (normal state) after reloading.
  */
 static void
 fb_image_icon_theme_changed(GtkIconTheme *icon_theme, GtkWidget *image)
@@ -335,10 +680,7 @@ fb_image_icon_theme_changed(GtkIconTheme *icon_theme, GtkWidget *image)
 	}
     conf->pix[0] = fb_pixbuf_new(conf->iname, conf->fname,
             conf->width, conf->height, TRUE);
-    if (conf->hicolor) {
-        conf->pix[1] = fb_pixbuf_make_back_image(conf->pix[0], conf->hicolor);
-        conf->pix[2] = fb_pixbuf_make_press_image(conf->pix[1]);
-    }
+    conf->i = 0;
     gtk_image_set_from_pixbuf(GTK_IMAGE(image), conf->pix[0]);
     return;
 }
@@ -360,8 +702,8 @@ static gboolean fb_button_pressed(GtkWidget *widget, GdkEventButton *event);
  * @hicolor: Hover highlight colour as 0xRRGGBB; 0 = no highlight.
  *
  * Creates a GtkBgbox (has_window=TRUE; pseudo-transparent background) containing
- * an fb_image_new() child.  After creation, populates pix[1] and pix[2] on the
- * image's conf struct:
+ * an fb_image_new() child and records @hicolor.  The variants are derived
+ * lazily by fb_image_get_pix() (shared through the pixbuf cache):
  *   pix[1] = fb_pixbuf_make_back_image(pix[0], hicolor)  — hover highlight
  *   pix[2] = fb_pixbuf_make_press_image(pix[1])          — press shrink
  *
@@ -390,8 +732,6 @@ fb_button_new(gchar *iname, gchar *fname, int width, int height, gulong hicolor)
     gtk_widget_set_valign(image, GTK_ALIGN_CENTER);
     conf = g_object_get_data(G_OBJECT(image), "conf");
     conf->hicolor = hicolor;
-    conf->pix[1] = fb_pixbuf_make_back_image(conf->pix[0], conf->hicolor);
-    conf->pix[2] = fb_pixbuf_make_press_image(conf->pix[1]);
     gtk_widget_add_events(b, GDK_ENTER_NOTIFY_MASK | GDK_LEAVE_NOTIFY_MASK);
     g_signal_connect_swapped (G_OBJECT (b), "enter-notify-event",
             G_CALLBACK (fb_button_cross), image);
@@ -434,7 +774,7 @@ fb_button_cross(GtkImage *widget, GdkEventCrossing *event)
     }
     if (conf->i != i) {
         conf->i = i;
-        gtk_image_set_from_pixbuf(GTK_IMAGE(widget), conf->pix[i]);
+        gtk_image_set_from_pixbuf(GTK_IMAGE(widget), fb_image_get_pix(conf, i));
     }
     DBG("%s/%s - %s - pix[%d]=%p\n", conf->iname, conf->fname,
 	(event->type == GDK_LEAVE_NOTIFY) ? "out" : "in",
@@ -477,7 +817,7 @@ fb_button_pressed(GtkWidget *widget, GdkEventButton *event)
     }
     if (conf->i != i) {
         conf->i = i;
-        gtk_image_set_from_pixbuf(GTK_IMAGE(widget), conf->pix[i]);
+        gtk_image_set_from_pixbuf(GTK_IMAGE(widget), fb_image_get_pix(conf, i));
     }
     return FALSE;
 }
@@ -16,6 +16,12 @@
  *   fb_create_calendar  — create a floating, decorated-less GtkWindow
  *                         containing a GtkCalendar.
  *
+ * PIXBUF CACHE
+ * ------------
+ * fb_pixbuf_new, fb_image_new and fb_button_new share their pixbufs through
+ * a process-wide LRU cache (fb_pixbuf_cache_*).  Returned pixbufs may be
+ * shared with other plugins and MUST NOT be modified in place; copy first.
+ *
  * OWNERSHIP
  * ---------
  * All four functions return (transfer full) — the caller is responsible for
@@ -30,9 +36,9 @@
  *   pix[2] — press (pix[1] scaled down by PRESS_GAP and centred); used on
  *             button-press
  *
- * pix[1] and pix[2] are populated by fb_button_new after creation.  For plain
- * fb_image_new images they remain NULL until the first icon-theme-changed event
- * (see BUG-008 in docs/BUGS_AND_ISSUES.md).
+ * pix[1] and pix[2] are derived lazily, on the first hover or press of an
+ * fb_button, and dropped again on icon-theme change.  Plain fb_image_new
+ * images never build them.
  *
  * See also: docs/ARCHITECTURE.md §5 (background rendering), docs/MEMORY_MODEL.md §6.
  */
@@ -61,6 +67,52 @@
 GdkPixbuf *fb_pixbuf_new(gchar *iname, gchar *fname, int width, int height,
         gboolean use_fallback);
 
+/**
+ * fb_pixbuf_new_from_xpm - shared pixbuf decoded from compiled-in XPM data.
+ * @name: Identifier of the image (e.g. "default.xpm"); the cache key.
+ * @data: XPM data; decoded only on the first call for @name.
+ *
+ * Returns: (transfer full) GdkPixbuf*, shared and immutable.
+ */
+GdkPixbuf *fb_pixbuf_new_from_xpm(const gchar *name, const char **data);
+
+/**
+ * fb_pixbuf_cache_init - create the process-wide pixbuf cache.
+ *
+ * Called from fb_init(); idempotent.  Connects the cache's
+ * GtkIconTheme::changed handler, which drops theme-dependent entries.
+ */
+void fb_pixbuf_cache_init(void);
+
+/**
+ * fb_pixbuf_cache_free - drop every cached pixbuf; called from fb_free().
+ */
+void fb_pixbuf_cache_free(void);
+
+/**
+ * fb_pixbuf_cache_lookup - find a cached pixbuf.
+ * @name:    Source identifier (icon name, file path, ...).
+ * @width:   Requested width.
+ * @height:  Requested height.
+ * @variant: Caller-defined variant; 0 for a plain load.
+ *
+ * Returns: (transfer full) shared GdkPixbuf*, or NULL on a miss.
+ */
+GdkPixbuf *fb_pixbuf_cache_lookup(const gchar *name, int width, int height,
+        gulong variant);
+
+/**
+ * fb_pixbuf_cache_insert - share a pixbuf under the given key.
+ * @name, @width, @height, @variant: Key, as for fb_pixbuf_cache_lookup().
+ * @themed: TRUE to drop the entry when the icon theme changes.
+ * @pb:     Pixbuf to share (transfer none); NULL is ignored.  The cache
+ *          takes its own reference; @pb must not be modified afterwards.
+ *
+ * Least-recently-used entries are evicted beyond a fixed byte budget.
+ */
+void fb_pixbuf_cache_insert(const gchar *name, int width, int height,
+        gulong variant, gboolean themed, GdkPixbuf *pb);
+
 /**
  * fb_image_new - create a self-updating GtkImage widget.
  * @iname:  Icon name; passed to fb_pixbuf_new(); may be NULL.
@@ -98,6 +150,7 @@ GtkWidget *fb_image_new(gchar *iname, gchar *fname, int width, int height);
  *             components (clamped at 255); displayed on GDK_ENTER_NOTIFY
  *   pix[2] — press: pix[1] scaled to (width - 2*PRESS_GAP) × (height - 2*PRESS_GAP)
  *             and centred; displayed on GDK_BUTTON_PRESS
+ * pix[1] and pix[2] are only built the first time they are displayed.
  *
  * Event signals (enter-notify, leave-notify, button-press, button-release) are
  * connected on the GtkBgbox (not the GtkImage) and swap the displayed pixbuf.
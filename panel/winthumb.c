@@ -0,0 +1,254 @@
+/**
+ * @file winthumb.c
+ * @brief Scaled-down captures of client windows through XComposite (implementation).
+ *
+ * CAPTURE
+ * -------
+ * A compositing manager redirects every top-level window to an off-screen
+ * pixmap.  winthumb_capture() names that pixmap (XCompositeNameWindowPixmap),
+ * wraps it in an XRender Picture with a scaling transform and a bilinear
+ * filter, and composites it into a pixmap of the thumbnail size, so the
+ * full-size contents never leave the server.  The small pixmap is then read
+ * back into a cairo image surface through cairo-xlib.
+ *
+ * Bilinear filtering samples only a few source pixels per thumbnail pixel,
+ * so large reductions alias; that is acceptable for pager-sized thumbnails
+ * and keeps the server-side cost proportional to the thumbnail.
+ *
+ * DAMAGE
+ * ------
+ * winthumb_watch() creates an XDamage object in XDamageReportNonEmpty mode:
+ * the server sends one DamageNotify when the window becomes damaged and
+ * none after that until the damage is subtracted, which winthumb_damaged()
+ * does.  Callers therefore get at most one event per window between two
+ * looks at it, however much the window repaints.
+ *
+ * All of this compiles to stubs without HAVE_XCOMPOSITE.
+ */
+
+#include <string.h>
+
+#include <gtk/gtk.h>
+#include <gdk/gdkx.h>
+#ifdef HAVE_XCOMPOSITE
+#include <X11/extensions/Xcomposite.h>
+#include <X11/extensions/Xdamage.h>
+#include <X11/extensions/Xrender.h>
+#include <cairo/cairo-xlib-xrender.h>
+#endif
+
+#include "panel.h"
+#include "misc.h"
+#include "winthumb.h"
+
+//#define DEBUGPRN
+#include "dbg.h"
+
+#ifdef HAVE_XCOMPOSITE
+
+static int winthumb_ok = -1;    /* -1: extensions not queried yet */
+static int damage_event;        /* XDamage event base */
+
+/**
+ * winthumb_init - query the extensions on first use.
+ *
+ * XCompositeNameWindowPixmap needs Composite 0.2.
+ *
+ * Returns: TRUE if Composite, Damage and Render are all usable.
+ */
+static gboolean
+winthumb_init(void)
+{
+    Display *dpy = GDK_DPY;
+    int ev, err, major = 0, minor = 0;
+
+    if (winthumb_ok < 0) {
+        winthumb_ok = XCompositeQueryExtension(dpy, &ev, &err)
+            && XCompositeQueryVersion(dpy, &major, &minor)
+            && (major > 0 || minor >= 2)
+            && XDamageQueryExtension(dpy, &damage_event, &err)
+            && XRenderQueryExtension(dpy, &ev, &err);
+        DBG("composite %d.%d ok=%d\n", major, minor, winthumb_ok);
+    }
+    return winthumb_ok;
+}
+
+#endif /* HAVE_XCOMPOSITE */
+
+/**
+ * winthumb_available - test whether windows can be captured now.
+ *
+ * See winthumb.h.
+ */
+gboolean
+winthumb_available(void)
+{
+#ifdef HAVE_XCOMPOSITE
+    static Atom cm_atom = None;
+    char name[32];
+
+    if (!winthumb_init())
+        return FALSE;
+    if (cm_atom == None) {
+        g_snprintf(name, sizeof(name), "_NET_WM_CM_S%d",
+            DefaultScreen(GDK_DPY));
+        cm_atom = XInternAtom(GDK_DPY, name, False);
+    }
+    return XGetSelectionOwner(GDK_DPY, cm_atom) != None;
+#else
+    return FALSE;
+#endif
+}
+
+/**
+ * winthumb_capture - capture a window scaled to a given size.
+ *
+ * See winthumb.h.
+ */
+cairo_surface_t *
+winthumb_capture(Window win, int w, int h)
+{
+#ifdef HAVE_XCOMPOSITE
+    Display *dpy = GDK_DPY;
+    GdkDisplay *display = gdk_display_get_default();
+    XWindowAttributes attr;
+    XRenderPictFormat *fmt, *dfmt;
+    XRenderPictureAttributes pa;
+    XTransform xf;
+    Pixmap spix = None, dpix = None;
+    Picture src = None, dst = None;
+    cairo_surface_t *xs, *ret = NULL;
+    cairo_t *cr;
+    int sw, sh;
+
+    if (w <= 0 || h <= 0 || !winthumb_init())
+        return NULL;
+    gdk_x11_display_error_trap_push(display);
+    if (!XGetWindowAttributes(dpy, win, &attr) || attr.map_state != IsViewable)
+        goto out;
+    if (!(fmt = XRenderFindVisualFormat(dpy, attr.visual))
+            || !(dfmt = XRenderFindStandardFormat(dpy, PictStandardRGB24)))
+        goto out;
+    /* the named pixmap includes the border */
+    sw = attr.width + 2 * attr.border_width;
+    sh = attr.height + 2 * attr.border_width;
+
+    spix = XCompositeNameWindowPixmap(dpy, win);
+    pa.subwindow_mode = IncludeInferiors;
+    src = XRenderCreatePicture(dpy, spix, fmt, CPSubwindowMode, &pa);
+    /* the transform maps thumbnail coordinates to window coordinates */
+    memset(&xf, 0, sizeof(xf));
+    xf.matrix[0][0] = XDoubleToFixed((double) sw / w);
+    xf.matrix[1][1] = XDoubleToFixed((double) sh / h);
+    xf.matrix[2][2] = XDoubleToFixed(1.0);
+    XRenderSetPictureTransform(dpy, src, &xf);
+    XRenderSetPictureFilter(dpy, src, FilterBilinear, NULL, 0);
+
+    dpix = XCreatePixmap(dpy, attr.root, w, h, dfmt->depth);
+    dst = XRenderCreatePicture(dpy, dpix, dfmt, 0, NULL);
+    XRenderComposite(dpy, PictOpSrc, src, None, dst, 0, 0, 0, 0, 0, 0, w, h);
+
+    xs = cairo_xlib_surface_create_with_xrender_format(dpy, dpix,
+        attr.screen, dfmt, w, h);
+    ret = cairo_image_surface_create(CAIRO_FORMAT_RGB24, w, h);
+    cr = cairo_create(ret);
+    cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+    cairo_set_source_surface(cr, xs, 0, 0);
+    cairo_paint(cr);
+    cairo_destroy(cr);
+    cairo_surface_finish(xs);
+    cairo_surface_destroy(xs);
+    if (cairo_surface_status(ret) != CAIRO_STATUS_SUCCESS) {
+        cairo_surface_destroy(ret);
+        ret = NULL;
+    }
+
+out:
+    if (dst)
+        XRenderFreePicture(dpy, dst);
+    if (src)
+        XRenderFreePicture(dpy, src);
+    if (dpix)
+        XFreePixmap(dpy, dpix);
+    if (spix)
+        XFreePixmap(dpy, spix);
+    if (gdk_x11_display_error_trap_pop(display) && ret) {
+        DBG("win %lx: capture failed\n", win);
+        cairo_surface_destroy(ret);
+        ret = NULL;
+    }
+    return ret;
+#else
+    return NULL;
+#endif
+}
+
+/**
+ * winthumb_watch - report content changes of a window as damage events.
+ *
+ * See winthumb.h.
+ */
+gulong
+winthumb_watch(Window win)
+{
+#ifdef HAVE_XCOMPOSITE
+    GdkDisplay *display = gdk_display_get_default();
+    Damage damage;
+
+    if (!winthumb_init())
+        return 0;
+    gdk_x11_display_error_trap_push(display);
+    damage = XDamageCreate(GDK_DPY, win, XDamageReportNonEmpty);
+    if (gdk_x11_display_error_trap_pop(display))
+        return 0;
+    return damage;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * winthumb_unwatch - destroy a damage object from winthumb_watch().
+ *
+ * The server frees damage objects with their drawable, so errors are
+ * ignored.
+ */
+void
+winthumb_unwatch(gulong damage)
+{
+#ifdef HAVE_XCOMPOSITE
+    GdkDisplay *display = gdk_display_get_default();
+
+    if (!damage)
+        return;
+    gdk_x11_display_error_trap_push(display);
+    XDamageDestroy(GDK_DPY, damage);
+    gdk_x11_display_error_trap_pop_ignored(display);
+#endif
+    return;
+}
+
+/**
+ * winthumb_damaged - recognise and acknowledge a damage event.
+ *
+ * See winthumb.h.
+ */
+Window
+winthumb_damaged(XEvent *xev)
+{
+#ifdef HAVE_XCOMPOSITE
+    GdkDisplay *display;
+    XDamageNotifyEvent *de;
+
+    if (winthumb_ok <= 0 || xev->type != damage_event + XDamageNotify)
+        return None;
+    de = (XDamageNotifyEvent *) xev;
+    display = gdk_display_get_default();
+    gdk_x11_display_error_trap_push(display);
+    XDamageSubtract(GDK_DPY, de->damage, None, None);
+    gdk_x11_display_error_trap_pop_ignored(display);
+    return de->drawable;
+#else
+    return None;
+#endif
+}
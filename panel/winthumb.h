@@ -0,0 +1,81 @@
+/**
+ * @file winthumb.h
+ * @brief Scaled-down captures of client windows through XComposite.
+ *
+ * winthumb_capture() asks the X server to scale a redirected top-level
+ * window (a WM frame, or an unparented client) into a small pixmap with
+ * XRender and reads back only that pixmap.  It needs a running compositing
+ * manager, which keeps top-level windows redirected.
+ *
+ * winthumb_watch() creates an XDamage object on a window so that callers
+ * learn when its contents change; winthumb_damaged() recognises and
+ * acknowledges the resulting events.
+ *
+ * Without the XComposite, XDamage and XRender development files at build
+ * time (HAVE_XCOMPOSITE undefined), or without the extensions at run time,
+ * every function reports failure and callers keep their plain drawing.
+ *
+ * Included by misc.h, so plugins get it through the usual headers.
+ */
+
+#ifndef WINTHUMB_H
+#define WINTHUMB_H
+
+#include <X11/Xlib.h>
+#include <cairo/cairo.h>
+#include <glib.h>
+
+/**
+ * winthumb_available - test whether windows can be captured now.
+ *
+ * Queries the extensions once; checks for a compositing manager (owner of
+ * _NET_WM_CM_S<screen>) on every call, which is one round trip.
+ *
+ * Returns: TRUE if the extensions are present and a compositor runs.
+ */
+gboolean winthumb_available(void);
+
+/**
+ * winthumb_capture - capture a window scaled to a given size.
+ * @win: Redirected top-level window (frame).
+ * @w:   Thumbnail width in pixels.
+ * @h:   Thumbnail height in pixels.
+ *
+ * Scaling is done by the server with a bilinear XRender filter; only the
+ * @w x @h result crosses the connection.  X errors (window gone or not
+ * redirected) are trapped.
+ *
+ * Returns: (transfer full) new CAIRO_FORMAT_RGB24 image surface, or NULL
+ *          if the window is not viewable or cannot be captured.
+ */
+cairo_surface_t *winthumb_capture(Window win, int w, int h);
+
+/**
+ * winthumb_watch - report content changes of a window as damage events.
+ * @win: Window to watch.
+ *
+ * Uses XDamageReportNonEmpty: one event when the window goes from clean to
+ * damaged, re-armed by winthumb_damaged().
+ *
+ * Returns: XDamage id to pass to winthumb_unwatch(), or 0 if unavailable.
+ */
+gulong winthumb_watch(Window win);
+
+/**
+ * winthumb_unwatch - destroy a damage object from winthumb_watch().
+ * @damage: Damage id; 0 is ignored.
+ *
+ * Safe to call after the watched window was destroyed.
+ */
+void winthumb_unwatch(gulong damage);
+
+/**
+ * winthumb_damaged - recognise and acknowledge a damage event.
+ * @xev: Event from a GDK filter. (transfer none)
+ *
+ * Returns: the damaged window if @xev is a DamageNotify (the damage is
+ *          subtracted so the next change reports again), else None.
+ */
+Window winthumb_damaged(XEvent *xev);
+
+#endif /* WINTHUMB_H */
@@ -0,0 +1,686 @@
+/**
+ * @file wmicon.c
+ * @brief Client window icons: loading and per-window cache (implementation).
+ *
+ * _NET_WM_ICON FORMAT
+ * -------------------
+ * The property is an array of CARDINALs holding any number of sub-icons,
+ * each laid out as width, height, then width * height ARGB pixels
+ * (0xAARRGGBB, non-premultiplied).  Xlib returns format-32 data as an array
+ * of longs, so on LP64 every pixel occupies 8 bytes with the value in the
+ * low 32 bits.  Browsers and toolkits typically publish 16..512 px sets.
+ *
+ * LOADING
+ * -------
+ * netwm_icon_load() walks the sub-icon headers only, picks the best fit
+ * (netwm_icon_pick) and converts just that sub-icon to RGBA bytes
+ * (argb_to_rgba).  The property is read in
+ * pieces with XGetWindowProperty's long_offset/long_length (netwm_reader):
+ * chunks while walking the headers, then exactly the chosen sub-icon if it
+ * is not already in the last chunk, so a 1 MB icon set costs a few tens of
+ * KB on the wire.  The taskbar and pager
+ * previously each kept a copy of this code that took whatever sub-icon came
+ * first and always scaled it with GDK_INTERP_HYPER.  Windows without a
+ * usable _NET_WM_ICON fall back to the WM_HINTS icon pixmap and mask, read
+ * back through cairo-xlib (wm_hints_icon_load).
+ *
+ * CACHE
+ * -----
+ * get_window_icon() keeps one wmicon per client window: the source icon,
+ * read once, and the sizes derived from it on demand (the taskbar's
+ * iconsize, the pager's 16 px and its smaller thumbnails).  Entries are
+ * dropped by a global GDK event filter on _NET_WM_ICON / WM_HINTS
+ * PropertyNotify and on DestroyNotify, so each icon crosses the X
+ * connection once however many plugins show it.
+ *
+ * argb_to_rgba() has an SSE2 (byte shuffle with SSSE3) and an AArch64 NEON
+ * kernel for the LP64 little-endian layout, and a portable scalar loop for
+ * everything else and for the tail.
+ */
+
+#include <X11/Xatom.h>
+
+#include <gtk/gtk.h>
+#include <gdk/gdkx.h>
+#include <cairo/cairo-xlib.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "panel.h"
+#include "misc.h"
+#include "wmicon.h"
+
+//#define DEBUGPRN
+#include "dbg.h"
+
+/** Largest sub-icon dimension accepted; anything bigger is treated as junk. */
+#define WMICON_MAX_SIZE 1024
+
+/**
+ * Items per header-walk read: 16 KiB on the wire, enough for the 16, 22,
+ * 24 and 32 px sub-icons plus the next header in one round trip.
+ */
+#define WMICON_CHUNK 4096
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN && GLIB_SIZEOF_LONG == 8 \
+    && (defined(__SSE2__) || (defined(__aarch64__) && defined(__ARM_NEON)))
+#define WMICON_SIMD 1
+#endif
+
+/**
+ * free_pixels - GdkPixbuf destroy notify for g_new'd pixel data.
+ * @pixels: Pixel data to free. (transfer full)
+ * @data:   Unused.
+ */
+static void
+free_pixels(guchar *pixels, gpointer data)
+{
+    g_free(pixels);
+}
+
+/**
+ * argb_to_rgba - convert _NET_WM_ICON pixels to packed RGBA bytes.
+ * @argb: @len CARDINAL pixels as returned by Xlib (one long each).
+ * @rgba: Output buffer of @len * 4 bytes.
+ * @len:  Number of pixels.
+ *
+ * Each 0xAARRGGBB value becomes the bytes R, G, B, A.  The SIMD kernels
+ * handle four pixels per step: the low halves of four 64-bit longs are
+ * packed into one vector, whose bytes are then B, G, R, A per pixel, and R
+ * and B are swapped.
+ */
+static void
+argb_to_rgba(const gulong *argb, guchar *rgba, int len)
+{
+    guint32 v;
+    int i = 0;
+
+#if defined(WMICON_SIMD) && defined(__SSE2__)
+    __m128i a, b, px;
+#if defined(__SSSE3__)
+    const __m128i swap = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7,
+        10, 9, 8, 11, 14, 13, 12, 15);
+#else
+    const __m128i ga = _mm_set1_epi32(0xFF00FF00);
+    __m128i rb;
+#endif
+
+    for (; i + 4 <= len; i += 4, rgba += 16) {
+        a = _mm_loadu_si128((const __m128i *) (argb + i));
+        b = _mm_loadu_si128((const __m128i *) (argb + i + 2));
+        /* keep the low 32 bits of each long: lanes 0 and 2 */
+        a = _mm_shuffle_epi32(a, _MM_SHUFFLE(3, 1, 2, 0));
+        b = _mm_shuffle_epi32(b, _MM_SHUFFLE(3, 1, 2, 0));
+        px = _mm_unpacklo_epi64(a, b);
+#if defined(__SSSE3__)
+        px = _mm_shuffle_epi8(px, swap);
+#else
+        rb = _mm_andnot_si128(ga, px);
+        px = _mm_or_si128(_mm_and_si128(px, ga),
+            _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16)));
+#endif
+        _mm_storeu_si128((__m128i *) rgba, px);
+    }
+#elif defined(WMICON_SIMD)
+    static const guint8 swapb[16] = {
+        2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15 };
+    const uint8x16_t swap = vld1q_u8(swapb);
+    uint32x4_t px;
+
+    for (; i + 4 <= len; i += 4, rgba += 16) {
+        px = vcombine_u32(vmovn_u64(vld1q_u64((const uint64_t *) (argb + i))),
+            vmovn_u64(vld1q_u64((const uint64_t *) (argb + i + 2))));
+        vst1q_u8(rgba, vqtbl1q_u8(vreinterpretq_u8_u32(px), swap));
+    }
+#endif
+    for (; i < len; i++, rgba += 4) {
+        v = argb[i];
+        rgba[0] = (v >> 16) & 0xff;
+        rgba[1] = (v >> 8) & 0xff;
+        rgba[2] = v & 0xff;
+        rgba[3] = v >> 24;
+    }
+}
+
+/**
+ * netwm_reader - chunked reader over a window's _NET_WM_ICON.
+ * @win:   Window whose property is read.
+ * @buf:   Current chunk (Xlib heap, XFree'd by netwm_read/netwm_icon_load).
+ * @start: Item offset of buf[0] within the property.
+ * @n:     Number of items in @buf.
+ * @total: Number of items in the whole property (from bytes_after).
+ */
+typedef struct {
+    Window win;
+    gulong *buf;
+    gulong start;
+    gulong n;
+    gulong total;
+} netwm_reader;
+
+/** Cumulative _NET_WM_ICON bytes fetched from the X server. */
+static guint64 wmicon_bytes;
+
+/**
+ * netwm_read - fetch @length items of _NET_WM_ICON starting at @offset.
+ * @r:      netwm_reader; its previous chunk is released. (transfer none)
+ * @offset: Item (32-bit unit) offset, the long_offset of XGetWindowProperty.
+ * @length: Number of items wanted.
+ *
+ * Every fetched item is 4 bytes on the wire and is added to wmicon_bytes.
+ *
+ * Returns: TRUE if at least one CARDINAL item was read.
+ */
+static gboolean
+netwm_read(netwm_reader *r, gulong offset, gulong length)
+{
+    Atom type;
+    int format;
+    unsigned long n, after;
+    unsigned char *data = NULL;
+
+    if (r->buf)
+        XFree(r->buf);
+    r->buf = NULL;
+    r->n = 0;
+    if (XGetWindowProperty(GDK_DPY, r->win, a_NET_WM_ICON, offset, length,
+            False, XA_CARDINAL, &type, &format, &n, &after, &data) != Success)
+        return FALSE;
+    if (type != XA_CARDINAL || format != 32 || !data || !n) {
+        if (data)
+            XFree(data);
+        return FALSE;
+    }
+    r->buf = (gulong *) data;
+    r->start = offset;
+    r->n = n;
+    r->total = offset + n + after / 4;
+    wmicon_bytes += (guint64) n * 4;
+    return TRUE;
+}
+
+/**
+ * netwm_item - return a pointer to items @offset .. @offset + @len - 1.
+ * @r:      netwm_reader. (transfer none)
+ * @offset: Item offset within the property.
+ * @len:    Number of items needed contiguously.
+ * @chunk:  Items to fetch if they are not in the current chunk (>= @len).
+ *
+ * Returns: (transfer none) pointer into r->buf, valid until the next read;
+ *          NULL if the property is shorter than requested.
+ */
+static const gulong *
+netwm_item(netwm_reader *r, gulong offset, gulong len, gulong chunk)
+{
+    if (!r->buf || offset < r->start || offset + len > r->start + r->n) {
+        if (!netwm_read(r, offset, chunk))
+            return NULL;
+    }
+    if (offset + len > r->start + r->n)
+        return NULL;
+    return r->buf + (offset - r->start);
+}
+
+/**
+ * netwm_icon_pick - choose the sub-icon that best fits @iw x @ih.
+ * @r:   netwm_reader. (transfer none)
+ * @iw:  Desired width.
+ * @ih:  Desired height.
+ * @w:   (out) Width of the chosen sub-icon.
+ * @h:   (out) Height of the chosen sub-icon.
+ * @fits: (out) TRUE if it covers @iw x @ih; FALSE means it is the largest
+ *       one available.
+ *
+ * Walks the sub-icon headers in WMICON_CHUNK-item reads: small sub-icons
+ * share a chunk, and a header beyond the current chunk costs one more read
+ * at its offset, so the large pixel blocks in between are never fetched.
+ * Prefers the smallest sub-icon covering @iw x @ih (least scaling work, no
+ * upscaling); failing that, the largest one.
+ *
+ * Returns: item offset of the chosen sub-icon's first pixel, or 0 if there
+ *          is no valid sub-icon.
+ */
+static gulong
+netwm_icon_pick(netwm_reader *r, int iw, int ih, int *w, int *h,
+        gboolean *fits_ret)
+{
+    const gulong *hdr;
+    gulong off, cw, ch, best = 0, bw = 0, bh = 0;
+    gboolean fits, best_fits = FALSE;
+
+    for (off = 0; (hdr = netwm_item(r, off, 2, WMICON_CHUNK));
+            off += 2 + cw * ch) {
+        cw = hdr[0];
+        ch = hdr[1];
+        if (cw < 1 || ch < 1 || cw > WMICON_MAX_SIZE || ch > WMICON_MAX_SIZE
+                || off + 2 + cw * ch > r->total) {
+            DBG("broken sub-icon header at %lu: %lux%lu\n", off, cw, ch);
+            break;
+        }
+        DBG("sub-icon: %lux%lu\n", cw, ch);
+        fits = (cw >= (gulong) iw && ch >= (gulong) ih);
+        if (!best || (fits && (!best_fits || cw * ch < bw * bh))
+                || (!fits && !best_fits && cw * ch > bw * bh)) {
+            best = off + 2;
+            bw = cw;
+            bh = ch;
+            best_fits = fits;
+        }
+        if (off + 2 + cw * ch >= r->total)
+            break;
+    }
+    *w = bw;
+    *h = bh;
+    *fits_ret = best_fits;
+    return best;
+}
+
+/**
+ * netwm_icon_load - read the best-fitting _NET_WM_ICON sub-icon unscaled.
+ * @win:  Client window.
+ * @iw:   Desired width.
+ * @ih:   Desired height.
+ * @fits: (out) see netwm_icon_pick().
+ *
+ * Only the sub-icon headers and the chosen sub-icon's pixels are fetched
+ * (usually two or three small reads instead of the whole property); the
+ * bytes transferred are logged at LOG_DEBUG.
+ *
+ * Returns: (transfer full) RGBA GdkPixbuf at the sub-icon's own size, or
+ *          NULL if the property is absent or unusable.
+ */
+static GdkPixbuf *
+netwm_icon_load(Window win, int iw, int ih, gboolean *fits)
+{
+    netwm_reader r = { .win = win };
+    const gulong *pix;
+    GdkPixbuf *ret = NULL;
+    guint64 bytes0 = wmicon_bytes;
+    gulong off;
+    guchar *p;
+    int w, h;
+
+    off = netwm_icon_pick(&r, iw, ih, &w, &h, fits);
+    if (!off) {
+        if (r.total)
+            ERR("win %lx: _NET_WM_ICON is broken (size=%lu)\n", win, r.total);
+        goto out;
+    }
+    pix = netwm_item(&r, off, (gulong) w * h, (gulong) w * h);
+    if (!pix)
+        goto out;
+    DBG("win %lx: %dx%d for %dx%d\n", win, w, h, iw, ih);
+    p = g_new(guchar, w * h * 4);
+    argb_to_rgba(pix, p, w * h);
+    ret = gdk_pixbuf_new_from_data(p, GDK_COLORSPACE_RGB, TRUE,
+        8, w, h, w * 4, free_pixels, NULL);
+    if (!ret)
+        g_free(p);
+
+out:
+    if (r.buf)
+        XFree(r.buf);
+    LOG(LOG_DEBUG, "win %lx: _NET_WM_ICON %lu items, fetched %lu bytes "
+        "(total %lu)\n", win, r.total, (gulong) (wmicon_bytes - bytes0),
+        (gulong) wmicon_bytes);
+    return ret;
+}
+
+/*****************************************************************
+ * WM_HINTS icon pixmaps                                         *
+ *****************************************************************/
+
+/**
+ * pixmap_to_pixbuf - read an X11 Pixmap into a GdkPixbuf via cairo-xlib.
+ * @xpixmap: Pixmap to read.
+ * @width:   Width to read.
+ * @height:  Height to read.
+ *
+ * Copies the pixmap into an RGB24 image surface.  1-bit bitmaps (icon
+ * masks) are rendered white-on-black so that apply_mask() can treat 0 as
+ * transparent and 255 as opaque.
+ *
+ * Returns: (transfer full) new GdkPixbuf, or NULL on X11 / cairo failure.
+ */
+static GdkPixbuf *
+pixmap_to_pixbuf(Pixmap xpixmap, int width, int height)
+{
+    Display *dpy = GDK_DPY;
+    cairo_surface_t *xlib_surf, *image;
+    GdkPixbuf *ret;
+    cairo_t *cr;
+    Window root_ret;
+    int rx, ry;
+    unsigned int rw, rh, rborder, depth;
+
+    if (!XGetGeometry(dpy, xpixmap, &root_ret, &rx, &ry, &rw, &rh, &rborder,
+            &depth))
+        return NULL;
+    image = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height);
+    if (cairo_surface_status(image) != CAIRO_STATUS_SUCCESS) {
+        cairo_surface_destroy(image);
+        return NULL;
+    }
+    if (depth == 1)
+        xlib_surf = cairo_xlib_surface_create_for_bitmap(dpy, xpixmap,
+            DefaultScreenOfDisplay(dpy), (int) rw, (int) rh);
+    else
+        xlib_surf = cairo_xlib_surface_create(dpy, xpixmap,
+            DefaultVisual(dpy, DefaultScreen(dpy)), (int) rw, (int) rh);
+    if (cairo_surface_status(xlib_surf) != CAIRO_STATUS_SUCCESS) {
+        cairo_surface_destroy(xlib_surf);
+        cairo_surface_destroy(image);
+        return NULL;
+    }
+    cr = cairo_create(image);
+    if (depth == 1) {
+        cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+        cairo_paint(cr);
+        cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
+        cairo_mask_surface(cr, xlib_surf, 0, 0);
+    } else {
+        cairo_set_source_surface(cr, xlib_surf, 0, 0);
+        cairo_paint(cr);
+    }
+    cairo_destroy(cr);
+    cairo_surface_destroy(xlib_surf);
+    ret = gdk_pixbuf_get_from_surface(image, 0, 0, width, height);
+    cairo_surface_destroy(image);
+    return ret;
+}
+
+/**
+ * apply_mask - composite a 1-bit mask into a pixbuf's alpha channel.
+ * @pixbuf: Source RGB pixbuf. (transfer none)
+ * @mask:   Mask from pixmap_to_pixbuf() of a bitmap. (transfer none)
+ *
+ * Returns: (transfer full) new RGBA GdkPixbuf; 0 in @mask is transparent.
+ */
+static GdkPixbuf *
+apply_mask(GdkPixbuf *pixbuf, GdkPixbuf *mask)
+{
+    GdkPixbuf *with_alpha;
+    guchar *src, *dest;
+    int w, h, i, j, src_stride, dest_stride;
+
+    w = MIN(gdk_pixbuf_get_width(mask), gdk_pixbuf_get_width(pixbuf));
+    h = MIN(gdk_pixbuf_get_height(mask), gdk_pixbuf_get_height(pixbuf));
+    with_alpha = gdk_pixbuf_add_alpha(pixbuf, FALSE, 0, 0, 0);
+    if (!with_alpha)
+        return NULL;
+    dest = gdk_pixbuf_get_pixels(with_alpha);
+    src = gdk_pixbuf_get_pixels(mask);
+    dest_stride = gdk_pixbuf_get_rowstride(with_alpha);
+    src_stride = gdk_pixbuf_get_rowstride(mask);
+    for (i = 0; i < h; i++)
+        for (j = 0; j < w; j++)
+            /* mask pixels are grey: 255 if the bit was set, 0 otherwise */
+            dest[i * dest_stride + j * 4 + 3] =
+                src[i * src_stride + j * 3] ? 255 : 0;
+    return with_alpha;
+}
+
+/**
+ * wm_hints_icon_load - read a window's WM_HINTS icon pixmap and mask.
+ * @win: Client window.
+ *
+ * Returns: (transfer full) GdkPixbuf at the pixmap's own size, or NULL if
+ *          WM_HINTS has no icon pixmap or reading it fails.
+ */
+static GdkPixbuf *
+wm_hints_icon_load(Window win)
+{
+    XWMHints *hints;
+    Pixmap xpixmap = None, xmask = None;
+    Window root;
+    unsigned int w, h;
+    int sd;
+    GdkPixbuf *ret, *masked, *mask;
+
+    hints = XGetWMHints(GDK_DPY, win);
+    if (!hints)
+        return NULL;
+    if ((hints->flags & IconPixmapHint))
+        xpixmap = hints->icon_pixmap;
+    if ((hints->flags & IconMaskHint))
+        xmask = hints->icon_mask;
+    XFree(hints);
+    DBG("win %lx: xpixmap=%lx xmask=%lx\n", win, xpixmap, xmask);
+    if (xpixmap == None)
+        return NULL;
+
+    if (!XGetGeometry(GDK_DPY, xpixmap, &root, &sd, &sd, &w, &h,
+            (guint *) &sd, (guint *) &sd))
+        return NULL;
+    if (!(ret = pixmap_to_pixbuf(xpixmap, w, h)))
+        return NULL;
+    if (xmask != None && XGetGeometry(GDK_DPY, xmask, &root, &sd, &sd,
+            &w, &h, (guint *) &sd, (guint *) &sd)
+            && (mask = pixmap_to_pixbuf(xmask, w, h))) {
+        masked = apply_mask(ret, mask);
+        g_object_unref(G_OBJECT(mask));
+        if (masked) {
+            g_object_unref(G_OBJECT(ret));
+            ret = masked;
+        }
+    }
+    return ret;
+}
+
+/*****************************************************************
+ * Per-window icon cache                                         *
+ *****************************************************************/
+
+/**
+ * wmicon - cached icon of one client window.
+ * @src:     Source icon at its own size; NULL if the window has no icon
+ *           (a cached negative answer).
+ * @netwm:   @src came from _NET_WM_ICON (else from WM_HINTS).
+ * @largest: No bigger source exists, so @src serves every requested size.
+ *           Otherwise it only serves sizes it covers.
+ * @sizes:   Derived pixbufs, (w << 16 | h) -> GdkPixbuf (owns a reference).
+ */
+typedef struct {
+    GdkPixbuf *src;
+    gboolean netwm;
+    gboolean largest;
+    GHashTable *sizes;
+} wmicon;
+
+static GHashTable *wmicon_cache;       /* Window -> wmicon */
+
+static void
+wmicon_free(gpointer data)
+{
+    wmicon *e = data;
+
+    if (e->src)
+        g_object_unref(G_OBJECT(e->src));
+    g_hash_table_destroy(e->sizes);
+    g_free(e);
+}
+
+/**
+ * wmicon_event_filter - global GdkFilterFunc keeping the cache current.
+ *
+ * Installed with gdk_window_add_filter(NULL, ...) so it runs before the
+ * per-window filters of the taskbar, pager and icons plugins: by the time
+ * they react to a PropertyNotify, the stale entry is already gone and the
+ * first of them to ask refetches the icon for all.
+ *
+ * _NET_WM_ICON changes always drop the entry.  WM_HINTS changes (urgency
+ * toggles among them) only drop entries not sourced from _NET_WM_ICON,
+ * which takes precedence.  DestroyNotify drops the entry of the window.
+ *
+ * Returns: GDK_FILTER_CONTINUE always.
+ */
+static GdkFilterReturn
+wmicon_event_filter(XEvent *xev, GdkEvent *event, gpointer data)
+{
+    wmicon *e;
+    Window win;
+
+    if (xev->type == PropertyNotify) {
+        win = xev->xproperty.window;
+        if (xev->xproperty.atom != a_NET_WM_ICON
+                && xev->xproperty.atom != XA_WM_HINTS)
+            return GDK_FILTER_CONTINUE;
+        e = g_hash_table_lookup(wmicon_cache, GSIZE_TO_POINTER(win));
+        if (e && (xev->xproperty.atom == a_NET_WM_ICON || !e->netwm)) {
+            DBG("win %lx: icon changed\n", win);
+            g_hash_table_remove(wmicon_cache, GSIZE_TO_POINTER(win));
+        }
+    } else if (xev->type == DestroyNotify) {
+        g_hash_table_remove(wmicon_cache,
+            GSIZE_TO_POINTER(xev->xdestroywindow.window));
+    }
+    return GDK_FILTER_CONTINUE;
+}
+
+/**
+ * wmicon_load - read a window's icon and create its cache entry.
+ * @win: Client window.
+ * @iw:  Size the source should cover, if the window offers one.
+ * @ih:  Ditto.
+ *
+ * _NET_WM_ICON is preferred; WM_HINTS pixmaps come in a single size.
+ *
+ * Returns: (transfer full) new wmicon; never NULL.
+ */
+static wmicon *
+wmicon_load(Window win, int iw, int ih)
+{
+    wmicon *e;
+    gboolean fits = FALSE;
+
+    e = g_new0(wmicon, 1);
+    e->sizes = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+        g_object_unref);
+    if ((e->src = netwm_icon_load(win, iw, ih, &fits))) {
+        e->netwm = TRUE;
+        e->largest = !fits;
+    } else {
+        e->src = wm_hints_icon_load(win);
+        e->largest = TRUE;
+    }
+    DBG("win %lx: %s %dx%d\n", win, e->src ? (e->netwm ? "netwm" : "wmhints")
+        : "none", e->src ? gdk_pixbuf_get_width(e->src) : 0,
+        e->src ? gdk_pixbuf_get_height(e->src) : 0);
+    return e;
+}
+
+/**
+ * wmicon_scale - derive an icon of the requested size from a source.
+ * @src: Source pixbuf. (transfer none)
+ * @iw:  Target width.
+ * @ih:  Target height.
+ *
+ * Exact sizes are returned as is.  With best-fit selection the ratio is
+ * usually below 2, where bilinear filtering is indistinguishable from
+ * GDK_INTERP_HYPER and far cheaper; larger reductions keep HYPER.
+ *
+ * Returns: (transfer full) @iw x @ih pixbuf, or NULL on allocation failure.
+ */
+static GdkPixbuf *
+wmicon_scale(GdkPixbuf *src, int iw, int ih)
+{
+    GdkInterpType interp;
+    int w, h;
+
+    w = gdk_pixbuf_get_width(src);
+    h = gdk_pixbuf_get_height(src);
+    if (w == iw && h == ih) {
+        g_object_ref(G_OBJECT(src));
+        return src;
+    }
+    interp = (w <= 2 * iw && h <= 2 * ih) ? GDK_INTERP_BILINEAR
+        : GDK_INTERP_HYPER;
+    return gdk_pixbuf_scale_simple(src, iw, ih, interp);
+}
+
+/**
+ * get_window_icon - a client window's icon at a given size, cached.
+ *
+ * See wmicon.h.
+ */
+GdkPixbuf *
+get_window_icon(Window win, int iw, int ih, gboolean *netwm)
+{
+    wmicon *e;
+    GdkPixbuf *pb;
+    gpointer key = GSIZE_TO_POINTER(win);
+
+    if (!wmicon_cache) {
+        wmicon_cache = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+            NULL, wmicon_free);
+        gdk_window_add_filter(NULL, (GdkFilterFunc) wmicon_event_filter,
+            NULL);
+    }
+    e = g_hash_table_lookup(wmicon_cache, key);
+    if (e && e->src && !e->largest && (gdk_pixbuf_get_width(e->src) < iw
+            || gdk_pixbuf_get_height(e->src) < ih)) {
+        /* a larger sub-icon exists: reload the source for this size */
+        g_hash_table_remove(wmicon_cache, key);
+        e = NULL;
+    }
+    if (!e) {
+        e = wmicon_load(win, iw, ih);
+        g_hash_table_insert(wmicon_cache, key, e);
+    }
+    if (netwm)
+        *netwm = e->netwm;
+    if (!e->src)
+        return NULL;
+    pb = g_hash_table_lookup(e->sizes, GINT_TO_POINTER(iw << 16 | ih));
+    if (!pb) {
+        if (!(pb = wmicon_scale(e->src, iw, ih)))
+            return NULL;
+        g_hash_table_insert(e->sizes, GINT_TO_POINTER(iw << 16 | ih), pb);
+    }
+    g_object_ref(G_OBJECT(pb));
+    return pb;
+}
+
+/**
+ * window_has_icon - test whether a client window provides an icon.
+ *
+ * See wmicon.h.
+ */
+gboolean
+window_has_icon(Window win)
+{
+    netwm_reader r = { .win = win };
+    XWMHints *hints;
+    wmicon *e;
+    gboolean ret;
+
+    if (wmicon_cache
+            && (e = g_hash_table_lookup(wmicon_cache, GSIZE_TO_POINTER(win))))
+        return e->src != NULL;
+    if ((ret = netwm_read(&r, 0, 2)))
+        XFree(r.buf);
+    else if ((hints = XGetWMHints(GDK_DPY, win))) {
+        ret = (hints->flags & (IconPixmapHint | IconMaskHint)) != 0;
+        XFree(hints);
+    }
+    return ret;
+}
+
+/**
+ * wmicon_cache_free - drop every cached window icon and the event filter.
+ */
+void
+wmicon_cache_free(void)
+{
+    if (!wmicon_cache)
+        return;
+    gdk_window_remove_filter(NULL, (GdkFilterFunc) wmicon_event_filter, NULL);
+    g_hash_table_destroy(wmicon_cache);
+    wmicon_cache = NULL;
+}
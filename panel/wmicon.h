@@ -0,0 +1,57 @@
+/**
+ * @file wmicon.h
+ * @brief Client window icons shared by the taskbar, pager and icons plugins.
+ *
+ * get_window_icon() returns a window's icon at any size from a per-window
+ * cache in the panel core: the source icon (_NET_WM_ICON sub-icon that best
+ * fits, else the WM_HINTS pixmap) is read from the X server once, sizes are
+ * derived from it on demand, and the entry is dropped when the window's
+ * _NET_WM_ICON or WM_HINTS icon changes or the window is destroyed.
+ * Invalidation relies on the plugins having selected PropertyChangeMask and
+ * StructureNotifyMask on the window, which they do for every task.
+ *
+ * Returned pixbufs are shared between plugins and must not be modified.
+ *
+ * Included by misc.h, so plugins get it through the usual headers.
+ */
+
+#ifndef WMICON_H
+#define WMICON_H
+
+#include <X11/Xlib.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+/**
+ * get_window_icon - a client window's icon at a given size.
+ * @win:   Client window.
+ * @iw:    Desired icon width in pixels.
+ * @ih:    Desired icon height in pixels.
+ * @netwm: (out, optional) set to TRUE if the icon comes from _NET_WM_ICON.
+ *
+ * From _NET_WM_ICON, uses the smallest sub-icon that is at least @iw x @ih,
+ * or the largest one if none is; only that sub-icon is transferred.  Falls
+ * back to the WM_HINTS icon pixmap and mask.
+ *
+ * Returns: (transfer full) shared GdkPixbuf of exactly @iw x @ih; caller
+ *          must g_object_unref().  NULL if the window has no usable icon.
+ */
+GdkPixbuf *get_window_icon(Window win, int iw, int ih, gboolean *netwm);
+
+/**
+ * window_has_icon - test whether a client window provides an icon.
+ * @win: Client window.
+ *
+ * Answers from the cache when the window is in it; otherwise probes the
+ * first two items of _NET_WM_ICON and the WM_HINTS icon flags without
+ * transferring any pixels.
+ *
+ * Returns: TRUE if the window has _NET_WM_ICON or a WM_HINTS icon.
+ */
+gboolean window_has_icon(Window win);
+
+/**
+ * wmicon_cache_free - drop all cached window icons; called from fb_free().
+ */
+void wmicon_cache_free(void);
+
+#endif /* WMICON_H */
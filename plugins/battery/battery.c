@@ -9,26 +9,53 @@
  *   batt_na[]       — "battery_na" (no battery or AC-only)
  *
  * On Linux, the actual charge level is read from the ACPI sysfs interface
- * via the os_linux.c.inc include.  On other platforms, battery_update_os()
- * sets c->exist = FALSE and the "N/A" set is used.
+ * via the os_linux.c.inc include.  The power supplies are indexed once
+ * (power_supply.c) and kept current by kernel uevents, so plugging or
+ * unplugging AC updates the icon immediately; the timeout only re-reads
+ * the indexed uevent files to follow the slow capacity drift.  On other
+ * platforms, battery_update_os() sets c->exist = FALSE and the "N/A" set
+ * is used.
  *
- * Config keys: none (icon sizes come from the meter base plugin).
+ * While discharging, each update appends (time, energy, power) — summed
+ * over all batteries from the readings already in the index — to a small
+ * ring.  The energy drop across the ring (or the reported power_now when
+ * the drop is too coarse) feeds an exponentially weighted discharge rate,
+ * from which the remaining time is shown in the tooltip and, optionally,
+ * as a label next to the icon.
+ *
+ * Config keys:
+ *   ShowTime (bool, default false) — show remaining time (h:mm) as text.
  *
  * Delegates construction and destruction to meter_class (obtained via
- * class_get("meter")/class_put("meter")).  Installs a 2-second GLib timeout
- * calling battery_update().
+ * class_get("meter")/class_put("meter")).  Installs a GLib timeout calling
+ * battery_poll(): every BATTERY_POLL_EVENTS seconds when uevents are
+ * available, every BATTERY_POLL seconds otherwise.
  */
 
 #include "misc.h"
 #include "../meter/meter.h"
+#include "power_supply.h"
 
 //#define DEBUGPRN
 #include "dbg.h"
+#include <math.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 
+#define BATTERY_POLL        2  /* second; without uevents */
+#define BATTERY_POLL_EVENTS 60 /* second; uevents report plug/unplug */
+#define BATTERY_SAMPLES     8  /* discharge samples kept in the ring */
+#define BATTERY_RATE_SPAN   60 /* second; shortest span for an energy delta */
+#define BATTERY_RATE_TAU    300 /* second; time constant of the rate EWMA */
+
+/* One discharge sample, totals over all batteries. */
+typedef struct {
+    gint64 time;        /**< g_get_monotonic_time() of the reading, us. */
+    gdouble energy;     /**< Remaining energy, uWh. */
+    gdouble power;      /**< Reported draw, uW; -1 if unknown. */
+} battery_sample;
 
 static meter_class *k;
 
@@ -38,9 +65,19 @@ typedef struct {
     gfloat level;       /**< Current charge level [0..100]. */
     gboolean charging;  /**< TRUE if the battery is currently charging. */
     gboolean exist;     /**< TRUE if a battery was detected. */
+    power_supply *ps;   /**< Power supply index (Linux); NULL elsewhere. */
+    gdouble energy;     /**< Remaining energy of all batteries, uWh; -1 unknown. */
+    gdouble power;      /**< Reported draw of all batteries, uW; -1 unknown. */
+    battery_sample ring[BATTERY_SAMPLES]; /**< Discharge samples. */
+    int head;           /**< Next ring slot to write. */
+    int nring;          /**< Valid samples in ring. */
+    gdouble rate;       /**< Smoothed discharge rate, uW; 0 if not known yet. */
+    int show_time;      /**< Boolean: show remaining time as text. */
+    GtkWidget *label;   /**< Remaining time label (ShowTime); owned by pwid. */
 } battery_priv;
 
 static gboolean battery_update_os(battery_priv *c);
+static gboolean battery_update(battery_priv *c);
 
 static gchar *batt_working[] = {
     "battery_0",
@@ -77,58 +114,159 @@ static gchar *batt_na[] = {
 #include "os_linux.c.inc"
 #else
 
+static int
+battery_open_os(battery_priv *c)
+{
+    return BATTERY_POLL;
+}
+
+static void
+battery_close_os(battery_priv *c)
+{
+}
+
 static void
+battery_refresh_os(battery_priv *c)
+{
+}
+
+static gboolean
 battery_update_os(battery_priv *c)
 {
     c->exist = FALSE;
+    c->energy = c->power = -1;
+    return FALSE;
 }
 
 #endif
 
+/**
+ * battery_estimate - add a discharge sample and update the smoothed rate.
+ * @c: battery_priv with fresh energy/power totals. (transfer none)
+ *
+ * The ring is emptied while charging or when the energy is unknown, so the
+ * estimate restarts on every unplug.  A sample's instantaneous rate is the
+ * energy drop from the oldest ring sample when it spans at least
+ * BATTERY_RATE_SPAN seconds (energy_now is coarse on many batteries),
+ * otherwise the reported power.  The rate EWMA weighs samples by the time
+ * since the previous one, so irregular uevent-driven updates do not skew
+ * it.
+ */
+static void
+battery_estimate(battery_priv *c)
+{
+    battery_sample *s, *old, *last;
+    gdouble inst = -1;
+    gint64 now;
+
+    if (!c->exist || c->charging || c->energy < 0) {
+        c->nring = 0;
+        c->rate = 0;
+        return;
+    }
+    now = g_get_monotonic_time();
+    last = c->nring ? &c->ring[(c->head + BATTERY_SAMPLES - 1) % BATTERY_SAMPLES] : NULL;
+    if (last && now - last->time < G_USEC_PER_SEC)
+        return;
+    s = &c->ring[c->head];
+    s->time = now;
+    s->energy = c->energy;
+    s->power = c->power;
+    c->head = (c->head + 1) % BATTERY_SAMPLES;
+    if (c->nring < BATTERY_SAMPLES)
+        c->nring++;
+    old = &c->ring[(c->head + BATTERY_SAMPLES - c->nring) % BATTERY_SAMPLES];
+
+    if (s->time - old->time >= BATTERY_RATE_SPAN * G_USEC_PER_SEC
+        && old->energy > s->energy)
+        inst = (old->energy - s->energy) * 3600 * G_USEC_PER_SEC
+            / (s->time - old->time);
+    else if (s->power > 0)
+        inst = s->power;
+    if (inst <= 0)
+        return;
+    if (!last || c->rate <= 0)
+        c->rate = inst;
+    else
+        c->rate += (inst - c->rate) * (1 - exp(-(gdouble) (s->time - last->time)
+            / (BATTERY_RATE_TAU * G_USEC_PER_SEC)));
+    DBG("energy=%.0f power=%.0f inst=%.0f rate=%.0f\n",
+        s->energy, s->power, inst, c->rate);
+}
+
 /**
  * battery_update - poll battery state and update the meter icon.
  * @c: battery_priv. (transfer none)
  *
- * Calls battery_update_os() (platform-specific sysfs reader) to populate
- * c->level, c->charging, and c->exist.  Selects the appropriate icon set
- * and updates the tooltip markup.  Then delegates to meter_class->set_icons()
- * and set_level() to update the display.
+ * Calls battery_update_os() (platform-specific) to populate c->level,
+ * c->charging, c->exist and the energy totals from the power supply index,
+ * then battery_estimate().  Selects the appropriate icon set and updates
+ * the tooltip markup (with rate and remaining time once known) and the
+ * ShowTime label.  Then delegates to meter_class->set_icons() and
+ * set_level() to update the display.
  *
- * Called from the 2-second GLib timeout and once from the constructor.
+ * Called from battery_poll(), from the uevent callback and once from the
+ * constructor.
  *
  * Returns: TRUE to keep the timeout active.
  */
 static gboolean
 battery_update(battery_priv *c)
 {
-    gchar buf[50];
+    gchar buf[128], left[16];
     gchar **i;
+    int min;
 
     battery_update_os(c);
+    battery_estimate(c);
+    left[0] = 0;
     if (c->exist) {
         i = c->charging ? batt_charging : batt_working;
-        g_snprintf(buf, sizeof(buf), "<b>Battery:</b> %d%%%s",
-            (int) c->level, c->charging ? "\nCharging" : "");
+        if (c->rate > 0) {
+            min = (int) (c->energy / c->rate * 60);
+            g_snprintf(left, sizeof(left), "%d:%02d", min / 60, min % 60);
+            g_snprintf(buf, sizeof(buf),
+                "<b>Battery:</b> %d%%\nDischarging %.1f W\n%s remaining",
+                (int) c->level, c->rate / 1e6, left);
+        } else
+            g_snprintf(buf, sizeof(buf), "<b>Battery:</b> %d%%%s",
+                (int) c->level, c->charging ? "\nCharging" : "");
         gtk_widget_set_tooltip_markup(((plugin_instance *)c)->pwid, buf);
     } else {
         i = batt_na;
         gtk_widget_set_tooltip_markup(((plugin_instance *)c)->pwid,
             "Runing on AC\nNo battery found");
     }
+    if (c->label)
+        gtk_label_set_text(GTK_LABEL(c->label), left);
     k->set_icons(&c->meter, i);
     k->set_level(&c->meter, c->level);
     return TRUE;
 }
 
+/**
+ * battery_poll - GLib timeout: re-read the power supplies, then update.
+ * @c: battery_priv. (transfer none)
+ *
+ * Returns: TRUE to keep the timeout active.
+ */
+static gboolean
+battery_poll(battery_priv *c)
+{
+    battery_refresh_os(c);
+    return battery_update(c);
+}
+
 
 /**
  * battery_constructor - initialise the battery plugin on top of meter_class.
  * @p: plugin_instance. (transfer none)
  *
  * Obtains the meter_class singleton via class_get("meter") and calls its
- * constructor to set up the GtkImage in p->pwid.  Installs a 2-second
- * GLib timeout for periodic updates and calls battery_update() once
- * immediately.
+ * constructor to set up the GtkImage in p->pwid.  Builds the power supply
+ * index (subscribing to uevents), installs a GLib timeout for periodic
+ * re-reads and calls battery_update() once immediately.  With ShowTime,
+ * the meter image is moved into a box together with a time label.
  *
  * Returns: 1 on success, 0 if meter class is unavailable.
  */
@@ -136,13 +274,27 @@ static int
 battery_constructor(plugin_instance *p)
 {
     battery_priv *c;
+    GtkWidget *box;
 
     if (!(k = class_get("meter")))
         return 0;
     if (!PLUGIN_CLASS(k)->constructor(p))
         return 0;
     c = (battery_priv *) p;
-    c->timer = g_timeout_add(2000, (GSourceFunc) battery_update, c);
+    XCG(p->xc, "ShowTime", &c->show_time, enum, bool_enum);
+    if (c->show_time) {
+        box = p->panel->my_box_new(GTK_ORIENTATION_HORIZONTAL, 1);
+        g_object_ref(c->meter.meter);
+        gtk_container_remove(GTK_CONTAINER(p->pwid), c->meter.meter);
+        gtk_box_pack_start(GTK_BOX(box), c->meter.meter, FALSE, FALSE, 0);
+        g_object_unref(c->meter.meter);
+        c->label = gtk_label_new(NULL);
+        gtk_box_pack_start(GTK_BOX(box), c->label, FALSE, FALSE, 0);
+        gtk_container_add(GTK_CONTAINER(p->pwid), box);
+        gtk_widget_show_all(box);
+    }
+    c->timer = g_timeout_add_seconds(battery_open_os(c),
+        (GSourceFunc) battery_poll, c);
     battery_update(c);
     return 1;
 }
@@ -151,8 +303,9 @@ battery_constructor(plugin_instance *p)
  * battery_destructor - stop the polling timer and release meter_class.
  * @p: plugin_instance. (transfer none)
  *
- * Removes the GLib timeout, calls meter_class destructor to disconnect the
- * icon-theme signal, then releases the meter_class reference via class_put().
+ * Removes the GLib timeout, frees the power supply index (closing the
+ * uevent socket), calls meter_class destructor to disconnect the icon-theme
+ * signal, then releases the meter_class reference via class_put().
  */
 static void
 battery_destructor(plugin_instance *p)
@@ -161,6 +314,7 @@ battery_destructor(plugin_instance *p)
 
     if (c->timer)
         g_source_remove(c->timer);
+    battery_close_os(c);
     PLUGIN_CLASS(k)->destructor(p);
     class_put("meter");
     return;
@@ -170,7 +324,7 @@ static plugin_class class = {
     .count       = 0,
     .type        = "battery",
     .name        = "battery usage",
-    .version     = "1.1",
+    .version     = "1.3",
     .description = "Display battery usage",
     .priv_size   = sizeof(battery_priv),
     .constructor = battery_constructor,
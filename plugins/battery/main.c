@@ -8,8 +8,7 @@
 
 int main(int argc, char** args)
 {
-    power_supply* ps = power_supply_new();
-    power_supply_parse(ps);
+    power_supply* ps = power_supply_new(NULL, NULL);
     gboolean ac_online = power_supply_is_ac_online(ps);
     gdouble bat_capacity = power_supply_get_bat_capacity(ps);
 
@@ -1,14 +1,34 @@
 // Time-stamp: < power_supply.c (2015-12-04 19:01) >
 
+/*
+ * The power supplies under /sys/class/power_supply are indexed once by
+ * power_supply_new(): each device's "type" file is read a single time and
+ * its "uevent" file is kept open, so a refresh is one pread() per device.
+ *
+ * Changes are pushed by the kernel: a NETLINK_KOBJECT_UEVENT socket joined
+ * to the kernel multicast group is watched by a GLib source, and every
+ * power_supply "change" message carries the same POWER_SUPPLY_* properties
+ * as the uevent file, so the index is updated straight from the message
+ * without touching sysfs.  "add" and "remove" messages insert or drop
+ * devices (batteries hot-plugged into docks, USB supplies).
+ */
+
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
 #include <glib-2.0/glib.h>
 #include <glib-2.0/glib/gprintf.h>
+#include <glib-unix.h>
 
 #include "power_supply.h"
 
 #define DEBUG 0
 
 #define STRING_LEN 100
+#define UEVENT_BUF_LEN 4096
 
 #define SYS_ACPI_PATH "/sys/class/power_supply/"
 #define SYS_ACPI_TYPE_FILE "type"
@@ -32,69 +52,87 @@
 #define SYS_ACPI_UEVENT_BAT_CHARGE_FULL_KEY "POWER_SUPPLY_CHARGE_FULL"
 #define SYS_ACPI_UEVENT_BAT_CHARGE_NOW_KEY "POWER_SUPPLY_CHARGE_NOW"
 
-/* Debug function to print out uevent file key-value pairs. */
-static void
-uevent_ghfunc(gpointer key, gpointer value, gpointer user_data)
-{
-    gchar* k = (gchar*) key;
-    gchar* v = (gchar*) value;
-    g_fprintf(stderr, "'%s' => '%s'\n", k, v);
-}
+/* Kernel uevent message keys. */
+#define UEVENT_ACTION_KEY "ACTION="
+#define UEVENT_SUBSYSTEM_KEY "SUBSYSTEM="
+#define UEVENT_DEVPATH_KEY "DEVPATH="
+#define UEVENT_SUBSYSTEM "power_supply"
+/* Kernel uevent multicast group (udev re-broadcasts on group 2). */
+#define UEVENT_KERNEL_GROUP 1
+
+/* Numeric battery readings, all stored as gdouble in struct bat. */
+static const struct {
+    const gchar* key;
+    gsize offset;
+} bat_values[] = {
+    { SYS_ACPI_UEVENT_BAT_ENERGY_NOW_KEY, G_STRUCT_OFFSET(bat, energy_now) },
+    { SYS_ACPI_UEVENT_BAT_ENERGY_FULL_KEY, G_STRUCT_OFFSET(bat, energy_full) },
+    { "POWER_SUPPLY_ENERGY_FULL_DESIGN", G_STRUCT_OFFSET(bat, energy_full_design) },
+    { "POWER_SUPPLY_POWER_NOW", G_STRUCT_OFFSET(bat, power_now) },
+    { SYS_ACPI_UEVENT_BAT_CHARGE_NOW_KEY, G_STRUCT_OFFSET(bat, charge_now) },
+    { SYS_ACPI_UEVENT_BAT_CHARGE_FULL_KEY, G_STRUCT_OFFSET(bat, charge_full) },
+    { "POWER_SUPPLY_CHARGE_FULL_DESIGN", G_STRUCT_OFFSET(bat, charge_full_design) },
+    { "POWER_SUPPLY_CURRENT_NOW", G_STRUCT_OFFSET(bat, current_now) },
+    { "POWER_SUPPLY_VOLTAGE_NOW", G_STRUCT_OFFSET(bat, voltage_now) },
+};
+
+#define BAT_VALUE(b, i) G_STRUCT_MEMBER(gdouble, (b), bat_values[i].offset)
+
+typedef void (*uevent_func)(gchar* key, gchar* value, gpointer data);
 
-/* Parses uevent file returning the result as GHashTable. */
-static GHashTable*
-uevent_parse(gchar* filename)
+/*
+ * Calls @func for every KEY=VALUE entry of @buf.  Entries are separated by
+ * @sep: '\n' in uevent files, '\0' in netlink messages.  @buf is modified
+ * in place and must be NUL-terminated at @buf[len].
+ */
+static void
+uevent_foreach(gchar* buf, gsize len, gchar sep, uevent_func func, gpointer data)
 {
-    GHashTable* hash = NULL;
-    GString* key = g_string_sized_new(STRING_LEN);
-    GString* value = g_string_sized_new(STRING_LEN);
-    gchar* buf = NULL;
-    guint buf_len = 0;
-    gchar c;
-    guint i;
-    gboolean equals_sign_found = FALSE;
-
-    if (g_file_test(filename, G_FILE_TEST_IS_REGULAR)) {
-        if (g_file_get_contents(filename, &buf, 0, NULL)) {
-            hash = g_hash_table_new_full(&g_str_hash, &g_str_equal, &g_free, &g_free);
-            buf_len = strlen(buf);
-
-            for (i = 0; i < buf_len; ++i) {
-                c = buf[i];
-                if (c == '=' && !equals_sign_found) {
-                    equals_sign_found = TRUE;
-                } else if (c == '\n' && equals_sign_found) {
-                    equals_sign_found = FALSE;
-                    g_hash_table_insert(hash, g_strdup(key->str), g_strdup(value->str));
-                    g_string_truncate(key, 0);
-                    g_string_truncate(value, 0);
-                } else {
-                    if (equals_sign_found) {
-                        g_string_append_c(value, c);
-                    } else {
-                        g_string_append_c(key, c);
-                    }
-                }
-            }
+    gchar* end = buf + len;
+    gchar* next;
+    gchar* eq;
+
+    for (; buf < end; buf = next) {
+        next = memchr(buf, sep, end - buf);
+        if (next == NULL) {
+            next = end;
+        }
+        *next++ = 0;
+        eq = strchr(buf, '=');
+        if (eq != NULL) {
+            *eq = 0;
             if (DEBUG) {
-                g_hash_table_foreach(hash, &uevent_ghfunc, NULL);
+                g_fprintf(stderr, "'%s' => '%s'\n", buf, eq + 1);
             }
+            func(buf, eq + 1, data);
         }
     }
+}
 
-    g_free(buf);
-    g_string_free(key, TRUE);
-    g_string_free(value, TRUE);
+/* Reads the uevent file behind @fd into @buf; returns its length or 0. */
+static gsize
+uevent_read(int fd, gchar* buf)
+{
+    gssize n;
 
-    return hash;
+    if (fd < 0) {
+        return 0;
+    }
+    n = pread(fd, buf, UEVENT_BUF_LEN - 1, 0);
+    if (n <= 0) {
+        return 0;
+    }
+    buf[n] = 0;
+    return n;
 }
 
 static ac*
-ac_new(gchar* path)
+ac_new(gchar* path, const gchar* name)
 {
     ac* tmp = g_new(ac, 1);
     tmp->path = path;
-    tmp->name = NULL;
+    tmp->name = g_strdup(name);
+    tmp->fd = open(path, O_RDONLY | O_CLOEXEC);
     tmp->online = FALSE;
     return tmp;
 }
@@ -103,6 +141,9 @@ static void
 ac_free(gpointer p)
 {
     ac* tmp = (ac*) p;
+    if (tmp->fd >= 0) {
+        close(tmp->fd);
+    }
     g_free(tmp->path);
     g_free(tmp->name);
     g_free(tmp);
@@ -118,43 +159,46 @@ ac_print(gpointer p, gpointer user_data)
     g_fprintf(stderr, "AC\n  path: %s\n  name: %s\n online: %d\n", tmp->path, tmp->name, tmp->online);
 }
 
-/* Parses information about AC power supply based on ac->path. */
+/* Applies one uevent KEY=VALUE pair to an ac. */
+static void
+ac_set(gchar* key, gchar* value, gpointer data)
+{
+    ac* ac = data;
+
+    if (strcmp(key, SYS_ACPI_UEVENT_NAME_KEY) == 0) {
+        g_free(ac->name);
+        ac->name = g_strdup(value);
+    } else if (strcmp(key, SYS_ACPI_UEVENT_AC_ONLINE_KEY) == 0) {
+        ac->online = strcmp(SYS_ACPI_UEVENT_AC_ONLINE_VALUE, value) == 0;
+    }
+}
+
+/* Parses information about AC power supply from its uevent file. */
 static ac*
 ac_parse(ac* ac)
 {
-    GHashTable* hash;
-    gchar* tmp_value;
-
-    if (ac->path != NULL) {
-        hash = uevent_parse(ac->path);
-        if (hash != NULL) {
-            // ac name
-            tmp_value = (gchar*) g_hash_table_lookup(hash, SYS_ACPI_UEVENT_NAME_KEY);
-            if (tmp_value != NULL) {
-                ac->name = g_strdup(tmp_value);
-            }
-
-            // ac online
-            tmp_value = (gchar*) g_hash_table_lookup(hash, SYS_ACPI_UEVENT_AC_ONLINE_KEY);
-            if (tmp_value != NULL) {
-                ac->online = strcmp(SYS_ACPI_UEVENT_AC_ONLINE_VALUE, tmp_value) == 0;
-            }
+    gchar buf[UEVENT_BUF_LEN];
+    gsize len;
 
-            g_hash_table_destroy(hash);
-        }
+    if ((len = uevent_read(ac->fd, buf)) > 0) {
+        uevent_foreach(buf, len, '\n', ac_set, ac);
     }
-
     return ac;
 }
 
 static bat*
-bat_new(gchar* path)
+bat_new(gchar* path, const gchar* name)
 {
+    guint i;
     bat* tmp = g_new(bat, 1);
     tmp->path = path;
-    tmp->name = NULL;
+    tmp->name = g_strdup(name);
+    tmp->fd = open(path, O_RDONLY | O_CLOEXEC);
     tmp->status = NULL;
     tmp->capacity = -1;
+    for (i = 0; i < G_N_ELEMENTS(bat_values); i++) {
+        BAT_VALUE(tmp, i) = -1;
+    }
     return tmp;
 }
 
@@ -162,6 +206,9 @@ static void
 bat_free(gpointer p)
 {
     bat* tmp = (bat*) p;
+    if (tmp->fd >= 0) {
+        close(tmp->fd);
+    }
     g_free(tmp->path);
     g_free(tmp->name);
     g_free(tmp->status);
@@ -178,73 +225,297 @@ bat_print(gpointer p, gpointer user_data)
     g_fprintf(stderr, "BATTERY\n  path: %s\n  name: %s\n  status: %s\n  capacity: %f\n", tmp->path, tmp->name, tmp->status, tmp->capacity);
 }
 
-/* Parses information about BATTERY power supply based on bat->path. */
-static bat*
-bat_parse(bat* bat)
+/* Applies one uevent KEY=VALUE pair to a bat. */
+static void
+bat_set(gchar* key, gchar* value, gpointer data)
 {
-    GHashTable* hash;
-    gchar* tmp_value;
-
-    if (bat->path != NULL) {
-        hash = uevent_parse(bat->path);
-        if (hash != NULL) {
-            // battery name
-            tmp_value = (gchar*) g_hash_table_lookup(hash, SYS_ACPI_UEVENT_NAME_KEY);
-            if (tmp_value != NULL) {
-                bat->name = g_strdup(tmp_value);
-            }
+    bat* bat = data;
+    guint i;
 
-            // battery status
-            tmp_value = (gchar*) g_hash_table_lookup(hash, SYS_ACPI_UEVENT_BAT_STATUS_KEY);
-            if (tmp_value != NULL) {
-                bat->status = g_strdup(tmp_value);
+    if (strncmp(key, "POWER_SUPPLY_", 13) != 0) {
+        return;
+    }
+    if (strcmp(key, SYS_ACPI_UEVENT_NAME_KEY) == 0) {
+        g_free(bat->name);
+        bat->name = g_strdup(value);
+    } else if (strcmp(key, SYS_ACPI_UEVENT_BAT_STATUS_KEY) == 0) {
+        g_free(bat->status);
+        bat->status = g_strdup(value);
+    } else if (strcmp(key, SYS_ACPI_UEVENT_BAT_CAPACITY_KEY) == 0) {
+        bat->capacity = g_ascii_strtod(value, NULL);
+    } else {
+        for (i = 0; i < G_N_ELEMENTS(bat_values); i++) {
+            if (strcmp(key, bat_values[i].key) == 0) {
+                BAT_VALUE(bat, i) = g_ascii_strtod(value, NULL);
+                break;
             }
+        }
+    }
+}
 
-            // battery remaining capacity
-            tmp_value = (gchar*) g_hash_table_lookup(hash, SYS_ACPI_UEVENT_BAT_CAPACITY_KEY);
-            if (tmp_value != NULL) {
-                bat->capacity = g_ascii_strtod(tmp_value, NULL);
-            } else { // for older kernels
-                tmp_value = (gchar*) g_hash_table_lookup(hash, SYS_ACPI_UEVENT_BAT_ENERGY_NOW_KEY);
-                gdouble tmp = -1;
-                if (tmp_value != NULL) { // ac off
-                    tmp = g_ascii_strtod(tmp_value, NULL);
-                    tmp_value = (gchar*) g_hash_table_lookup(hash, SYS_ACPI_UEVENT_BAT_ENERGY_FULL_KEY);
-                    if (tmp_value != NULL && tmp > 0) {
-                        tmp = tmp / g_ascii_strtod(tmp_value, NULL) * 100;
-                        bat->capacity = tmp;
-                    }
-                } else {
-                    tmp_value = (gchar*) g_hash_table_lookup(hash, SYS_ACPI_UEVENT_BAT_CHARGE_NOW_KEY);
-                    if (tmp_value != NULL) { // ac on
-                        tmp = g_ascii_strtod(tmp_value, NULL);
-                        tmp_value = (gchar*) g_hash_table_lookup(hash, SYS_ACPI_UEVENT_BAT_CHARGE_FULL_KEY);
-                        if (tmp_value != NULL && tmp > 0) {
-                            tmp = tmp / g_ascii_strtod(tmp_value, NULL) * 100;
-                            bat->capacity = tmp;
-                        }
-                    }
-                }
-            }
+/*
+ * Parses a complete uevent property set (file contents or netlink message)
+ * into @bat.  Readings missing from the set are reset to -1.
+ */
+static void
+bat_apply(bat* bat, gchar* buf, gsize len, gchar sep)
+{
+    guint i;
 
-            g_hash_table_destroy(hash);
+    bat->capacity = -1;
+    for (i = 0; i < G_N_ELEMENTS(bat_values); i++) {
+        BAT_VALUE(bat, i) = -1;
+    }
+    uevent_foreach(buf, len, sep, bat_set, bat);
+    if (bat->capacity < 0) { // for older kernels
+        if (bat->energy_now >= 0) { // ac off
+            if (bat->energy_full > 0 && bat->energy_now > 0) {
+                bat->capacity = bat->energy_now / bat->energy_full * 100;
+            }
+        } else if (bat->charge_now >= 0) { // ac on
+            if (bat->charge_full > 0 && bat->charge_now > 0) {
+                bat->capacity = bat->charge_now / bat->charge_full * 100;
+            }
         }
     }
+}
 
+/* Parses information about BATTERY power supply from its uevent file. */
+static bat*
+bat_parse(bat* bat)
+{
+    gchar buf[UEVENT_BUF_LEN];
+    gsize len;
+
+    if ((len = uevent_read(bat->fd, buf)) > 0) {
+        bat_apply(bat, buf, len, '\n');
+    }
     return bat;
 }
 
+/*
+ * Looks up a device by its sysfs directory name.  ac and bat both start
+ * with path and name, so one walker serves both lists.
+ */
+static GSequenceIter*
+power_supply_find(GSequence* list, const gchar* name)
+{
+    GSequenceIter* it;
+    ac* dev;
+
+    for (it = g_sequence_get_begin_iter(list); !g_sequence_iter_is_end(it);
+         it = g_sequence_iter_next(it)) {
+        dev = (ac*) g_sequence_get(it);
+        if (g_strcmp0(dev->name, name) == 0) {
+            return it;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Reads the type of /sys/class/power_supply/@name and indexes it as AC or
+ * BATTERY.  Returns TRUE if the device was added.
+ */
+static gboolean
+power_supply_add(power_supply* ps, const gchar* name)
+{
+    GString* filename = g_string_sized_new(STRING_LEN);
+    gchar* contents = NULL;
+    gboolean added = FALSE;
+    guint len;
+
+    g_string_append(filename, SYS_ACPI_PATH);
+    g_string_append(filename, name);
+    g_string_append_c(filename, G_DIR_SEPARATOR);
+    len = filename->len;
+    g_string_append(filename, SYS_ACPI_TYPE_FILE);
+    if (g_file_get_contents(filename->str, &contents, 0, NULL)) {
+        g_string_truncate(filename, len);
+        g_string_append(filename, SYS_ACPI_UEVENT_FILE);
+        if (strcmp(SYS_ACPI_TYPE_AC, contents) == 0) {
+            ac* tmp = ac_new(g_strdup(filename->str), name);
+            ac_parse(tmp);
+            g_sequence_append(ps->ac_list, tmp);
+            added = TRUE;
+        } else if (strcmp(SYS_ACPI_TYPE_BAT, contents) == 0) {
+            bat* tmp = bat_new(g_strdup(filename->str), name);
+            bat_parse(tmp);
+            g_sequence_append(ps->bat_list, tmp);
+            added = TRUE;
+        } else if (DEBUG) {
+            g_fprintf(stderr, "unsupported power supply type %s", contents);
+        }
+        g_free(contents);
+    }
+    g_string_free(filename, TRUE);
+    return added;
+}
+
+/* Indexes every power supply on the current system. */
+static void
+power_supply_scan(power_supply* ps)
+{
+    GDir* dir;
+    const gchar* tmp;
+
+    dir = g_dir_open(SYS_ACPI_PATH, 0, NULL);
+    if (dir != NULL) {
+        while ((tmp = g_dir_read_name(dir)) != NULL) {
+            power_supply_add(ps, tmp);
+        }
+        g_dir_close(dir);
+    }
+
+    if (DEBUG) {
+        g_sequence_foreach(ps->ac_list, &ac_print, NULL);
+        g_sequence_foreach(ps->bat_list, &bat_print, NULL);
+    }
+}
+
+/*
+ * Applies one kernel uevent message (ACTION@DEVPATH followed by
+ * NUL-separated KEY=VALUE pairs) to the index.  Returns TRUE if the index
+ * changed.
+ */
+static gboolean
+power_supply_event(power_supply* ps, gchar* buf, gsize len)
+{
+    gchar* s;
+    gchar* action = NULL;
+    gchar* subsystem = NULL;
+    gchar* name = NULL;
+    GSequenceIter* it;
+    gboolean is_bat = TRUE;
+
+    for (s = buf; s < buf + len; s += strlen(s) + 1) {
+        if (g_str_has_prefix(s, UEVENT_ACTION_KEY)) {
+            action = s + strlen(UEVENT_ACTION_KEY);
+        } else if (g_str_has_prefix(s, UEVENT_SUBSYSTEM_KEY)) {
+            subsystem = s + strlen(UEVENT_SUBSYSTEM_KEY);
+        } else if (g_str_has_prefix(s, UEVENT_DEVPATH_KEY)) {
+            name = strrchr(s, '/');
+        }
+    }
+    if (action == NULL || name == NULL || g_strcmp0(subsystem, UEVENT_SUBSYSTEM) != 0) {
+        return FALSE;
+    }
+    name++;
+    if (DEBUG) {
+        g_fprintf(stderr, "uevent %s %s\n", action, name);
+    }
+
+    if ((it = power_supply_find(ps->bat_list, name)) == NULL) {
+        is_bat = FALSE;
+        it = power_supply_find(ps->ac_list, name);
+    }
+    if (strcmp(action, "remove") == 0) {
+        if (it == NULL) {
+            return FALSE;
+        }
+        g_sequence_remove(it);
+        return TRUE;
+    }
+    if (it == NULL) {
+        return power_supply_add(ps, name);
+    }
+    if (strcmp(action, "change") != 0) {
+        return FALSE;
+    }
+    if (is_bat) {
+        bat_apply((bat*) g_sequence_get(it), buf, len, '\0');
+    } else {
+        uevent_foreach(buf, len, '\0', ac_set, g_sequence_get(it));
+    }
+    return TRUE;
+}
+
+/* GLib source callback: drains the uevent socket. */
+static gboolean
+power_supply_uevent(gint fd, GIOCondition condition, gpointer data)
+{
+    power_supply* ps = (power_supply*) data;
+    gchar buf[UEVENT_BUF_LEN];
+    struct sockaddr_nl addr;
+    socklen_t addrlen;
+    gboolean changed = FALSE;
+    gssize n;
+
+    for (;;) {
+        addrlen = sizeof(addr);
+        n = recvfrom(fd, buf, sizeof(buf) - 1, 0, (struct sockaddr*) &addr, &addrlen);
+        if (n < 0 && errno == ENOBUFS) {
+            // messages were dropped: resynchronise from sysfs
+            power_supply_update(ps);
+            changed = TRUE;
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        // only the kernel may speak on this socket
+        if (addr.nl_pid != 0) {
+            continue;
+        }
+        buf[n] = 0;
+        changed |= power_supply_event(ps, buf, n);
+    }
+    if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        g_fprintf(stderr, "power_supply: uevent socket: %s\n", g_strerror(errno));
+        ps->watch = 0;
+        return G_SOURCE_REMOVE;
+    }
+    if (changed && ps->changed != NULL) {
+        ps->changed(ps->data);
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+/* Subscribes to power_supply kernel uevents. */
+static void
+power_supply_watch(power_supply* ps)
+{
+    struct sockaddr_nl addr;
+
+    ps->nl_fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK,
+        NETLINK_KOBJECT_UEVENT);
+    if (ps->nl_fd < 0) {
+        return;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = UEVENT_KERNEL_GROUP;
+    if (bind(ps->nl_fd, (struct sockaddr*) &addr, sizeof(addr)) < 0) {
+        close(ps->nl_fd);
+        ps->nl_fd = -1;
+        return;
+    }
+    ps->watch = g_unix_fd_add(ps->nl_fd, G_IO_IN, power_supply_uevent, ps);
+}
+
 extern power_supply*
-power_supply_new() {
+power_supply_new(power_supply_func changed, gpointer data) {
     power_supply* tmp = g_new(power_supply, 1);
     tmp->ac_list = g_sequence_new(&ac_free);
     tmp->bat_list = g_sequence_new(&bat_free);
+    tmp->nl_fd = -1;
+    tmp->watch = 0;
+    tmp->changed = changed;
+    tmp->data = data;
+    power_supply_watch(tmp);
+    power_supply_scan(tmp);
     return tmp;
 }
 
 extern void
 power_supply_free(gpointer p) {
     power_supply* tmp = (power_supply*) p;
+    if (tmp->watch) {
+        g_source_remove(tmp->watch);
+    }
+    if (tmp->nl_fd >= 0) {
+        close(tmp->nl_fd);
+    }
     g_sequence_free(tmp->ac_list);
     g_sequence_free(tmp->bat_list);
     g_free(tmp);
@@ -253,55 +524,26 @@ power_supply_free(gpointer p) {
     }
 }
 
-/* Parses power supplies on the current system. */
-extern power_supply*
-power_supply_parse(power_supply* ps) {
-    GDir* dir = NULL;
-    const gchar* tmp;
-    GString* filename = g_string_sized_new(STRING_LEN);
-    guint len = 0;
-    gchar* contents;
-
-    if (g_file_test(SYS_ACPI_PATH, G_FILE_TEST_IS_DIR)) {
-        dir = g_dir_open(SYS_ACPI_PATH, 0, NULL);
-        if (dir != NULL) {
-            while ((tmp = g_dir_read_name(dir)) != NULL) {
-                g_string_append(filename, SYS_ACPI_PATH);
-                g_string_append(filename, tmp);
-                g_string_append_c(filename, G_DIR_SEPARATOR);
-                len = filename->len;
-                g_string_append(filename, SYS_ACPI_TYPE_FILE);
-                if (g_file_test(filename->str, G_FILE_TEST_IS_REGULAR)) {
-                    g_file_get_contents(filename->str, &contents, 0, NULL);
-                    g_string_truncate(filename, len);
-                    g_string_append(filename, SYS_ACPI_UEVENT_FILE);
-                    if (strcmp(SYS_ACPI_TYPE_AC, contents) == 0) {
-                        ac* tmp = ac_new(g_strdup(filename->str));
-                        ac_parse(tmp);
-                        g_sequence_append(ps->ac_list, tmp);
-                    } else if (strcmp(SYS_ACPI_TYPE_BAT, contents) == 0) {
-                        bat* tmp = bat_new(g_strdup(filename->str));
-                        bat_parse(tmp);
-                        g_sequence_append(ps->bat_list, tmp);
-                    } else {
-                        g_fprintf(stderr, "unsupported power supply type %s", contents);
-                    }
-                    g_free(contents);
-                }
-                g_string_truncate(filename, 0);
-            }
-            g_dir_close(dir);
-        }
-    }
-
-    g_string_free(filename, TRUE);
+/* Re-reads the uevent file of every indexed power supply. */
+extern void
+power_supply_update(power_supply* ps) {
+    GSequenceIter* it;
 
-    if (DEBUG) {
-        g_sequence_foreach(ps->ac_list, &ac_print, NULL);
-        g_sequence_foreach(ps->bat_list, &bat_print, NULL);
+    for (it = g_sequence_get_begin_iter(ps->ac_list); !g_sequence_iter_is_end(it);
+         it = g_sequence_iter_next(it)) {
+        ac_parse((ac*) g_sequence_get(it));
+    }
+    for (it = g_sequence_get_begin_iter(ps->bat_list); !g_sequence_iter_is_end(it);
+         it = g_sequence_iter_next(it)) {
+        bat_parse((bat*) g_sequence_get(it));
     }
+}
 
-    return ps;
+extern bat*
+power_supply_find_bat(power_supply* ps, const gchar* name)
+{
+    GSequenceIter* it = power_supply_find(ps->bat_list, name);
+    return it != NULL ? (bat*) g_sequence_get(it) : NULL;
 }
 
 extern gboolean
@@ -342,5 +584,8 @@ power_supply_get_bat_capacity(power_supply* ps)
             it = g_sequence_iter_next(it);
         }
     }
+    /* a uevent may have removed the last battery */
+    if (bat_count == 0)
+        return 0;
     return total_bat_capacity / bat_count;
 }
@@ -10,6 +10,8 @@ typedef struct {
     /* Path to uevent file. */
     gchar* path;
     gchar* name;
+    /* uevent file kept open for pread(); -1 if it could not be opened. */
+    int fd;
     gboolean online;
 } ac;
 
@@ -18,38 +20,81 @@ typedef struct {
     /* Path to uevent file. */
     gchar* path;
     gchar* name;
+    /* uevent file kept open for pread(); -1 if it could not be opened. */
+    int fd;
     gchar* status;
     /* In percent 0.0--100.0. */
     gdouble capacity;
+    /*
+     * Raw uevent readings in sysfs units (uWh, uW, uAh, uA, uV); -1 when
+     * the driver does not report them.  Drivers report either the energy_*
+     * and power_now set or the charge_* and current_now set.
+     */
+    gdouble energy_now;
+    gdouble energy_full;
+    gdouble energy_full_design;
+    gdouble power_now;
+    gdouble charge_now;
+    gdouble charge_full;
+    gdouble charge_full_design;
+    gdouble current_now;
+    gdouble voltage_now;
 } bat;
 
+/* Called after a kernel uevent changed the index. */
+typedef void (*power_supply_func)(gpointer data);
+
 /* Struct representing all the power supplies on current system. */
 typedef struct {
     /* List of ac structs. */
     GSequence* ac_list;
     /* List of bat structs. */
     GSequence* bat_list;
+    /* NETLINK_KOBJECT_UEVENT socket; -1 if unavailable. */
+    int nl_fd;
+    /* GLib source watching nl_fd; 0 if uevents are not available. */
+    guint watch;
+    power_supply_func changed;
+    gpointer data;
 } power_supply;
 
-/* Allocate memory for struct power_supply. */
-power_supply* power_supply_new();
+/*
+ * power_supply.c is linked into both the battery and batterytext plugins;
+ * the API is hidden so neither module binds to (and outlives) the other's
+ * copy.
+ */
+
+/*
+ * Allocate struct power_supply, index the power supplies on the current
+ * system once and subscribe to power_supply kernel uevents.  @changed
+ * (may be NULL) is called with @data whenever a uevent updated, added or
+ * removed a device.
+ */
+G_GNUC_INTERNAL power_supply* power_supply_new(power_supply_func changed, gpointer data);
 
 /* Free memory allocated by power_supply_new(). */
-void power_supply_free(gpointer p);
+G_GNUC_INTERNAL void power_supply_free(gpointer p);
+
+/*
+ * Re-read the uevent file of every indexed power supply.  Needed only for
+ * values the kernel does not announce (energy and charge drift between
+ * status changes) or when uevents are unavailable.
+ */
+G_GNUC_INTERNAL void power_supply_update(power_supply* ps);
 
-/* Parses power supplies on the current system. */
-power_supply* power_supply_parse();
+/* Return the indexed battery called @name (eg. "BAT0"), or NULL. */
+G_GNUC_INTERNAL bat* power_supply_find_bat(power_supply* ps, const gchar* name);
 
 /*
  * Return TRUE if AC power is on (ie. at least one AC adapter is on).
  */
-gboolean power_supply_is_ac_online(power_supply* ps);
+G_GNUC_INTERNAL gboolean power_supply_is_ac_online(power_supply* ps);
 
 /*
  * Return total BATTERY capacity (as percentage of capacity) on the
  * system as an average of all batteries capacity div by number of
- * batteries.
+ * batteries; 0 if no battery is indexed.
  */
-gdouble power_supply_get_bat_capacity(power_supply* ps);
+G_GNUC_INTERNAL gdouble power_supply_get_bat_capacity(power_supply* ps);
 
 #endif /* POWER_SUPPLY_H */
@@ -18,14 +18,18 @@
  *
  * Reads battery energy values from the Linux power supply sysfs interface
  * (default: /sys/class/power_supply/BAT0) and displays the charge ratio as
- * a coloured markup label.  Charging is shown in green with a '+' suffix;
+ * a coloured markup label.  The values come from the power supply index
+ * shared with the battery plugin (../battery/power_supply.c): one pread()
+ * of the battery's uevent file per poll, and immediate updates from kernel
+ * uevents on status changes such as AC plug/unplug.  Charging is shown in green with a '+' suffix;
  * discharging is shown in red with a '-' suffix.  The tooltip shows the
  * estimated remaining time (HH:MM:SS) computed from power_now.
  *
  * Config keys (all transfer-none xconf strings):
  *   DesignCapacity (bool, default false) — use energy_full_design instead
  *                  of energy_full as the 100% reference.
- *   PollingTimeMs  (int, ms, default 500) — update interval.
+ *   PollingTimeMs  (int, ms, default 60000 with uevents, 500 without) —
+ *                  re-read interval.
  *   TextSize       (str, default "medium") — Pango size string.
  *   BatteryPath    (str, default "/sys/class/power_supply/BAT0") — sysfs dir.
  *
@@ -40,6 +44,7 @@
 #include "panel.h"
 #include "misc.h"
 #include "plugin.h"
+#include "../battery/power_supply.h"
 
 //#define DEBUG
 
@@ -49,95 +54,58 @@ typedef struct {
     int time;        /**< Polling interval in milliseconds. */
     char *textsize;  /**< Pango size string (transfer-none, xconf-owned). */
     char *battery;   /**< Path to sysfs battery directory (transfer-none, xconf-owned). */
+    gchar *name;     /**< Battery device name, basename of battery (transfer full). */
+    power_supply *ps; /**< Power supply index; owns the uevent socket. */
     int timer;       /**< GLib timeout source ID; 0 when not active. */
     GtkWidget *main; /**< GtkLabel displaying charge %; owned by pwid. */
 } batterytext_priv;
 
 /**
- * read_bat_value - read a float from a sysfs battery file.
- * @dn: sysfs battery directory path. (transfer none)
- * @fn: filename within the directory (e.g., "energy_now"). (transfer none)
- *
- * Returns: the parsed float value, or -1 on error (file not found or parse
- * failure).
- */
-static float
-read_bat_value(const char *dn, const char *fn)
-{
-    FILE *fp;
-    float value = -1;
-    char value_path[256];
-    g_snprintf(value_path, sizeof(value_path), "%s/%s", dn, fn);
-    fp = fopen(value_path, "r");
-    if (fp != NULL) {
-        if (fscanf(fp, "%f", &value) != 1)
-            value = -1;
-        fclose(fp);
-    }
-    return value;
-}
-
-/**
- * text_update - read battery state and refresh the label and tooltip.
+ * text_update - refresh the label and tooltip from the power supply index.
  * @gm: batterytext_priv. (transfer none)
  *
- * Reads energy_full_design, energy_full, energy_now, power_now, and the
- * "status" file from gm->battery.  Computes the charge ratio and formats
- * a colour-coded markup string (red/green) for the label and an HH:MM:SS
+ * Looks up the configured battery in gm->ps and uses its
+ * energy_full_design, energy_full, energy_now, power_now and status
+ * readings (no file I/O).  Computes the charge ratio and formats a
+ * colour-coded markup string (red/green) for the label and an HH:MM:SS
  * estimate for the tooltip.  Both markup and tooltip strings are
  * transfer-full from g_markup_printf_escaped() and are g_free'd here.
  *
- * Called from the GLib timeout and once from the constructor.
+ * Called from text_poll(), from the uevent callback and once from the
+ * constructor.
  *
  * Returns: TRUE to keep the timeout active.
  */
 static int
 text_update(batterytext_priv *gm)
 {
-    FILE *fp_status;
-    char battery_status[256];
     char *markup;
     char *tooltip;
-    char buffer[256];
-    float energy_full_design = -1;
-    float energy_full = -1;
-    float energy_now = -1;
-    float power_now = -1;
+    bat *b;
     int discharging = 0;
     float charge_ratio = 0;
     int charge_time = 0;
 
-    energy_full_design = read_bat_value(gm->battery, "energy_full_design");
-    energy_full = read_bat_value(gm->battery, "energy_full");
-    energy_now = read_bat_value(gm->battery, "energy_now");
-    power_now = read_bat_value(gm->battery, "power_now");
-
-    snprintf(battery_status, sizeof(battery_status), "%s/status", gm->battery);
-    fp_status = fopen(battery_status, "r");
-    if (fp_status != NULL) {
-        while ((fgets(buffer, sizeof(buffer), fp_status)) != NULL) {
-            if (strstr(buffer, "Discharging") != NULL)
-                discharging = 1;
-        }
-        fclose(fp_status);
-    }
-
-    if ((energy_full_design >= 0) && (energy_now >= 0)) {
+    b = power_supply_find_bat(gm->ps, gm->name);
+    if (b && (b->energy_full_design >= 0) && (b->energy_now >= 0)) {
+        discharging = !g_strcmp0(b->status, "Discharging");
         if (gm->design)
-            charge_ratio = 100 * energy_now / energy_full_design;
+            charge_ratio = 100 * b->energy_now / b->energy_full_design;
         else
-            charge_ratio = 100 * energy_now / energy_full;
+            charge_ratio = 100 * b->energy_now / b->energy_full;
         if (discharging)
         {
             markup = g_markup_printf_escaped("<span size='%s' foreground='red'><b>%.2f-</b></span>",
                 gm->textsize, charge_ratio);
-            charge_time = (int)(energy_now / power_now * 3600);
+            if (b->power_now > 0)
+                charge_time = (int)(b->energy_now / b->power_now * 3600);
         }
         else
         {
             markup = g_markup_printf_escaped("<span size='%s' foreground='green'><b>%.2f+</b></span>",
                 gm->textsize, charge_ratio);
-            charge_time = (int)((energy_full - energy_now) / power_now * 3600);
+            if (b->power_now > 0)
+                charge_time = (int)((b->energy_full - b->energy_now) / b->power_now * 3600);
         }
         tooltip = g_markup_printf_escaped("%02d:%02d:%02d",
             charge_time / 3600, (charge_time / 60) % 60, charge_time % 60);
@@ -154,11 +122,37 @@ text_update(batterytext_priv *gm)
     return TRUE;
 }
 
+/**
+ * text_poll - GLib timeout: re-read the indexed uevent files, then update.
+ * @gm: batterytext_priv. (transfer none)
+ *
+ * Returns: TRUE to keep the timeout active.
+ */
+static int
+text_poll(batterytext_priv *gm)
+{
+    power_supply_update(gm->ps);
+    return text_update(gm);
+}
+
+/**
+ * text_changed - power supply uevent callback.
+ * @data: batterytext_priv. (transfer none)
+ *
+ * The index already holds the values carried by the uevent.
+ */
+static void
+text_changed(gpointer data)
+{
+    text_update((batterytext_priv *) data);
+}
+
 /**
  * batterytext_destructor - stop the polling timer.
  * @p: plugin_instance. (transfer none)
  *
- * Removes the GLib timeout.  The GtkLabel is owned by p->pwid.
+ * Removes the GLib timeout and frees the power supply index and device
+ * name.  The GtkLabel is owned by p->pwid.
  * Config strings (textsize, battery) are transfer-none xconf pointers
  * and must NOT be freed here.
  */
@@ -170,6 +164,8 @@ batterytext_destructor(plugin_instance *p)
     if (gm->timer) {
         g_source_remove(gm->timer);
     }
+    power_supply_free(gm->ps);
+    g_free(gm->name);
     return;
 }
 
@@ -178,9 +174,10 @@ batterytext_destructor(plugin_instance *p)
  * @p: plugin_instance allocated by the plugin framework. (transfer none)
  *
  * Reads config keys (all transfer-none; raw xconf pointers stored directly
- * in batterytext_priv without copying).  Creates a GtkLabel, calls
- * text_update() once for the initial display, then installs a GLib timeout
- * with PollingTimeMs interval.
+ * in batterytext_priv without copying).  Builds the power supply index
+ * (subscribing to uevents), creates a GtkLabel, calls text_update() once
+ * for the initial display, then installs a GLib timeout with PollingTimeMs
+ * interval.
  *
  * Returns: 1 on success.
  */
@@ -191,7 +188,7 @@ batterytext_constructor(plugin_instance *p)
 
     gm = (batterytext_priv *) p;
     gm->design = False;
-    gm->time = 500;
+    gm->time = 0;
     gm->textsize = "medium";
     gm->battery = "/sys/class/power_supply/BAT0";
 
@@ -200,13 +197,18 @@ batterytext_constructor(plugin_instance *p)
     XCG(p->xc, "TextSize", &gm->textsize, str);
     XCG(p->xc, "BatteryPath", &gm->battery, str);
 
+    gm->name = g_path_get_basename(gm->battery);
+    gm->ps = power_supply_new(text_changed, gm);
+    if (gm->time <= 0)
+        gm->time = gm->ps->watch ? 60000 : 500;
+
     gm->main = gtk_label_new(NULL);
     text_update(gm);
     gtk_container_set_border_width (GTK_CONTAINER (p->pwid), 1);
     gtk_container_add(GTK_CONTAINER(p->pwid), gm->main);
     gtk_widget_show_all(p->pwid);
     gm->timer = g_timeout_add((guint) gm->time,
-        (GSourceFunc) text_update, (gpointer) gm);
+        (GSourceFunc) text_poll, (gpointer) gm);
 
     return 1;
 }
@@ -216,7 +218,7 @@ static plugin_class class = {
     .count       = 0,
     .type        = "batterytext",
     .name        = "Generic Monitor",
-    .version     = "0.1",
+    .version     = "0.2",
     .description = "Display battery usage in text form",
     .priv_size   = sizeof(batterytext_priv),
 
@@ -34,9 +34,17 @@
  * "draw" signal handler renders coloured vertical lines from the bottom up,
  * then overlays a GTK theme frame.
  *
- * chart_class extends plugin_class with two virtual methods:
+ * chart_class extends plugin_class with four virtual methods:
  *   add_tick(c, val[]) — append a new tick (val[i] in [0.0..1.0] per row).
  *   set_rows(c, num, colors[]) — set the number of data rows and their colours.
+ *   set_autoscale(c, logscale, floor) — switch to auto-ranging mode.
+ *   get_stats(c, row, &peak, &avg) — peak/average of a row (auto-ranging only).
+ *
+ * Auto-ranging mode: add_tick() takes raw (unnormalised) values, which are
+ * kept in c->vals.  The full-scale value tracks a decaying peak of the
+ * stacked column sum over the visible history and is rounded up to a
+ * 1/2/5 step; stored samples are rescaled at render time, optionally on a
+ * log axis.  A faint half-scale gridline and a full-scale label are drawn.
  *
  * Config keys: none (all configuration is done by the subplugin).
  *
@@ -45,7 +53,8 @@
  * and rendering respectively.
  *
  * Memory: c->ticks is a 2D array (c->rows x c->w gint values), allocated by
- * chart_alloc_ticks() and freed by chart_free_ticks().  c->gc_cpu is an array
+ * chart_alloc_ticks() and freed by chart_free_ticks().  In auto-ranging mode
+ * c->vals (c->rows x c->w gfloat values) is allocated and freed alongside.  c->gc_cpu is an array
  * of c->rows GdkRGBA values (transfer-full, freed by chart_free_gcs()).
  */
 
@@ -55,6 +64,7 @@
 #include <time.h>
 #include <sys/sysinfo.h>
 #include <stdlib.h>
+#include <math.h>
 
 #include "plugin.h"
 #include "panel.h"
@@ -65,6 +75,9 @@
 //#define DEBUGPRN
 #include "dbg.h"
 
+/* Per-tick decay of the auto-range peak once the maximum scrolls out */
+#define CHART_PEAK_DECAY 0.9f
+
 
 static void chart_add_tick(chart_priv *c, float *val);
 static void chart_draw(chart_priv *c, cairo_t *cr);
@@ -75,6 +88,7 @@ static void chart_alloc_ticks(chart_priv *c);
 static void chart_free_ticks(chart_priv *c);
 static void chart_alloc_gcs(chart_priv *c, gchar *colors[]);
 static void chart_free_gcs(chart_priv *c);
+static gfloat chart_full_scale(chart_priv *c);
 
 /**
  * chart_add_tick - append one column of data values to the ring buffer.
@@ -84,14 +98,40 @@ static void chart_free_gcs(chart_priv *c);
  * Values are scaled to pixel heights (val[i] * c->h) and written at position
  * c->pos, which then advances modulo c->w.  The drawing area is invalidated
  * via gtk_widget_queue_draw().
+ *
+ * In auto-ranging mode @val holds raw values (negative clamped to 0) which
+ * are stored unscaled in c->vals; the decaying peak is then updated from
+ * the largest stacked column sum in the ring.
  */
 static void
 chart_add_tick(chart_priv *c, float *val)
 {
-    int i;
+    int i, j;
 
     if (!c->ticks)
         return;
+    if (c->autoscale) {
+        gfloat top, sum;
+
+        for (i = 0; i < c->rows; i++)
+            c->vals[i][c->pos] = MAX(val[i], 0);
+        c->pos = (c->pos + 1) % c->w;
+        if (c->filled < c->w)
+            c->filled++;
+        top = 0;
+        for (j = 0; j < c->w; j++) {
+            sum = 0;
+            for (i = 0; i < c->rows; i++)
+                sum += c->vals[i][j];
+            top = MAX(top, sum);
+        }
+        if (top < c->peak)
+            top = MAX(top, c->peak * CHART_PEAK_DECAY);
+        c->peak = MAX(top, c->floor);
+        DBG("peak=%f\n", c->peak);
+        gtk_widget_queue_draw(c->da);
+        return;
+    }
     for (i = 0; i < c->rows; i++) {
         if (val[i] < 0)
             val[i] = 0;
@@ -106,6 +146,113 @@ chart_add_tick(chart_priv *c, float *val)
     return;
 }
 
+/**
+ * chart_full_scale - round the auto-range peak up to a 1/2/5 step.
+ * @c: chart_priv in auto-ranging mode. (transfer none)
+ *
+ * Returns: the value mapped to the top of the chart.
+ */
+static gfloat
+chart_full_scale(chart_priv *c)
+{
+    gfloat step;
+
+    step = powf(10, floorf(log10f(c->peak)));
+    if (c->peak <= step)
+        return step;
+    if (c->peak <= 2 * step)
+        return 2 * step;
+    if (c->peak <= 5 * step)
+        return 5 * step;
+    return 10 * step;
+}
+
+/**
+ * chart_value_height - map a raw value to a pixel height (auto-ranging mode).
+ * @c:     chart_priv. (transfer none)
+ * @v:     raw value.
+ * @scale: full-scale value from chart_full_scale().
+ *
+ * Returns: height in pixels, clamped to [0..c->h].
+ */
+static int
+chart_value_height(chart_priv *c, gfloat v, gfloat scale)
+{
+    gfloat f;
+
+    if (c->logscale)
+        f = log1pf(v) / log1pf(scale);
+    else
+        f = v / scale;
+    return CLAMP(f, 0, 1) * c->h;
+}
+
+/**
+ * chart_format_value - format a raw value with a K/M/G suffix.
+ * @buf: output buffer. (transfer none)
+ * @len: size of @buf.
+ * @v:   raw value.
+ */
+static void
+chart_format_value(gchar *buf, int len, gfloat v)
+{
+    static const char sfx[] = { 0, 'K', 'M', 'G', 'T' };
+    int i;
+
+    for (i = 0; v >= 1024 && i < (int) G_N_ELEMENTS(sfx) - 1; i++)
+        v /= 1024;
+    if (v < 10 && i)
+        g_snprintf(buf, len, "%.1f%c", v, sfx[i]);
+    else if (i)
+        g_snprintf(buf, len, "%.0f%c", v, sfx[i]);
+    else
+        g_snprintf(buf, len, "%.0f", v);
+}
+
+/**
+ * chart_draw_scale - draw the half-scale gridline and the full-scale label.
+ * @c:      chart_priv in auto-ranging mode. (transfer none)
+ * @widget: the drawing area. (transfer none)
+ * @cr:     Cairo context. (transfer none)
+ *
+ * Both are drawn in the theme foreground colour at low alpha so they stay
+ * behind the data visually.
+ */
+static void
+chart_draw_scale(chart_priv *c, GtkWidget *widget, cairo_t *cr)
+{
+    GtkStyleContext *ctx;
+    PangoLayout *layout;
+    PangoFontDescription *desc;
+    GdkRGBA fg;
+    gchar buf[16];
+    gfloat scale, half;
+    int y;
+
+    scale = chart_full_scale(c);
+    half = c->logscale ? expm1f(log1pf(scale) / 2) : scale / 2;
+    ctx = gtk_widget_get_style_context(widget);
+    gtk_style_context_get_color(ctx, gtk_style_context_get_state(ctx), &fg);
+    fg.alpha *= 0.35;
+    gdk_cairo_set_source_rgba(cr, &fg);
+
+    y = c->h - 2 - chart_value_height(c, half, scale);
+    cairo_set_line_width(cr, 1);
+    cairo_move_to(cr, c->fx, y + 0.5);
+    cairo_line_to(cr, c->fx + c->fw, y + 0.5);
+    cairo_stroke(cr);
+
+    chart_format_value(buf, sizeof(buf), scale);
+    layout = gtk_widget_create_pango_layout(widget, buf);
+    desc = pango_font_description_from_string("Sans 6");
+    pango_layout_set_font_description(layout, desc);
+    pango_font_description_free(desc);
+    cairo_move_to(cr, c->fx + 2, c->fy);
+    pango_cairo_show_layout(cr, layout);
+    g_object_unref(layout);
+    return;
+}
+
 /**
  * chart_draw - render the tick ring buffer as vertical coloured lines.
  * @c:  chart_priv. (transfer none)
@@ -113,20 +260,34 @@ chart_add_tick(chart_priv *c, float *val)
  *
  * Draws columns from left to right; within each column stacks data rows
  * from the bottom up, each row rendered in its GdkRGBA colour.
+ *
+ * In auto-ranging mode the pixel heights are derived from c->vals against
+ * the current full scale; each row's segment is the difference between
+ * the heights of the cumulative sums, so stacking also holds on a log axis.
  */
 static void
 chart_draw(chart_priv *c, cairo_t *cr)
 {
-    int j, i, y;
+    int j, i, y, prev;
+    gfloat scale = 0, sum;
 
     if (!c->ticks || !c->gc_cpu)
         return;
+    if (c->autoscale)
+        scale = chart_full_scale(c);
     for (i = 1; i < c->w-1; i++) {
         y = c->h-2;
+        prev = 0;
+        sum = 0;
         for (j = 0; j < c->rows; j++) {
             int val;
 
-            val = c->ticks[j][(i + c->pos) % c->w];
+            if (c->autoscale) {
+                sum += c->vals[j][(i + c->pos) % c->w];
+                val = chart_value_height(c, sum, scale) - prev;
+                prev += val;
+            } else
+                val = c->ticks[j][(i + c->pos) % c->w];
             if (val) {
                 gdk_cairo_set_source_rgba(cr, &c->gc_cpu[j]);
                 cairo_move_to(cr, i, y);
@@ -189,8 +350,8 @@ chart_size_allocate(GtkWidget *widget, GtkAllocation *a, chart_priv *c)
  * @cr:     Cairo context. (transfer none)
  * @c:      chart_priv. (transfer none)
  *
- * Calls chart_draw() for the data lines then gtk_render_frame() for the
- * GTK theme border.
+ * Calls chart_draw() for the data lines, the scale overlay in auto-ranging
+ * mode, then gtk_render_frame() for the GTK theme border.
  *
  * Returns: FALSE (allow further drawing).
  */
@@ -199,6 +360,8 @@ chart_draw_event(GtkWidget *widget, cairo_t *cr, chart_priv *c)
 {
     GtkStyleContext *ctx;
     chart_draw(c, cr);
+    if (c->autoscale && c->ticks)
+        chart_draw_scale(c, widget, cr);
 
     ctx = gtk_widget_get_style_context(widget);
     gtk_render_frame(ctx, cr, c->fx, c->fy, c->fw, c->fh);
@@ -211,7 +374,8 @@ chart_draw_event(GtkWidget *widget, cairo_t *cr, chart_priv *c)
  * @c: chart_priv with c->rows and c->w already set. (transfer none)
  *
  * Allocates c->ticks as an array of c->rows pointers, each to a c->w gint
- * array.  Resets c->pos to 0.  No-op if c->w or c->rows is zero.
+ * array, plus the matching c->vals array in auto-ranging mode.  Resets
+ * c->pos, c->filled and c->peak.  No-op if c->w or c->rows is zero.
  */
 static void
 chart_alloc_ticks(chart_priv *c)
@@ -226,7 +390,14 @@ chart_alloc_ticks(chart_priv *c)
         if (!c->ticks[i])
             DBG2("can't alloc mem: %p %d\n", c->ticks[i], c->w);
     }
+    if (c->autoscale) {
+        c->vals = g_new0(gfloat *, c->rows);
+        for (i = 0; i < c->rows; i++)
+            c->vals[i] = g_new0(gfloat, c->w);
+    }
     c->pos = 0;
+    c->filled = 0;
+    c->peak = c->floor;
     return;
 }
 
@@ -235,8 +406,8 @@ chart_alloc_ticks(chart_priv *c)
  * chart_free_ticks - free the 2D tick ring buffer.
  * @c: chart_priv. (transfer none)
  *
- * Frees each row array and then the pointer array.  Sets c->ticks = NULL.
- * No-op if c->ticks is already NULL.
+ * Frees each row array and then the pointer array, for c->ticks and (if
+ * allocated) c->vals.  Sets both to NULL.  No-op if c->ticks is already NULL.
  */
 static void
 chart_free_ticks(chart_priv *c)
@@ -249,6 +420,12 @@ chart_free_ticks(chart_priv *c)
         g_free(c->ticks[i]);
     g_free(c->ticks);
     c->ticks = NULL;
+    if (c->vals) {
+        for (i = 0; i < c->rows; i++)
+            g_free(c->vals[i]);
+        g_free(c->vals);
+        c->vals = NULL;
+    }
     return;
 }
 
@@ -316,6 +493,57 @@ chart_set_rows(chart_priv *c, int num, gchar *colors[])
     return;
 }
 
+/**
+ * chart_set_autoscale - switch the chart to auto-ranging mode.
+ * @c:        chart_priv. (transfer none)
+ * @logscale: TRUE to map values on a log1p axis instead of a linear one.
+ * @floor:    smallest full-scale value (keeps idle charts from zooming into
+ *            noise); must be > 0.
+ *
+ * After this call add_tick() expects raw values instead of [0..1] fractions.
+ * Reallocates the tick buffers so the raw sample ring exists.  May be called
+ * before or after chart_set_rows().
+ */
+static void
+chart_set_autoscale(chart_priv *c, gboolean logscale, gfloat floor)
+{
+    g_assert(floor > 0);
+    chart_free_ticks(c);
+    c->autoscale = TRUE;
+    c->logscale = logscale;
+    c->floor = floor;
+    chart_alloc_ticks(c);
+    return;
+}
+
+/**
+ * chart_get_stats - peak and average of one row over the visible history.
+ * @c:    chart_priv in auto-ranging mode. (transfer none)
+ * @row:  data row index.
+ * @peak: (out) largest raw sample of @row.
+ * @avg:  (out) mean of the raw samples of @row.
+ *
+ * Only the c->filled columns written so far are considered.  Both outputs
+ * are 0 in fixed-scale mode or before the first tick.
+ */
+static void
+chart_get_stats(chart_priv *c, int row, gfloat *peak, gfloat *avg)
+{
+    gfloat sum = 0, top = 0;
+    int i;
+
+    *peak = *avg = 0;
+    if (!c->vals || !c->filled || row < 0 || row >= c->rows)
+        return;
+    for (i = 0; i < c->w; i++) {
+        sum += c->vals[row][i];
+        top = MAX(top, c->vals[row][i]);
+    }
+    *peak = top;
+    *avg = sum / c->filled;
+    return;
+}
+
 /**
  * chart_constructor - initialise the chart drawing area inside p->pwid.
  * @p: plugin_instance. (transfer none)
@@ -336,6 +564,8 @@ chart_constructor(plugin_instance *p)
     c = (chart_priv *) p;
     c->rows = 0;
     c->ticks = NULL;
+    c->vals = NULL;
+    c->autoscale = FALSE;
     c->gc_cpu = NULL;
     c->da = p->pwid;
 
@@ -378,5 +608,7 @@ static chart_class class = {
     },
     .add_tick = chart_add_tick,
     .set_rows = chart_set_rows,
+    .set_autoscale = chart_set_autoscale,
+    .get_stats = chart_get_stats,
 };
 static plugin_class *class_ptr = (plugin_class *) &class;
@@ -17,12 +17,22 @@ typedef struct {
     gint w, h, rows;
     GdkRectangle area; /* frame area and exact positions */
     int fx, fy, fw, fh; 
+
+    /* auto-ranging mode, see chart_set_autoscale() */
+    gfloat **vals;     /* raw samples, same ring layout as ticks */
+    gint filled;       /* number of valid columns in vals */
+    gboolean autoscale;
+    gboolean logscale;
+    gfloat peak;       /* decaying peak of the stacked column sum */
+    gfloat floor;      /* smallest allowed full-scale value */
 } chart_priv;
 
 typedef struct {
     plugin_class plugin;
     void (*add_tick)(chart_priv *c, float *val);
     void (*set_rows)(chart_priv *c, int num, gchar *colors[]);
+    void (*set_autoscale)(chart_priv *c, gboolean logscale, gfloat floor);
+    void (*get_stats)(chart_priv *c, int row, gfloat *peak, gfloat *avg);
 } chart_class;
 
 
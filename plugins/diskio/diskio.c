@@ -0,0 +1,301 @@
+/**
+ * @file diskio.c
+ * @brief Disk I/O throughput and latency scrolling chart plugin for fbpanel.
+ *
+ * Displays a scrolling chart of disk read and write throughput using the
+ * chart_class base plugin in auto-ranging mode.  The data source is
+ * /proc/diskstats, kept open and re-read with pread() every 2 seconds.
+ *
+ * Devices are selected by a space-separated list of glob patterns matched
+ * against the diskstats device name (whole disks by default, so partitions
+ * are not counted twice).  Matching devices are either aggregated into one
+ * read/write row pair or, with PerDevice, charted as one read/write row
+ * pair each (first DISKIO_MAX_DEVS devices found at start-up).
+ *
+ * The tooltip shows read/write KB/s, the average latency per completed I/O
+ * (ms spent reading + writing / I/Os completed) and the busy percentage
+ * (ms spent doing I/O / elapsed ms, averaged over aggregated devices).
+ *
+ * Config keys (transfer-none xconf strings unless noted):
+ *   Devices    (str, default "sd? vd? hd? xvd? nvme?n? mmcblk?") — globs.
+ *   PerDevice  (bool, default false)   — one row pair per device.
+ *   ReadColor  (str, default "green")  — chart colour for reads.
+ *   WriteColor (str, default "red")    — chart colour for writes.
+ *
+ * Delegates construction and destruction to chart_class (obtained via
+ * class_get("chart")/class_put("chart")).
+ */
+
+#include "../chart/chart.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+//#define DEBUGPRN
+#include "dbg.h"
+
+#define CHECK_PERIOD    2 /* second */
+#define DISKSTATS_PATH  "/proc/diskstats"
+#define DISKIO_MAX_DEVS 4 /* chart_class allows at most 9 rows */
+#define DISKIO_FLOOR    65536 /* B/s; smallest auto-range full scale */
+#define SECTOR_SIZE     512 /* diskstats always counts 512-byte sectors */
+
+struct disk_stat {
+    gulong rios, rsect, rms;  /**< Reads completed, sectors read, ms reading. */
+    gulong wios, wsect, wms;  /**< Writes completed, sectors written, ms writing. */
+    gulong ioms;              /**< ms spent doing I/O. */
+};
+
+typedef struct {
+    chart_priv chart;        /**< Embedded chart_priv; must be first member. */
+    int timer;               /**< GLib timeout source ID. */
+    int fd;                  /**< /proc/diskstats descriptor; -1 if unavailable. */
+    gchar *devices;          /**< Device glob list (transfer-none, xconf-owned). */
+    GPatternSpec **pats;     /**< Compiled globs, NULL-terminated. */
+    int per_device;          /**< Boolean: one row pair per device. */
+    int ndev;                /**< Number of tracked devices (PerDevice). */
+    int nmatched;            /**< Devices matched by the last read. */
+    gchar names[DISKIO_MAX_DEVS][32]; /**< Tracked device names (PerDevice). */
+    struct disk_stat prev[DISKIO_MAX_DEVS]; /**< Counters from previous poll. */
+    gchar *colors[2 * DISKIO_MAX_DEVS]; /**< Row colours, read/write alternating. */
+} diskio_priv;
+
+static chart_class *k;
+
+
+/**
+ * diskio_match - test a device name against the configured globs.
+ * @c:    diskio_priv. (transfer none)
+ * @name: diskstats device name.
+ *
+ * Returns: TRUE if any pattern matches.
+ */
+static gboolean
+diskio_match(diskio_priv *c, const gchar *name)
+{
+    GPatternSpec **p;
+
+    for (p = c->pats; *p; p++)
+        if (g_pattern_match_string(*p, name))
+            return TRUE;
+    return FALSE;
+}
+
+/**
+ * diskio_read - read /proc/diskstats and accumulate counters.
+ * @c:        diskio_priv. (transfer none)
+ * @st:       (out) DISKIO_MAX_DEVS counters; per device in PerDevice mode,
+ *            otherwise the sum of all matching devices in st[0].
+ * @discover: in PerDevice mode, add newly seen matching devices to
+ *            c->names (up to DISKIO_MAX_DEVS).  Used once at start-up.
+ *
+ * Returns: 0 on success, -1 if the file could not be read.
+ */
+static int
+diskio_read(diskio_priv *c, struct disk_stat *st, gboolean discover)
+{
+    char buf[32768], name[32];
+    char *line, *next;
+    struct disk_stat d, *t;
+    ssize_t n;
+    int i;
+
+    memset(st, 0, sizeof(*st) * DISKIO_MAX_DEVS);
+    c->nmatched = 0;
+    if (c->fd < 0)
+        return -1;
+    n = pread(c->fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0)
+        return -1;
+    buf[n] = 0;
+
+    for (line = buf; *line; line = next) {
+        if ((next = strchr(line, '\n')))
+            *next++ = 0;
+        else
+            next = line + strlen(line);
+        if (sscanf(line, "%*u %*u %31s %lu %*u %lu %lu %lu %*u %lu %lu %*u %lu",
+                name, &d.rios, &d.rsect, &d.rms,
+                &d.wios, &d.wsect, &d.wms, &d.ioms) != 8)
+            continue;
+        if (!diskio_match(c, name))
+            continue;
+        if (c->per_device) {
+            for (i = 0; i < c->ndev && strcmp(c->names[i], name); i++)
+                ;
+            if (i == c->ndev) {
+                if (!discover || c->ndev == DISKIO_MAX_DEVS)
+                    continue;
+                g_strlcpy(c->names[c->ndev++], name, sizeof(c->names[0]));
+            }
+            t = &st[i];
+        } else
+            t = &st[0];
+        t->rios += d.rios;
+        t->rsect += d.rsect;
+        t->rms += d.rms;
+        t->wios += d.wios;
+        t->wsect += d.wsect;
+        t->wms += d.wms;
+        t->ioms += d.ioms;
+        c->nmatched++;
+    }
+    return 0;
+}
+
+/* difference of two cumulative counters; 0 if the counter went backwards */
+#define DELTA(f) (cur->f >= prev->f ? cur->f - prev->f : 0)
+
+/**
+ * diskio_update - compute per-second rates and push a chart tick.
+ * @c: diskio_priv. (transfer none)
+ *
+ * Pushes read and write B/s for each row pair and rebuilds the tooltip
+ * with throughput, average latency and busy percentage.
+ *
+ * Called from the 2-second GLib timeout and once from the constructor.
+ *
+ * Returns: TRUE to keep the timeout active.
+ */
+static gboolean
+diskio_update(diskio_priv *c)
+{
+    struct disk_stat now[DISKIO_MAX_DEVS], *cur, *prev;
+    float total[2 * DISKIO_MAX_DEVS];
+    gulong rbps, wbps, ios, ioms;
+    GString *str;
+    int i, n, busy_div;
+
+    n = c->per_device ? MAX(c->ndev, 1) : 1;
+    memset(total, 0, sizeof(total));
+    str = g_string_sized_new(200);
+    if (diskio_read(c, now, FALSE)) {
+        g_string_append(str, "<b>Disk I/O:</b> " DISKSTATS_PATH " unavailable");
+        goto end;
+    }
+    busy_div = c->per_device ? 1 : MAX(c->nmatched, 1);
+    if (!c->per_device)
+        g_string_append_printf(str, "<b>Disk I/O</b> (%s)", c->devices);
+    for (i = 0; i < n; i++) {
+        cur = &now[i];
+        prev = &c->prev[i];
+        rbps = DELTA(rsect) * SECTOR_SIZE / CHECK_PERIOD;
+        wbps = DELTA(wsect) * SECTOR_SIZE / CHECK_PERIOD;
+        ios = DELTA(rios) + DELTA(wios);
+        ioms = DELTA(rms) + DELTA(wms);
+        total[2 * i] = rbps;
+        total[2 * i + 1] = wbps;
+        if (c->per_device)
+            g_string_append_printf(str, "%s<b>%s</b>", i ? "\n" : "",
+                c->ndev ? c->names[i] : "no device");
+        g_string_append_printf(str,
+            "\nR %lu KB/s, W %lu KB/s\nLatency %.1f ms, busy %lu%%",
+            rbps >> 10, wbps >> 10, ios ? (gfloat) ioms / ios : 0.0,
+            MIN(DELTA(ioms) / (CHECK_PERIOD * 10) / busy_div, 100));
+    }
+    memcpy(c->prev, now, sizeof(now));
+
+end:
+    k->add_tick(&c->chart, total);
+    gtk_widget_set_tooltip_markup(((plugin_instance *)c)->pwid, str->str);
+    g_string_free(str, TRUE);
+    return TRUE;
+}
+
+/**
+ * diskio_constructor - initialise the disk I/O chart plugin on top of
+ *   chart_class.
+ * @p: plugin_instance. (transfer none)
+ *
+ * Obtains chart_class via class_get("chart"), calls its constructor, reads
+ * config keys (transfer-none) and compiles the device globs.  Opens
+ * /proc/diskstats once, primes the previous counters (discovering devices
+ * in PerDevice mode), configures the auto-ranging rows and installs a
+ * 2-second GLib timeout.
+ *
+ * Returns: 1 on success, 0 if chart class is unavailable.
+ */
+static int
+diskio_constructor(plugin_instance *p)
+{
+    diskio_priv *c;
+    gchar *read_color, *write_color;
+    gchar **globs;
+    int i, n, rows;
+
+    if (!(k = class_get("chart")))
+        return 0;
+    if (!PLUGIN_CLASS(k)->constructor(p))
+        return 0;
+    c = (diskio_priv *) p;
+
+    c->devices = "sd? vd? hd? xvd? nvme?n? mmcblk?";
+    read_color = "green";
+    write_color = "red";
+    XCG(p->xc, "Devices", &c->devices, str);
+    XCG(p->xc, "PerDevice", &c->per_device, enum, bool_enum);
+    XCG(p->xc, "ReadColor", &read_color, str);
+    XCG(p->xc, "WriteColor", &write_color, str);
+
+    globs = g_strsplit_set(c->devices, " \t,", -1);
+    c->pats = g_new0(GPatternSpec *, g_strv_length(globs) + 1);
+    for (i = n = 0; globs[i]; i++)
+        if (*globs[i])
+            c->pats[n++] = g_pattern_spec_new(globs[i]);
+    g_strfreev(globs);
+
+    c->fd = open(DISKSTATS_PATH, O_RDONLY | O_CLOEXEC);
+    if (c->fd < 0)
+        ERR("diskio: can't open %s\n", DISKSTATS_PATH);
+    diskio_read(c, c->prev, TRUE);
+
+    rows = c->per_device ? 2 * MAX(c->ndev, 1) : 2;
+    for (i = 0; i < rows; i++)
+        c->colors[i] = (i & 1) ? write_color : read_color;
+    k->set_rows(&c->chart, rows, c->colors);
+    k->set_autoscale(&c->chart, FALSE, DISKIO_FLOOR);
+    gtk_widget_set_tooltip_markup(((plugin_instance *)c)->pwid,
+        "<b>Disk I/O</b>");
+    diskio_update(c);
+    c->timer = g_timeout_add(CHECK_PERIOD * 1000,
+        (GSourceFunc) diskio_update, (gpointer) c);
+    return 1;
+}
+
+
+/**
+ * diskio_destructor - stop the timer, close diskstats, release chart_class.
+ * @p: plugin_instance. (transfer none)
+ */
+static void
+diskio_destructor(plugin_instance *p)
+{
+    diskio_priv *c = (diskio_priv *) p;
+    GPatternSpec **pat;
+
+    if (c->timer)
+        g_source_remove(c->timer);
+    if (c->fd >= 0)
+        close(c->fd);
+    for (pat = c->pats; *pat; pat++)
+        g_pattern_spec_free(*pat);
+    g_free(c->pats);
+    PLUGIN_CLASS(k)->destructor(p);
+    class_put("chart");
+    return;
+}
+
+
+static plugin_class class = {
+    .count       = 0,
+    .type        = "diskio",
+    .name        = "Disk I/O",
+    .version     = "1.0",
+    .description = "Display disk throughput and latency",
+    .priv_size   = sizeof(diskio_priv),
+
+    .constructor = diskio_constructor,
+    .destructor  = diskio_destructor,
+};
+static plugin_class *class_ptr = (plugin_class *) &class;
@@ -12,103 +12,636 @@
  * GNU General Public License for more details.
  */
 
+
 /**
  * @file genmon.c
  * @brief Generic monitor plugin: runs a shell command and displays its output.
  *
- * Runs an arbitrary shell command via popen() at a configurable interval,
- * reads the first line of stdout, and displays it as a Pango markup label
- * in the panel.  The label text is formatted with a configurable font size
- * and colour.
+ * Runs an arbitrary shell command via GSubprocess ("/bin/sh -c Command") at a
+ * configurable interval and displays its output as a Pango markup label in
+ * the panel.  The label text is formatted with a configurable font size and
+ * colour.
+ *
+ * Nothing blocks the GTK main thread: stdout is read with
+ * g_data_input_stream_read_line_async() and the exit is collected with
+ * g_subprocess_wait_async().  A poll is skipped while the previous run is
+ * still in flight, and a run exceeding Timeout seconds is killed.
+ *
+ * Stream mode (Stream = true) starts Command once and keeps it running;
+ * every line it prints replaces the label, so there is no per-poll
+ * fork/exec.  If the command exits it is restarted after PollingTime
+ * seconds.
+ *
+ * RESULT SHARING
+ * --------------
+ * Runs are owned by a genmon_job, not by the plugin instance.  Jobs live
+ * in a module-wide hash table keyed by (PollingTime, Stream, Format class,
+ * Command); instances with the same key subscribe to one job, so N panels
+ * or labels polling the same script cost one fork/exec per period.  Every
+ * subscriber is handed the job's output and picks what it shows.
+ *
+ * OUTPUT FORMATS
+ * --------------
+ *   line     — the first line of output (stream: each line).  Default.
+ *   keyvalue — "key=value" pairs separated by newlines or ';'; the label
+ *              shows the value of Field.
+ *   json     — a JSON object; the label shows the top-level member Field
+ *              (strings unescaped, other values verbatim).
+ * In polled mode the structured formats read the whole output; in stream
+ * mode each line is one record.  Without Field the first line is shown.
  *
  * Config keys (all transfer-none; stored as raw xconf pointers):
  *   Command       (str, default "date +%R") — shell command to run.
  *   TextSize      (str, default "medium")   — Pango size string.
  *   TextColor     (str, default "darkblue") — CSS/Pango colour name or hex.
- *   PollingTime   (int, seconds, default 1) — update interval.
+ *   PollingTime   (int, seconds, default 1) — update interval (restart
+ *                 delay in stream mode).
  *   MaxTextLength (int, chars, default 30)  — gtk_label_set_max_width_chars.
+ *   Timeout       (int, seconds, default 10) — kill a polled run after this
+ *                 long; 0 disables.  Not used in stream mode.  Taken from
+ *                 the instance that created the job.
+ *   Stream        (bool, default false)     — keep one command running and
+ *                 show each line it prints.
+ *   Format        (enum line/keyvalue/json, default line) — output format.
+ *   Field         (str, optional)           — key to display (keyvalue/json).
  *
  * Main widget: GtkLabel (gm->main), packed into p->pwid.
+ *
+ * Ownership: job->proc, job->out and job->cancel are transfer-full GObject
+ * references for the current run.  Each run gets its own GCancellable,
+ * cancelled on overrun and when the last subscriber leaves; async
+ * callbacks of a cancelled run check for G_IO_ERROR_CANCELLED before
+ * touching the job (which may already be freed, or busy with a newer run).
  */
 
 #include <sys/types.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <gio/gio.h>
 
 #include "panel.h"
 #include "misc.h"
 #include "plugin.h"
 
-//#define DEBUG
+//#define DEBUGPRN
+#include "dbg.h"
 
 #define FMT "<span size='%s' foreground='%s'>%s</span>"
 
+enum { GM_LINE, GM_KEYVALUE, GM_JSON };
+
+static xconf_enum format_enum[] = {
+    { .num = GM_LINE, .str = "line" },
+    { .num = GM_KEYVALUE, .str = "keyvalue" },
+    { .num = GM_JSON, .str = "json" },
+    { .num = 0, .str = NULL },
+};
+
+typedef struct {
+    gchar *key;             /**< Hash key (transfer full); see genmon_job_key(). */
+    gchar *command;         /**< Shell command (transfer full copy). */
+    int time;               /**< Polling interval / restart delay in seconds. */
+    int timeout;            /**< Kill a polled run after this long; 0 = never. */
+    int stream;             /**< Boolean: stream mode. */
+    int whole;              /**< Boolean: polled run reads all output, not one line. */
+    int timer;              /**< Poll (or stream restart) source ID; 0 when none. */
+    guint kill_timer;       /**< Timeout source ID for Timeout; 0 when none. */
+    GSubprocess *proc;      /**< Running command; NULL when idle. */
+    GDataInputStream *out;  /**< Line reader on proc's stdout; NULL when idle. */
+    GCancellable *cancel;   /**< Cancels the current run's async I/O. */
+    GString *acc;           /**< Output collected by the current run. */
+    gchar *result;          /**< Last complete output (transfer full); NULL before. */
+    GSList *subs;           /**< Subscribed genmon_priv (transfer none). */
+} genmon_job;
+
 typedef struct {
     plugin_instance plugin;
     int time;        /**< Polling interval in seconds (from PollingTime). */
-    int timer;       /**< GLib timeout source ID; 0 when not active. */
     int max_text_len;/**< Maximum label width in characters. */
+    int timeout;     /**< Kill a polled run after this many seconds; 0 = never. */
+    int stream;      /**< Boolean: stream mode (from Stream). */
+    int format;      /**< GM_LINE, GM_KEYVALUE or GM_JSON (from Format). */
+    char *field;     /**< Field to display (transfer none, xconf-owned). */
     char *command;   /**< Shell command to run (transfer none, xconf-owned). */
     char *textsize;  /**< Pango size string (transfer none, xconf-owned). */
     char *textcolor; /**< Colour string (transfer none, xconf-owned). */
     GtkWidget *main; /**< GtkLabel displaying command output; owned by pwid. */
+    genmon_job *job; /**< Shared job this instance subscribes to. */
 } genmon_priv;
 
+/* Jobs by genmon_job_key(); created with the first job, destroyed with the last */
+static GHashTable *jobs;
+
+static gboolean genmon_job_run(genmon_job *job);
+static void genmon_line_ready(GObject *src, GAsyncResult *res, gpointer data);
+
 /**
- * text_update - run the command and update the label markup.
- * @gm: genmon_priv instance. (transfer none)
+ * kv_get_field - look up @field in "key=value" pairs.
+ * @s:     pairs separated by newlines or ';'. (transfer none)
+ * @field: key to find. (transfer none)
  *
- * Opens gm->command via popen(), reads one line from stdout, strips the
- * trailing newline, formats it with g_markup_printf_escaped() using the
- * configured size and colour, and sets the label markup.  The markup string
- * is transfer-full from g_markup_printf_escaped() and is g_free'd here.
+ * Whitespace around keys and values is ignored.
  *
- * Called from the GLib timeout and once from the constructor.
+ * Returns: (transfer full) the value, or NULL if @field is absent.
+ */
+static gchar *
+kv_get_field(const gchar *s, const gchar *field)
+{
+    gchar **pairs, *eq, *ret = NULL;
+    int i;
+
+    pairs = g_strsplit_set(s, "\n;", -1);
+    for (i = 0; pairs[i] && !ret; i++) {
+        if (!(eq = strchr(pairs[i], '=')))
+            continue;
+        *eq = 0;
+        if (!strcmp(g_strstrip(pairs[i]), field))
+            ret = g_strdup(g_strstrip(eq + 1));
+    }
+    g_strfreev(pairs);
+    return ret;
+}
+
+/**
+ * json_skip_ws - advance past JSON whitespace.
+ */
+static const gchar *
+json_skip_ws(const gchar *s)
+{
+    while (*s == ' ' || *s == '\t' || *s == '\n' || *s == '\r')
+        s++;
+    return s;
+}
+
+/**
+ * json_string - parse a JSON string literal.
+ * @s:   points at the opening quote. (transfer none)
+ * @out: (out) (transfer full) unescaped contents if non-NULL.
  *
- * Returns: TRUE to keep the timeout active.
+ * Handles the standard escapes including \uXXXX (surrogate pairs are
+ * not combined).
+ *
+ * Returns: pointer past the closing quote, or NULL on a malformed string.
  */
-static int
-text_update(genmon_priv *gm)
-{
-    FILE *fp;
-    char text[256];
-    char *markup;
-    int len;
-
-    fp = popen(gm->command, "r");
-    (void)fgets(text, sizeof(text), fp);
-    pclose(fp);
-    len = strlen(text) - 1;
-    if (len >= 0) {
-        if (text[len] == '\n')
-            text[len] = 0;
-
-        markup = g_markup_printf_escaped(FMT, gm->textsize, gm->textcolor,
-            text);
-        gtk_label_set_markup (GTK_LABEL(gm->main), markup);
-        g_free(markup);
+static const gchar *
+json_string(const gchar *s, gchar **out)
+{
+    GString *str = out ? g_string_new(NULL) : NULL;
+    gunichar u;
+
+    for (s++; *s && *s != '"'; s++) {
+        if (*s != '\\') {
+            if (str)
+                g_string_append_c(str, *s);
+            continue;
+        }
+        switch (*++s) {
+        case 'n': u = '\n'; break;
+        case 't': u = '\t'; break;
+        case 'r': u = '\r'; break;
+        case 'b': u = '\b'; break;
+        case 'f': u = '\f'; break;
+        case 'u':
+            if (!g_ascii_isxdigit(s[1]) || !g_ascii_isxdigit(s[2])
+                || !g_ascii_isxdigit(s[3]) || !g_ascii_isxdigit(s[4]))
+                goto bad;
+            u = (g_ascii_xdigit_value(s[1]) << 12)
+                | (g_ascii_xdigit_value(s[2]) << 8)
+                | (g_ascii_xdigit_value(s[3]) << 4)
+                | g_ascii_xdigit_value(s[4]);
+            s += 4;
+            break;
+        case 0:
+            goto bad;
+        default: u = *s; break;
+        }
+        if (str)
+            g_string_append_unichar(str, u);
+    }
+    if (*s != '"')
+        goto bad;
+    if (out)
+        *out = g_string_free(str, FALSE);
+    return s + 1;
+
+bad:
+    if (str)
+        g_string_free(str, TRUE);
+    return NULL;
+}
+
+/**
+ * json_skip_value - skip one JSON value of any type.
+ * @s: points at the value. (transfer none)
+ *
+ * Objects and arrays are skipped by bracket depth, honouring strings;
+ * numbers and literals run up to the next delimiter (',', '}', ']',
+ * whitespace or the end of the text).
+ *
+ * Returns: pointer past the value, or NULL on malformed input.
+ */
+static const gchar *
+json_skip_value(const gchar *s)
+{
+    const gchar *e;
+    int depth = 0;
+
+    if (*s == '"')
+        return json_string(s, NULL);
+    if (*s != '{' && *s != '[') {
+        e = s + strcspn(s, ",}] \t\r\n");
+        return e == s ? NULL : e;
+    }
+    do {
+        if (*s == '"') {
+            if (!(s = json_string(s, NULL)))
+                return NULL;
+            continue;
+        }
+        if (*s == '{' || *s == '[')
+            depth++;
+        else if (*s == '}' || *s == ']')
+            depth--;
+        else if (!*s)
+            return NULL;
+        s++;
+    } while (depth);
+    return s;
+}
+
+/**
+ * json_get_field - get the top-level member @field of a JSON object.
+ * @s:     JSON text. (transfer none)
+ * @field: member name. (transfer none)
+ *
+ * String values are unescaped; numbers, literals, objects and arrays are
+ * returned verbatim.
+ *
+ * Returns: (transfer full) the value, or NULL if absent or malformed.
+ */
+static gchar *
+json_get_field(const gchar *s, const gchar *field)
+{
+    const gchar *v;
+    gchar *key, *ret;
+    gboolean match;
+
+    s = json_skip_ws(s);
+    if (*s++ != '{')
+        return NULL;
+    for (;;) {
+        s = json_skip_ws(s);
+        if (*s != '"' || !(s = json_string(s, &key)))
+            return NULL;
+        match = !strcmp(key, field);
+        g_free(key);
+        s = json_skip_ws(s);
+        if (*s++ != ':')
+            return NULL;
+        s = json_skip_ws(s);
+        if (match && *s == '"')
+            return json_string(s, &ret) ? ret : NULL;
+        if (!(v = json_skip_value(s)))
+            return NULL;
+        if (match)
+            return g_strndup(s, v - s);
+        s = json_skip_ws(v);
+        if (*s++ != ',')
+            return NULL;
     }
-    return TRUE;
 }
 
 /**
- * genmon_destructor - stop the polling timer.
+ * genmon_show - show the job's latest output according to gm's format.
+ * @gm:     genmon_priv instance. (transfer none)
+ * @result: complete output of a run (or one stream line). (transfer none)
+ *
+ * Formats the selected text with g_markup_printf_escaped() using the
+ * configured size and colour; the markup string is transfer-full and
+ * g_free'd here.  A missing field leaves the label unchanged.
+ */
+static void
+genmon_show(genmon_priv *gm, const gchar *result)
+{
+    gchar *text = NULL, *markup;
+
+    if (gm->format == GM_KEYVALUE && gm->field)
+        text = kv_get_field(result, gm->field);
+    else if (gm->format == GM_JSON && gm->field)
+        text = json_get_field(result, gm->field);
+    else
+        text = g_strndup(result, strcspn(result, "\n"));
+    if (!text) {
+        DBG("no field '%s' in output of '%s'\n", gm->field, gm->command);
+        return;
+    }
+    markup = g_markup_printf_escaped(FMT, gm->textsize, gm->textcolor, text);
+    gtk_label_set_markup(GTK_LABEL(gm->main), markup);
+    g_free(markup);
+    g_free(text);
+}
+
+/**
+ * genmon_job_publish - store a complete output and hand it to subscribers.
+ * @job: genmon_job. (transfer none)
+ * @out: (transfer full) the output.
+ */
+static void
+genmon_job_publish(genmon_job *job, gchar *out)
+{
+    GSList *l;
+
+    g_free(job->result);
+    job->result = out;
+    for (l = job->subs; l; l = l->next)
+        genmon_show(l->data, job->result);
+}
+
+/**
+ * genmon_job_reset - drop the finished (or killed) run.
+ * @job: genmon_job. (transfer none)
+ *
+ * Releases job->proc, job->out and job->cancel and stops the overrun
+ * timer.  In stream mode schedules a restart after PollingTime seconds.
+ */
+static void
+genmon_job_reset(genmon_job *job)
+{
+    g_clear_object(&job->out);
+    g_clear_object(&job->proc);
+    g_clear_object(&job->cancel);
+    if (job->kill_timer) {
+        g_source_remove(job->kill_timer);
+        job->kill_timer = 0;
+    }
+    if (job->stream && !job->timer)
+        job->timer = g_timeout_add_seconds(MAX(job->time, 1),
+            (GSourceFunc) genmon_job_run, (gpointer) job);
+}
+
+/**
+ * genmon_exited - g_subprocess_wait_async() callback for a polled run.
+ * @src:  the GSubprocess. (transfer none)
+ * @res:  async result. (transfer none)
+ * @data: genmon_job; dangling if the wait was cancelled. (transfer none)
+ */
+static void
+genmon_exited(GObject *src, GAsyncResult *res, gpointer data)
+{
+    genmon_job *job = data;
+    GError *err = NULL;
+
+    if (!g_subprocess_wait_finish(G_SUBPROCESS(src), res, &err)) {
+        gboolean cancelled;
+
+        cancelled = g_error_matches(err, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+        g_error_free(err);
+        if (cancelled)
+            return;
+    }
+    DBG("'%s' exited\n", job->command);
+    if (job->proc == G_SUBPROCESS(src))
+        genmon_job_reset(job);
+}
+
+/**
+ * genmon_line_ready - stdout line callback.
+ * @src:  the GDataInputStream. (transfer none)
+ * @res:  async result. (transfer none)
+ * @data: genmon_job; dangling if the read was cancelled. (transfer none)
+ *
+ * Stream mode: publishes each line and queues the next read; EOF or an
+ * error ends the run (and schedules a restart).
+ * Polled mode: collects lines (only the first unless job->whole) and, at
+ * EOF or after the first line, publishes them and waits for the exit.
+ */
+static void
+genmon_line_ready(GObject *src, GAsyncResult *res, gpointer data)
+{
+    genmon_job *job = data;
+    GError *err = NULL;
+    char *line;
+
+    line = g_data_input_stream_read_line_finish(G_DATA_INPUT_STREAM(src),
+        res, NULL, &err);
+    if (err) {
+        gboolean cancelled;
+
+        cancelled = g_error_matches(err, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+        DBG("read error: %s\n", err->message);
+        g_error_free(err);
+        if (cancelled)
+            return;
+    }
+    if (job->stream) {
+        if (!line) {
+            genmon_job_reset(job);
+            return;
+        }
+        genmon_job_publish(job, line);
+    } else if (line) {
+        if (job->acc->len)
+            g_string_append_c(job->acc, '\n');
+        g_string_append(job->acc, line);
+        g_free(line);
+    }
+    if (line && (job->stream || job->whole)) {
+        g_data_input_stream_read_line_async(job->out, G_PRIORITY_DEFAULT,
+            job->cancel, genmon_line_ready, job);
+        return;
+    }
+    if (job->acc->len)
+        genmon_job_publish(job, g_strdup(job->acc->str));
+    g_clear_object(&job->out);
+    g_subprocess_wait_async(job->proc, job->cancel, genmon_exited, job);
+}
+
+/**
+ * genmon_overrun - Timeout expired: kill the running command.
+ * @job: genmon_job. (transfer none)
+ *
+ * Also cancels the run's pending read/wait and releases it at once: a
+ * grandchild of the shell may keep the stdout pipe open after the kill,
+ * and the next poll must not be blocked by it.
+ *
+ * Returns: FALSE (one-shot).
+ */
+static gboolean
+genmon_overrun(genmon_job *job)
+{
+    job->kill_timer = 0;
+    if (job->proc) {
+        ERR("genmon: '%s' timed out after %d s, killing it\n",
+            job->command, job->timeout);
+        g_subprocess_force_exit(job->proc);
+        g_cancellable_cancel(job->cancel);
+        genmon_job_reset(job);
+    }
+    return FALSE;
+}
+
+/**
+ * genmon_job_run - start the command unless a previous run is still active.
+ * @job: genmon_job. (transfer none)
+ *
+ * Spawns "/bin/sh -c Command" with stdout piped (stderr discarded) and
+ * queues an async read of its first line.  Arms the Timeout kill timer in
+ * polled mode.  In stream mode this is the (re)start callback and removes
+ * itself.
+ *
+ * Called from the job's GLib timeout and once when the job is created.
+ *
+ * Returns: TRUE to keep the polling timeout active (FALSE in stream mode).
+ */
+static gboolean
+genmon_job_run(genmon_job *job)
+{
+    GError *err = NULL;
+
+    if (job->stream)
+        job->timer = 0;
+    if (job->proc) {
+        DBG("'%s' still running, skipping poll\n", job->command);
+        return !job->stream;
+    }
+    job->proc = g_subprocess_new(G_SUBPROCESS_FLAGS_STDOUT_PIPE |
+        G_SUBPROCESS_FLAGS_STDERR_SILENCE, &err,
+        "/bin/sh", "-c", job->command, NULL);
+    if (!job->proc) {
+        ERR("genmon: can't run '%s': %s\n", job->command, err->message);
+        g_error_free(err);
+        if (job->stream)
+            genmon_job_reset(job);
+        return !job->stream;
+    }
+    g_string_truncate(job->acc, 0);
+    job->cancel = g_cancellable_new();
+    job->out = g_data_input_stream_new(g_subprocess_get_stdout_pipe(job->proc));
+    g_data_input_stream_read_line_async(job->out, G_PRIORITY_DEFAULT,
+        job->cancel, genmon_line_ready, job);
+    if (!job->stream && job->timeout > 0)
+        job->kill_timer = g_timeout_add_seconds(job->timeout,
+            (GSourceFunc) genmon_overrun, (gpointer) job);
+    return !job->stream;
+}
+
+/**
+ * genmon_job_key - hash key identifying a shareable job for @gm.
+ * @gm: genmon_priv with config read. (transfer none)
+ *
+ * Returns: (transfer full) "<time>:<stream>:<whole>:<command>".
+ */
+static gchar *
+genmon_job_key(genmon_priv *gm)
+{
+    return g_strdup_printf("%d:%d:%d:%s", gm->time, gm->stream,
+        gm->format != GM_LINE, gm->command);
+}
+
+/**
+ * genmon_subscribe - attach @gm to the job for its key, creating it if new.
+ * @gm: genmon_priv with config read. (transfer none)
+ *
+ * A new job starts its first run immediately and, in polled mode, installs
+ * the polling timeout.  Joining an existing job shows its last output at
+ * once.
+ */
+static void
+genmon_subscribe(genmon_priv *gm)
+{
+    genmon_job *job;
+    gchar *key;
+
+    if (!jobs)
+        jobs = g_hash_table_new(g_str_hash, g_str_equal);
+    key = genmon_job_key(gm);
+    job = g_hash_table_lookup(jobs, key);
+    if (job) {
+        g_free(key);
+        job->subs = g_slist_append(job->subs, gm);
+        gm->job = job;
+        if (job->result)
+            genmon_show(gm, job->result);
+        return;
+    }
+    job = g_new0(genmon_job, 1);
+    job->key = key;
+    job->command = g_strdup(gm->command);
+    job->time = gm->time;
+    job->timeout = gm->timeout;
+    job->stream = gm->stream;
+    job->whole = gm->format != GM_LINE;
+    job->acc = g_string_new(NULL);
+    job->subs = g_slist_append(NULL, gm);
+    gm->job = job;
+    g_hash_table_insert(jobs, job->key, job);
+    DBG("new job '%s'\n", job->key);
+
+    genmon_job_run(job);
+    if (!job->stream)
+        job->timer = g_timeout_add((guint) job->time * 1000,
+            (GSourceFunc) genmon_job_run, (gpointer) job);
+}
+
+/**
+ * genmon_unsubscribe - detach @gm; stop and free the job if it was the last.
+ * @gm: genmon_priv. (transfer none)
+ *
+ * Stopping removes the timeouts, cancels pending async reads/waits and
+ * kills a running command.
+ */
+static void
+genmon_unsubscribe(genmon_priv *gm)
+{
+    genmon_job *job = gm->job;
+
+    if (!job)
+        return;
+    gm->job = NULL;
+    job->subs = g_slist_remove(job->subs, gm);
+    if (job->subs)
+        return;
+
+    if (job->timer)
+        g_source_remove(job->timer);
+    if (job->kill_timer)
+        g_source_remove(job->kill_timer);
+    if (job->cancel)
+        g_cancellable_cancel(job->cancel);
+    if (job->proc)
+        g_subprocess_force_exit(job->proc);
+    g_clear_object(&job->out);
+    g_clear_object(&job->proc);
+    g_clear_object(&job->cancel);
+    g_hash_table_remove(jobs, job->key);
+    if (!g_hash_table_size(jobs)) {
+        g_hash_table_destroy(jobs);
+        jobs = NULL;
+    }
+    g_string_free(job->acc, TRUE);
+    g_free(job->result);
+    g_free(job->command);
+    g_free(job->key);
+    g_free(job);
+}
+
+/**
+ * genmon_destructor - leave the shared job.
  * @p: plugin_instance. (transfer none)
  *
- * Removes the GLib timeout if it is active.  The GtkLabel (gm->main) is
- * owned by p->pwid and is destroyed when the parent widget is destroyed.
- * Config strings (command, textsize, textcolor) are transfer-none xconf
- * pointers and must NOT be freed here.
+ * The job (timers, running command) is stopped when its last subscriber
+ * leaves.  The GtkLabel (gm->main) is owned by p->pwid and is destroyed
+ * when the parent widget is destroyed.  Config strings (command, textsize,
+ * textcolor, field) are transfer-none xconf pointers and must NOT be freed
+ * here.
  */
 static void
 genmon_destructor(plugin_instance *p)
 {
     genmon_priv *gm = (genmon_priv *) p;
 
-    if (gm->timer) {
-        g_source_remove(gm->timer);
-    }
+    genmon_unsubscribe(gm);
     return;
 }
 
@@ -117,8 +650,8 @@ genmon_destructor(plugin_instance *p)
  * @p: plugin_instance allocated by the plugin framework. (transfer none)
  *
  * Reads all config keys (all transfer-none; raw xconf pointers stored in
- * genmon_priv fields without copying).  Creates a GtkLabel, performs an
- * initial text_update(), then installs a GLib timeout for subsequent polls.
+ * genmon_priv fields without copying).  Creates a GtkLabel and subscribes
+ * to the shared job for this command, which starts it if needed.
  *
  * Returns: 1 on success.
  */
@@ -133,21 +666,25 @@ genmon_constructor(plugin_instance *p)
     gm->textsize = "medium";
     gm->textcolor = "darkblue";
     gm->max_text_len = 30;
+    gm->timeout = 10;
+    gm->format = GM_LINE;
 
     XCG(p->xc, "Command", &gm->command, str);
     XCG(p->xc, "TextSize", &gm->textsize, str);
     XCG(p->xc, "TextColor", &gm->textcolor, str);
     XCG(p->xc, "PollingTime", &gm->time, int);
     XCG(p->xc, "MaxTextLength", &gm->max_text_len, int);
+    XCG(p->xc, "Timeout", &gm->timeout, int);
+    XCG(p->xc, "Stream", &gm->stream, enum, bool_enum);
+    XCG(p->xc, "Format", &gm->format, enum, format_enum);
+    XCG(p->xc, "Field", &gm->field, str);
 
     gm->main = gtk_label_new(NULL);
     gtk_label_set_max_width_chars(GTK_LABEL(gm->main), gm->max_text_len);
-    text_update(gm);
+    genmon_subscribe(gm);
     gtk_container_set_border_width (GTK_CONTAINER (p->pwid), 1);
     gtk_container_add(GTK_CONTAINER(p->pwid), gm->main);
     gtk_widget_show_all(p->pwid);
-    gm->timer = g_timeout_add((guint) gm->time * 1000,
-        (GSourceFunc) text_update, (gpointer) gm);
 
     return 1;
 }
@@ -157,7 +694,7 @@ static plugin_class class = {
     .count       = 0,
     .type        = "genmon",
     .name        = "Generic Monitor",
-    .version     = "0.3",
+    .version     = "0.5",
     .description = "Display the output of a program/script into the panel",
     .priv_size   = sizeof(genmon_priv),
 
@@ -292,36 +292,15 @@ find_task (icons_priv * ics, Window win)
  * task_has_icon - test whether a window has a native icon.
  * @tk: Task to test. (transfer none)
  *
- * Checks for _NET_WM_ICON (ARGB; any non-NULL result) and WM_HINTS
- * IconPixmapHint / IconMaskHint flags.  Frees all X11 allocations before
- * returning.
+ * Asks the panel's window icon cache, which answers from an existing entry
+ * (e.g. one the taskbar loaded) or probes the header of _NET_WM_ICON and the
+ * WM_HINTS IconPixmapHint / IconMaskHint flags without reading pixels.
  *
  * Returns: 1 if the window already has an icon; 0 if not.
  */
 static int task_has_icon(task *tk)
 {
-    XWMHints *hints;
-    gulong *data;
-    int n;
-
-    data = get_xaproperty(tk->win, a_NET_WM_ICON, XA_CARDINAL, &n);
-    if (data)
-    {
-        XFree(data);
-        return 1;
-    }
-
-    hints = XGetWMHints(GDK_DPY, tk->win);
-    if (hints)
-    {
-        if ((hints->flags & IconPixmapHint) || (hints->flags & IconMaskHint))
-        {
-            XFree (hints);
-            return 1;
-        }
-        XFree (hints);
-    }
-    return 0;
+    return window_has_icon(tk->win) ? 1 : 0;
 }
 
 /**
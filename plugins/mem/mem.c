@@ -3,8 +3,8 @@
  * @brief Memory and swap usage progress-bar plugin for fbpanel.
  *
  * Displays one or two GtkProgressBar widgets showing RAM and (optionally)
- * swap usage.  Reads /proc/meminfo on Linux using a compile-time-generated
- * lookup table defined in mt.h.  Updates every 3 seconds.
+ * swap usage.  Reads /proc/meminfo on Linux with the shared single-pass
+ * parser in meminfo.c.inc (fields listed in mt.h).  Updates every 3 seconds.
  *
  * Config keys:
  *   ShowSwap (bool, default false) — show a second progress bar for swap.
@@ -42,13 +42,6 @@ typedef struct
     int show_swap;       /**< Boolean: show the swap progress bar. */
 } mem_priv;
 
-typedef struct
-{
-    char *name;
-    gulong val;
-    int valid;
-} mem_type_t;
-
 typedef struct
 {
     struct
@@ -61,83 +54,40 @@ typedef struct
         gulong total;
         gulong used;
     } swap;
+    gulong shmem;
+    gulong dirty;
 } stats_t;
 
 static stats_t stats;
 
 #if defined __linux__
-#undef MT_ADD
-#define MT_ADD(x) MT_ ## x,
-enum {
-#include "mt.h"
-    MT_NUM
-};
-
-#undef MT_ADD
-#define MT_ADD(x) { #x, 0, 0 },
-mem_type_t mt[] =
-{
-#include "mt.h"
-};
-
-static gboolean
-mt_match(char *buf, mem_type_t *m)
-{
-    gulong val;
-    int len;
-
-    len = strlen(m->name);
-    if (strncmp(buf, m->name, len))
-        return FALSE;
-    if (sscanf(buf + len + 1, "%lu", &val) != 1)
-        return FALSE;
-    m->val = val;
-    m->valid = 1;
-    DBG("%s: %lu\n", m->name, val);
-    return TRUE;
-}
+#include "meminfo.c.inc"
 
 /**
  * mem_usage - parse /proc/meminfo and populate the static stats struct.
  *
- * Reads the mt[] lookup table (generated from mt.h) to parse the fields of
- * /proc/meminfo.  Computes used RAM as Total - (Free + Buffers + Cached + Slab)
- * and swap used as Total - Free.  Results are stored in the module-level
- * stats variable.
+ * Runs the shared single-pass parser (meminfo.c.inc) over the fields
+ * listed in mt.h.  Used RAM comes from meminfo_mem_used() (MemAvailable
+ * based where available); swap used is Total - Free.  Results are stored
+ * in the module-level stats variable.
  */
 static void
 mem_usage()
 {
-    FILE *fp;
-    char buf[160];
-    int i;
-
-    fp = fopen("/proc/meminfo", "r");
-    if (!fp)
+    if (!meminfo_read())
         return;
-    for (i = 0; i < MT_NUM; i++)
-    {
-        mt[i].valid = 0;
-        mt[i].val = 0;
-    }
-
-    while ((fgets(buf, sizeof(buf), fp)) != NULL)
-    {
-        for (i = 0; i < MT_NUM; i++)
-        {
-            if (!mt[i].valid && mt_match(buf, mt + i))
-                break;
-        }
-    }
-    fclose(fp);
 
     stats.mem.total = mt[MT_MemTotal].val;
-    stats.mem.used = mt[MT_MemTotal].val -(mt[MT_MemFree].val +
-        mt[MT_Buffers].val + mt[MT_Cached].val + mt[MT_Slab].val);
+    stats.mem.used = meminfo_mem_used();
     stats.swap.total = mt[MT_SwapTotal].val;
     stats.swap.used = mt[MT_SwapTotal].val - mt[MT_SwapFree].val;
+    stats.shmem = mt[MT_Shmem].val;
+    stats.dirty = mt[MT_Dirty].val;
 }
 #else
+#define meminfo_open()
+#define meminfo_close()
+
 static void
 mem_usage()
 {
@@ -159,7 +109,7 @@ static gboolean
 mem_update(mem_priv *mem)
 {
     gdouble mu, su;
-    char str[90];
+    char str[160];
 
     mu = su = 0;
     bzero(&stats, sizeof(stats));
@@ -170,9 +120,11 @@ mem_update(mem_priv *mem)
         su = (gdouble) stats.swap.used / (gdouble) stats.swap.total;
     g_snprintf(str, sizeof(str),
         "<b>Mem:</b> %d%%, %lu MB of %lu MB\n"
-        "<b>Swap:</b> %d%%, %lu MB of %lu MB",
+        "<b>Swap:</b> %d%%, %lu MB of %lu MB\n"
+        "<b>Shmem:</b> %lu MB, <b>Dirty:</b> %lu MB",
         (int)(mu * 100), stats.mem.used >> 10, stats.mem.total >> 10,
-        (int)(su * 100), stats.swap.used >> 10, stats.swap.total >> 10);
+        (int)(su * 100), stats.swap.used >> 10, stats.swap.total >> 10,
+        stats.shmem >> 10, stats.dirty >> 10);
     DBG("%s\n", str);
     gtk_widget_set_tooltip_markup(mem->plugin.pwid, str);
     gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR(mem->mem_pb), mu);
@@ -186,8 +138,9 @@ mem_update(mem_priv *mem)
  * mem_destructor - stop the update timer and destroy the box widget.
  * @p: plugin_instance. (transfer none)
  *
- * Removes the GLib timeout.  Explicitly destroys mem->box (and its children)
- * rather than relying solely on parent widget destruction.
+ * Removes the GLib timeout and drops the /proc/meminfo reference.
+ * Explicitly destroys mem->box (and its children) rather than relying
+ * solely on parent widget destruction.
  */
 static void
 mem_destructor(plugin_instance *p)
@@ -196,6 +149,7 @@ mem_destructor(plugin_instance *p)
 
     if (mem->timer)
         g_source_remove(mem->timer);
+    meminfo_close();
     gtk_widget_destroy(mem->box);
     return;
 }
@@ -255,6 +209,7 @@ mem_constructor(plugin_instance *p)
     gtk_widget_show_all(mem->box);
     gtk_container_add(GTK_CONTAINER(p->pwid), mem->box);
     gtk_widget_set_tooltip_markup(mem->plugin.pwid, "XXX");
+    meminfo_open();
     mem_update(mem);
     mem->timer = g_timeout_add(3000, (GSourceFunc) mem_update, (gpointer)mem);
     return 1;
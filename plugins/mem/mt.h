@@ -2,10 +2,14 @@
 /* Memory types (MT) to scan in /proc/meminfo */
 MT_ADD(MemTotal)
 MT_ADD(MemFree)
+MT_ADD(MemAvailable)
 MT_ADD(MemShared)
+MT_ADD(Shmem)
 MT_ADD(Slab)
+MT_ADD(SReclaimable)
 MT_ADD(Buffers)
 MT_ADD(Cached)
+MT_ADD(Dirty)
 
 MT_ADD(SwapTotal)
 MT_ADD(SwapFree)
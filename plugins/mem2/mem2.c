@@ -3,8 +3,9 @@
  * @brief Memory and swap usage scrolling chart plugin for fbpanel.
  *
  * Displays a scrolling chart of RAM and optionally swap usage using the
- * chart_class base plugin.  Reads /proc/meminfo on Linux using the same
- * mt.h-generated lookup table as the mem plugin.  Updates every 2 seconds.
+ * chart_class base plugin.  Reads /proc/meminfo on Linux with the same
+ * single-pass parser as the mem plugin (mem/meminfo.c.inc).  Updates every
+ * 2 seconds.
  *
  * Config keys (transfer-none xconf strings):
  *   MemColor  (str, default "red")  — chart bar colour for RAM usage.
@@ -39,53 +40,17 @@ static chart_class *k;
 
 static void mem2_destructor(plugin_instance *p);
 
-typedef struct {
-    char *name;
-    gulong val;
-    int valid;
-} mem_type_t;
-
-
 #if defined __linux__
-#undef MT_ADD
-#define MT_ADD(x) MT_ ## x,
-enum {
-#include "../mem/mt.h"
-    MT_NUM
-};
-
-#undef MT_ADD
-#define MT_ADD(x) { #x, 0, 0 },
-mem_type_t mt[] =
-{
-#include "../mem/mt.h"
-};
-
-static gboolean
-mt_match(char *buf, mem_type_t *m)
-{
-    gulong val;
-    int len;
-
-    len = strlen(m->name);
-    if (strncmp(buf, m->name, len))
-        return FALSE;
-    if (sscanf(buf + len + 1, "%lu", &val) != 1)
-        return FALSE;
-    m->val = val;
-    m->valid = 1;
-    DBG("%s: %lu\n", m->name, val);
-    return TRUE;
-}
+#include "../mem/meminfo.c.inc"
 
 /**
  * mem_usage - parse /proc/meminfo and push tick values to the chart.
  * @c: mem2_priv. (transfer none)
  *
- * Reads /proc/meminfo using the mt[] lookup table (generated from
- * mem/mt.h).  Computes used RAM = Total - (Free + Buffers + Cached + Slab)
- * and used swap = Total - Free.  Converts to fractions [0..1] for the
- * chart tick and formats a tooltip showing MB values.
+ * Runs the shared single-pass parser (mem/meminfo.c.inc).  Used RAM comes
+ * from meminfo_mem_used() (MemAvailable based where available); used swap
+ * is Total - Free.  Converts to fractions [0..1] for the chart tick and
+ * formats a tooltip showing MB values.
  *
  * Called from the 2-second GLib timeout and once from the constructor.
  *
@@ -94,42 +59,28 @@ mt_match(char *buf, mem_type_t *m)
 static int
 mem_usage(mem2_priv *c)
 {
-    FILE *fp;
     char buf[160];
     long unsigned int total[2];
     float total_r[2];
-    int i;
-
-    fp = fopen("/proc/meminfo", "r");
-    if (!fp)
-        RET(FALSE);;
-    for (i = 0; i < MT_NUM; i++)
-    {
-        mt[i].valid = 0;
-        mt[i].val = 0;
-    }
 
-    while ((fgets(buf, sizeof(buf), fp)) != NULL)
-    {
-        for (i = 0; i < MT_NUM; i++)
-        {
-            if (!mt[i].valid && mt_match(buf, mt + i))
-                break;
-        }
-    }
-    fclose(fp);
+    if (!meminfo_read())
+        RET(TRUE);
 
-    total[0] = (float)(mt[MT_MemTotal].val -(mt[MT_MemFree].val +
-        mt[MT_Buffers].val + mt[MT_Cached].val + mt[MT_Slab].val));
-    total[1] = (float)(mt[MT_SwapTotal].val - mt[MT_SwapFree].val);
-    total_r[0] = (float)total[0] / mt[MT_MemTotal].val;
-    total_r[1] = (float)total[1] / mt[MT_SwapTotal].val;
+    total[0] = meminfo_mem_used();
+    total[1] = mt[MT_SwapTotal].val - mt[MT_SwapFree].val;
+    total_r[0] = total_r[1] = 0;
+    if (mt[MT_MemTotal].val)
+        total_r[0] = (float)total[0] / mt[MT_MemTotal].val;
+    if (mt[MT_SwapTotal].val)
+        total_r[1] = (float)total[1] / mt[MT_SwapTotal].val;
 
     g_snprintf(buf, sizeof(buf),
         "<b>Mem:</b> %d%%, %lu MB of %lu MB\n"
-        "<b>Swap:</b> %d%%, %lu MB of %lu MB",
+        "<b>Swap:</b> %d%%, %lu MB of %lu MB\n"
+        "<b>Shmem:</b> %lu MB, <b>Dirty:</b> %lu MB",
         (int)(total_r[0] * 100), total[0] >> 10, mt[MT_MemTotal].val >> 10,
-        (int)(total_r[1] * 100), total[1] >> 10, mt[MT_SwapTotal].val >> 10);
+        (int)(total_r[1] * 100), total[1] >> 10, mt[MT_SwapTotal].val >> 10,
+        mt[MT_Shmem].val >> 10, mt[MT_Dirty].val >> 10);
 
     k->add_tick(&c->chart, total_r);
     gtk_widget_set_tooltip_markup(((plugin_instance *)c)->pwid, buf);
@@ -137,6 +88,9 @@ mem_usage(mem2_priv *c)
 
 }
 #else
+#define meminfo_open()
+#define meminfo_close()
+
 static int
 mem_usage()
 {
@@ -178,6 +132,7 @@ mem2_constructor(plugin_instance *p)
     }
     gtk_widget_set_tooltip_markup(((plugin_instance *)c)->pwid,
         "<b>Memory</b>");
+    meminfo_open();
     mem_usage(c);
     c->timer = g_timeout_add(CHECK_PERIOD * 1000,
         (GSourceFunc) mem_usage, (gpointer) c);
@@ -186,7 +141,8 @@ mem2_constructor(plugin_instance *p)
 
 
 /**
- * mem2_destructor - stop the timer and release chart_class.
+ * mem2_destructor - stop the timer, drop the meminfo reference and release
+ *   chart_class.
  * @p: plugin_instance. (transfer none)
  */
 static void
@@ -196,6 +152,7 @@ mem2_destructor(plugin_instance *p)
 
     if (c->timer)
         g_source_remove(c->timer);
+    meminfo_close();
     PLUGIN_CLASS(k)->destructor(p);
     class_put("chart");
     return;
@@ -12,6 +12,12 @@
  * When the GtkIconTheme emits "changed" (e.g., after a theme switch), the
  * icon is reloaded via update_view().
  *
+ * Rendered icons are cached per instance: m->cache maps each icon array
+ * passed to set_icons() to a GPtrArray holding one GdkPixbuf per name,
+ * rasterised at m->size the first time that level is shown.  Level changes
+ * then only swap cached pixbufs and never touch the icon theme; the cache
+ * is dropped when the theme emits "changed".
+ *
  * meter_class extends plugin_class with two virtual methods:
  *   set_level(m, level) — update the icon for the given percentage level.
  *   set_icons(m, icons) — set the NULL-terminated icon name array.
@@ -23,6 +29,7 @@
 
 #include "plugin.h"
 #include "panel.h"
+#include "misc.h"
 #include "meter.h"
 
 
@@ -30,23 +37,65 @@
 #include "dbg.h"
 float roundf(float x);
 
+/**
+ * meter_pixbuf_free - GPtrArray element destructor; slots may be NULL.
+ * @pb: cached GdkPixbuf or NULL. (transfer full)
+ */
+static void
+meter_pixbuf_free(gpointer pb)
+{
+    if (pb)
+        g_object_unref(G_OBJECT(pb));
+}
+
+/**
+ * meter_get_pixbuf - return icon @i of the current set at m->size.
+ * @m: meter_priv with icons set. (transfer none)
+ * @i: index into m->icons.
+ *
+ * Looks the set up in m->cache (creating an all-NULL slot array on first
+ * use) and fetches the icon through fb_pixbuf_new() (the process-wide
+ * pixbuf cache, shared with other meters) only if its slot is still empty.
+ * A failed load leaves the slot empty and is retried next time.
+ *
+ * Returns: (transfer none) the cached GdkPixbuf, or NULL if the icon could
+ *   not be loaded.
+ */
+static GdkPixbuf *
+meter_get_pixbuf(meter_priv *m, int i)
+{
+    GPtrArray *set;
+
+    if (!(set = g_hash_table_lookup(m->cache, m->icons))) {
+        set = g_ptr_array_new_with_free_func(meter_pixbuf_free);
+        g_ptr_array_set_size(set, m->num);
+        g_hash_table_insert(m->cache, m->icons, set);
+    }
+    if (!g_ptr_array_index(set, i)) {
+        g_ptr_array_index(set, i) = fb_pixbuf_new(m->icons[i], NULL,
+            m->size, m->size, FALSE);
+        DBG("loading icon '%s' %s\n", m->icons[i],
+            g_ptr_array_index(set, i) ? "ok" : "failed");
+    }
+    return g_ptr_array_index(set, i);
+}
+
 /**
  * meter_set_level - update the displayed icon to reflect the given level.
  * @m:     meter_priv. (transfer none)
  * @level: percentage [0..100].
  *
  * Maps level to an icon array index using round((level/100) * (num-1)).
- * Loads the icon from the current GtkIconTheme at m->size pixels with
- * GTK_ICON_LOOKUP_FORCE_SIZE.  Skips the reload if the computed index has
- * not changed.  The loaded GdkPixbuf is transfer-full and unreffed here
- * after being set on the GtkImage.
+ * Takes the icon from the pixbuf cache (meter_get_pixbuf(), which loads it
+ * from the current GtkIconTheme at m->size pixels with
+ * GTK_ICON_LOOKUP_FORCE_SIZE on first use).  Skips the update if the
+ * computed index has not changed.
  */
 /* level - per cent level from 0 to 100 */
 static void
 meter_set_level(meter_priv *m, int level)
 {
     int i;
-    GdkPixbuf *pb;
 
     if (m->level == level)
         return;
@@ -60,12 +109,7 @@ meter_set_level(meter_priv *m, int level)
     DBG("level=%f icon=%d\n", level, i);
     if (i != m->cur_icon) {
         m->cur_icon = i;
-        pb = gtk_icon_theme_load_icon(icon_theme, m->icons[i],
-            m->size, GTK_ICON_LOOKUP_FORCE_SIZE, NULL);
-        DBG("loading icon '%s' %s\n", m->icons[i], pb ? "ok" : "failed");
-        gtk_image_set_from_pixbuf(GTK_IMAGE(m->meter), pb);
-        if (pb)
-            g_object_unref(G_OBJECT(pb));
+        gtk_image_set_from_pixbuf(GTK_IMAGE(m->meter), meter_get_pixbuf(m, i));
     }
     m->level = level;
     return;
@@ -101,15 +145,22 @@ meter_set_icons(meter_priv *m, gchar **icons)
  * update_view - force icon reload after a GtkIconTheme change.
  * @m: meter_priv. (transfer none)
  *
- * Resets cur_icon to -1 and calls meter_set_level() with the cached level
- * so the icon is reloaded from the new theme.  Connected to the "changed"
+ * Drops every cached pixbuf, resets cur_icon and level to -1 and calls
+ * meter_set_level() with the previous level so the icon is reloaded from
+ * the new theme.  Connected to the "changed"
  * signal of icon_theme via g_signal_connect_swapped().
  */
 static void
 update_view(meter_priv *m)
 {
+    int level = m->level;
+
+    g_hash_table_remove_all(m->cache);
     m->cur_icon = -1;
-    meter_set_level(m, m->level);
+    /* meter_set_level() skips an unchanged level */
+    m->level = -1;
+    if (level >= 0)
+        meter_set_level(m, level);
     return;
 }
 
@@ -118,7 +169,8 @@ update_view(meter_priv *m)
  * @p: plugin_instance. (transfer none)
  *
  * Creates a centred GtkImage, packs it into p->pwid, and initialises cur_icon
- * to -1.  Icon size defaults to panel->max_elem_height.  Connects
+ * to -1.  Icon size defaults to panel->max_elem_height.  Creates the empty
+ * pixbuf cache.  Connects
  * "changed" on icon_theme (swapped) to update_view so icons refresh on theme
  * changes.  Stores the signal ID in m->itc_id for disconnection in the
  * destructor.
@@ -138,6 +190,8 @@ meter_constructor(plugin_instance *p)
     gtk_container_add(GTK_CONTAINER(p->pwid), m->meter);
     m->cur_icon = -1;
     m->size = p->panel->max_elem_height;
+    m->cache = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+        (GDestroyNotify) g_ptr_array_unref);
     m->itc_id = g_signal_connect_swapped(G_OBJECT(icon_theme),
         "changed", (GCallback) update_view, m);
     return 1;
@@ -147,8 +201,10 @@ meter_constructor(plugin_instance *p)
  * meter_destructor - disconnect the icon theme signal handler.
  * @p: plugin_instance. (transfer none)
  *
- * Disconnects the "changed" signal from icon_theme using the stored m->itc_id.
- * The GtkImage is owned by p->pwid and destroyed by the parent.
+ * Disconnects the "changed" signal from icon_theme using the stored m->itc_id
+ * and frees the pixbuf cache (the GtkImage holds its own reference to the
+ * pixbuf it shows).  The GtkImage is owned by p->pwid and destroyed by the
+ * parent.
  */
 static void
 meter_destructor(plugin_instance *p)
@@ -156,6 +212,7 @@ meter_destructor(plugin_instance *p)
     meter_priv *m = (meter_priv *) p;
 
     g_signal_handler_disconnect(G_OBJECT(icon_theme), m->itc_id);
+    g_hash_table_destroy(m->cache);
     return;
 }
 
@@ -164,7 +221,7 @@ static meter_class class = {
         .type        = "meter",
         .name        = "Meter",
         .description = "Basic meter plugin",
-        .version     = "1.0",
+        .version     = "1.1",
         .priv_size   = sizeof(meter_priv),
 
         .constructor = meter_constructor,
@@ -13,6 +13,7 @@ typedef struct {
     gint cur_icon;
     gint size;
     gint itc_id;
+    GHashTable *cache;   /* icons array -> GPtrArray of GdkPixbuf at size */
 } meter_priv;
 
 typedef struct {
@@ -6,7 +6,8 @@
  * throughput (in KB/s) using the chart_class base plugin.  On Linux the
  * data source is /proc/net/dev; on FreeBSD it uses net.if_mib sysctl.
  * Updates every 2 seconds.  Throughput values are normalised against a
- * configurable maximum (RxLimit + TxLimit).
+ * configurable maximum (RxLimit + TxLimit), or, with AutoScale, the chart
+ * ranges itself on a decaying peak of the visible history (see chart.c).
  *
  * Config keys (transfer-none xconf strings unless noted):
  *   interface (str, default "eth0")  — network interface name.
@@ -14,6 +15,8 @@
  *   RxLimit   (int, KB/s, default 120) — normalisation ceiling for RX.
  *   TxColor   (str, default "violet")  — chart colour for TX row.
  *   RxColor   (str, default "blue")    — chart colour for RX row.
+ *   AutoScale (bool, default false)    — auto-range instead of the limits.
+ *   LogScale  (bool, default false)    — log axis (AutoScale only).
  *
  * Delegates construction and destruction to chart_class (obtained via
  * class_get("chart")/class_put("chart")).
@@ -40,6 +43,7 @@
 
 
 #define CHECK_PERIOD   2 /* second */
+#define AUTOSCALE_FLOOR 1024 /* B/s; smallest auto-range full scale */
 
 struct net_stat {
     gulong tx, rx; /**< Cumulative byte counters. */
@@ -57,6 +61,8 @@ typedef struct {
     gint max_rx;   /**< RX normalisation ceiling in KB/s. */
     gulong max;    /**< Combined ceiling (max_rx + max_tx). */
     gchar *colors[2]; /**< Colour strings: [0]=TX, [1]=RX (transfer-none). */
+    int autoscale; /**< Boolean: auto-range the chart (AutoScale). */
+    int logscale;  /**< Boolean: log axis in auto-range mode (LogScale). */
 } net_priv;
 
 static chart_class *k;
@@ -174,7 +180,11 @@ net_get_load_real(net_priv *c, struct net_stat *net)
  *
  * Reads current byte counters, subtracts the previous sample, divides by
  * CHECK_PERIOD seconds, and normalises to [0..1] against c->max.  Pushes
- * a two-element tick to the chart and updates the tooltip.
+ * a two-element tick to the chart and updates the tooltip.  A counter that
+ * went backwards (interface reset or wrap) yields a zero sample.
+ *
+ * In auto-range mode the raw rates in B/s are pushed instead, and the
+ * tooltip also reports the peak and average of the visible history.
  *
  * Called from the 2-second GLib timeout and once from the constructor.
  *
@@ -185,6 +195,7 @@ net_get_load(net_priv *c)
 {
     struct net_stat net, net_diff;
     float total[2];
+    gfloat peak[2], avg[2];
     char buf[256];
 
     memset(&net, 0, sizeof(net));
@@ -194,18 +205,35 @@ net_get_load(net_priv *c)
     if (net_get_load_real(c, &net))
         goto end;
 
-    net_diff.tx = ((net.tx - c->net_prev.tx) >> 10) / CHECK_PERIOD;
-    net_diff.rx = ((net.rx - c->net_prev.rx) >> 10) / CHECK_PERIOD;
+    if (net.tx >= c->net_prev.tx)
+        net_diff.tx = (net.tx - c->net_prev.tx) / CHECK_PERIOD;
+    if (net.rx >= c->net_prev.rx)
+        net_diff.rx = (net.rx - c->net_prev.rx) / CHECK_PERIOD;
 
     c->net_prev = net;
-    total[0] = (float)(net_diff.tx) / c->max;
-    total[1] = (float)(net_diff.rx) / c->max;
+    if (c->autoscale) {
+        total[0] = net_diff.tx;
+        total[1] = net_diff.rx;
+    } else {
+        total[0] = (float)(net_diff.tx >> 10) / c->max;
+        total[1] = (float)(net_diff.rx >> 10) / c->max;
+    }
 
 end:
-    DBG("%f %f %ul %ul\n", total[0], total[1], net_diff.tx, net_diff.rx);
+    DBG("%f %f %lu %lu\n", total[0], total[1], net_diff.tx, net_diff.rx);
     k->add_tick(&c->chart, total);
-    g_snprintf(buf, sizeof(buf), "<b>%s:</b>\nD %lu Kbs, U %lu Kbs",
-        c->iface, net_diff.rx, net_diff.tx);
+    if (c->autoscale) {
+        k->get_stats(&c->chart, 0, &peak[0], &avg[0]);
+        k->get_stats(&c->chart, 1, &peak[1], &avg[1]);
+        g_snprintf(buf, sizeof(buf), "<b>%s:</b>\nD %lu Kbs, U %lu Kbs\n"
+            "<b>Peak:</b> D %lu Kbs, U %lu Kbs\n"
+            "<b>Avg:</b> D %lu Kbs, U %lu Kbs",
+            c->iface, net_diff.rx >> 10, net_diff.tx >> 10,
+            (gulong) peak[1] >> 10, (gulong) peak[0] >> 10,
+            (gulong) avg[1] >> 10, (gulong) avg[0] >> 10);
+    } else
+        g_snprintf(buf, sizeof(buf), "<b>%s:</b>\nD %lu Kbs, U %lu Kbs",
+            c->iface, net_diff.rx >> 10, net_diff.tx >> 10);
     gtk_widget_set_tooltip_markup(((plugin_instance *)c)->pwid, buf);
     return TRUE;
 }
@@ -216,8 +244,10 @@ end:
  *
  * Obtains chart_class via class_get("chart"), calls its constructor, then
  * reads config keys (transfer-none).  Calls init_net_stats() for FreeBSD
- * interface setup.  Configures 2 chart rows (TX, RX) and installs a 2-second
- * GLib timeout.  Calls net_get_load() once immediately.
+ * interface setup.  Configures 2 chart rows (TX, RX), switching the chart to
+ * auto-range mode if AutoScale is set, and installs a 2-second GLib timeout.
+ * The byte counters are sampled once to prime c->net_prev, so the first
+ * net_get_load() call does not report the totals since boot as a rate.
  *
  * Returns: 1 on success, 0 if chart class is unavailable.
  */
@@ -242,11 +272,16 @@ net_constructor(plugin_instance *p)
     XCG(p->xc, "TxLimit", &c->max_tx, int);
     XCG(p->xc, "TxColor", &c->colors[0], str);
     XCG(p->xc, "RxColor", &c->colors[1], str);
+    XCG(p->xc, "AutoScale", &c->autoscale, enum, bool_enum);
+    XCG(p->xc, "LogScale", &c->logscale, enum, bool_enum);
 
     init_net_stats(c);
+    net_get_load_real(c, &c->net_prev);
 
     c->max = c->max_rx + c->max_tx;
     k->set_rows(&c->chart, 2, c->colors);
+    if (c->autoscale)
+        k->set_autoscale(&c->chart, c->logscale, AUTOSCALE_FLOOR);
     gtk_widget_set_tooltip_markup(((plugin_instance *)c)->pwid, "<b>Net</b>");
     net_get_load(c);
     c->timer = g_timeout_add(CHECK_PERIOD * 1000,
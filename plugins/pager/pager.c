@@ -10,46 +10,93 @@
  * ---------------
  * - struct task   — per-window state (position, desktop, icon pixbuf, GDK filter)
  * - struct desk   — per-desktop state (GtkDrawingArea, cairo backing surface,
- *                   wallpaper surface, scale factors)
+ *                   wallpaper pixmap, scale factors)
  * - struct pager_priv — plugin private state (desk array, task hash table, config)
  *
  * DRAWING PIPELINE
  * ----------------
  * Each desk has an off-screen cairo_image_surface_t `pix` (RGB24) that is used
- * as a backing buffer.  When a window changes position, desktop, or state,
- * the affected desk(s) are marked dirty.  The next GDK "draw" signal on the
- * GtkDrawingArea triggers desk_draw_event(), which:
+ * as a backing buffer.  When a window changes position, desktop, state or
+ * focus, desk_damage_by_win() is called before and after the change: it adds
+ * the task's old and new thumbnail rectangles to the damage region of each
+ * desk the task is shown on, and queues a draw of just those rectangles.
+ * Changes that affect the whole thumbnail (resize, current desktop, desktop
+ * count, wallpaper) mark the desk dirty instead.  The next GDK "draw" signal
+ * on the GtkDrawingArea triggers desk_draw_event(), which, clipped to the
+ * damage region unless the desk is dirty:
  *   1. Calls desk_clear_pixmap() — fills pix with the background colour
- *      (or copies the wallpaper cache gpix).
+ *      (or paints the desk's shared wallpaper thumbnail).
  *   2. Iterates pg->wins[] in stacking order, calling task_update_pix() for
- *      each task on this desktop.
+ *      each task on this desktop that intersects the damage.
  *   3. Blits d->pix to the cairo_t provided by GDK.
  *
+ * SINGLE SURFACE
+ * --------------
+ * With SingleSurface, desks get no widget or surface of their own: the pager
+ * is one GtkDrawingArea (pg->da) laid out as a grid of Rows lines (columns
+ * on a vertical panel) with one backing surface pg->pix.  Each desk's pix is
+ * a cairo sub-surface of pg->pix at the desk's cell (desk::x, desk::y), so
+ * the drawing code above is shared, and draws and damage are queued on
+ * pg->da offset by the cell position.  pager_draw_event() refreshes every
+ * desk due for it and blits pg->pix once; pager_button_press_event() finds
+ * the desk under the pointer by dividing by the cell pitch.  This keeps the
+ * X window and surface count at one for WMs with dozens of workspaces.
+ *
  * TASK LIFECYCLE
  * --------------
  * do_net_client_list_stacking() rebuilds the task set on every
  * EV_CLIENT_LIST_STACKING event (two-pass stale removal):
  *   - For known windows: increment refcount, update stacking index.
  *   - For new windows: allocate task, install per-window GDK filter,
- *     query desktop/state/geometry/icon.
+ *     query desktop/state/geometry/icon and find the WM frame.
  *   - task_remove_stale() called via g_hash_table_foreach_remove():
  *     deletes tasks whose refcount was 0 before the increment step.
- *     Note: BUG-023 — task_remove_stale does NOT free t->pixbuf.
  *
  * GDK FILTER
  * ----------
  * pager_event_filter() is installed on each task's GdkWindow (via
- * gdk_window_add_filter).  It handles PropertyNotify (NET_WM_STATE,
- * NET_WM_DESKTOP) and ConfigureNotify (window moves/resizes), marking the
- * relevant desk(s) dirty.  The filter is removed and gdkwin unreffed in
- * task_remove_stale() / task_remove_all().
+ * gdk_window_add_filter), and on its WM frame window if it has one.  It
+ * handles PropertyNotify (NET_WM_STATE, NET_WM_DESKTOP, NET_WM_ICON,
+ * WM_HINTS), damaging the task's old and new rectangles, and ConfigureNotify
+ * / ReparentNotify.  Window geometry is taken from the ConfigureNotify
+ * payload (client or frame), so moving a window costs no round trips; the
+ * old and new rectangles are damaged once per main loop iteration by
+ * pager_flush_moves().  The filters are removed and gdkwin/gdkframe unreffed
+ * in task_remove_stale() / task_remove_all().
+ *
+ * LIVE THUMBNAILS
+ * ---------------
+ * With ShowThumbnails and a compositing manager, tasks are drawn as
+ * server-side scaled captures of their frames (winthumb_capture) instead of
+ * a flat rectangle and icon.  Each frame carries an XDamage object; a
+ * DamageNotify only marks the task stale.  pager_thumb_tick() recaptures
+ * one stale task on the current desktop per 1000 / ThumbnailRate ms, so the
+ * CPU and X traffic spent on thumbnails is bounded by the configured rate.
  *
  * WALLPAPER
  * ---------
- * The wallpaper feature (config: showwallpaper) allocates a FbBg reference and
- * a per-desk gpix surface.  desk_draw_bg() is currently a no-op stub (GTK3 port
- * incomplete), so the wallpaper code path fills pix from gpix, but gpix itself
- * is always blank.  The feature is effectively non-functional but harmless.
+ * With ShowWallpaper the pager holds a FbBg reference.  On every FbBg
+ * "changed" signal, pager_bg_changed() downscales the current root pixmap
+ * (_XROOTPMAP_ID) once, from FbBg's CPU-side cache, into a desk-sized
+ * thumbnail stored in pg->walls, keyed by the Pixmap XID.  Desks do not own
+ * surfaces: desk::wall names the pixmap to show (None = the current one), so
+ * all desks sharing a wallpaper paint the same surface.
+ *
+ * Some WMs (fluxbox and E16 workspace backgrounds, fbsetbg-style scripts)
+ * give every desktop its own wallpaper by replacing _XROOTPMAP_ID on each
+ * desktop switch.  A switch "hits" when the first root pixmap change after
+ * it comes within WALL_SWITCH_US; WALL_HITS consecutive hits enable
+ * per-desktop mode, in which each desk remembers the pixmap it last showed
+ * as current.  The mode is reversible: a switch with no new root pixmap
+ * within WALL_SWITCH_US (pager_wall_check), or a change outside a switch
+ * while still counting hits, resets the count and every desk::wall to None,
+ * so a slideshow or manual change that happens to follow a switch cannot
+ * leave desks stuck on stale wallpapers.  A per-desktop WM switching
+ * between two desks with the same pixmap also turns the mode off; it comes
+ * back after the next WALL_HITS hits.  Thumbnails no desk refers to are
+ * dropped by
+ * pager_wall_prune(), so memory grows with the number of distinct
+ * wallpapers, not with the number of desktops.
  *
  * KNOWN ISSUES
  * ------------
@@ -58,11 +105,8 @@
  * BUG-019: scalew/scaleh naming is swapped relative to conventional meaning
  *          (scalew = desk_h/screen_h, scaleh = desk_w/screen_w); harmless
  *          because values are equal when the desk aspect ratio is correct.
- * BUG-020: pg->gen_pixbuf is not g_object_unref'd in pager_destructor.
  * BUG-021: pager_priv::dirty field is declared but never read or written.
  * BUG-022: desk::first is set in desk_new() but never read.
- * BUG-023: task_remove_stale() does not free t->pixbuf; leaks one GdkPixbuf
- *          per task removed during normal operation.
  */
 
 /* pager.c -- pager module of fbpanel project
@@ -94,7 +138,6 @@
 
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
-#include <gdk-pixbuf-xlib/gdk-pixbuf-xlib.h>
 #include <gdk/gdk.h>
 #include <gdk/gdkx.h>
 #include <cairo/cairo.h>
@@ -135,39 +178,66 @@ typedef struct _task {
     char *name, *iname;     /**< NOTE: declared but never written; always NULL. (BUG-018) */
     net_wm_state nws;       /**< Parsed _NET_WM_STATE flags (hidden, shaded, skip_pager). */
     net_wm_window_type nwwt;/**< Parsed _NET_WM_WINDOW_TYPE flags (desktop, dock, etc). */
-    GdkPixbuf *pixbuf;      /**< Task icon (16x16); (transfer full); may be NULL.
-                             *   NOT freed by task_remove_stale (BUG-023);
-                             *   freed by task_remove_all at destructor time. */
-    unsigned int using_netwm_icon:1; /**< TRUE if pixbuf came from _NET_WM_ICON. */
+    GdkPixbuf *pixbuf;      /**< Task icon (16x16) from the window icon cache;
+                             *   (transfer full); may be NULL. */
+    Window frame;           /**< Ancestor of win that is a child of the root window:
+                             *   the WM frame, or win itself without a reparenting WM.
+                             *   None if unknown.  Set by task_set_frame(). */
+    Window parent;          /**< Direct parent of win when the frame was looked up. */
+    GdkWindow *gdkframe;    /**< GDK wrapper for frame holding pager_event_filter;
+                             *   NULL unless frame != win.  Keyed in pg->ftable. */
+    int fx, fy;             /**< Frame position (root-relative outer corner, pixels). */
+    guint fbw;              /**< Frame border width (pixels). */
+    int mx, my;             /**< Position when moved was set, i.e. as last damaged. */
+    guint mw, mh;           /**< Size when moved was set. */
+    unsigned int moved:1;   /**< Geometry changed since the last pager_flush_moves(). */
+    unsigned int thumb_stale:1; /**< Window contents changed since thumb was captured. */
+    cairo_surface_t *thumb; /**< Live thumbnail (RGB24) from winthumb_capture(); NULL
+                             *   until captured or without thumbnail mode. */
+    gint64 thumb_time;      /**< Monotonic time of the last capture (microseconds). */
+    gulong damage;          /**< XDamage id on frame from winthumb_watch(); 0 if none. */
 } task;
 
 typedef struct _desk   desk;
 typedef struct _pager_priv  pager_priv;
 
 /** Maximum number of virtual desktops the pager supports. */
-#define MAX_DESK_NUM   20
+#define MAX_DESK_NUM   64
+
+/** Space between desks, in pixels, as in the GtkBox of desk widgets. */
+#define DESK_GAP       1
 
 /**
  * desk - per-virtual-desktop thumbnail state.
  *
  * Created by desk_new(); destroyed by desk_free().
- * Owns the GtkDrawingArea `da` (added to pg->box), the off-screen backing
- * surface `pix`, and the wallpaper cache `gpix`.
+ * Owns the GtkDrawingArea `da` (added to pg->box) and the off-screen backing
+ * surface `pix`; with SingleSurface, `da` is NULL and `pix` is a sub-surface
+ * of pg->pix.  The wallpaper thumbnail is shared; see pager_priv::walls.
  */
 struct _desk {
     GtkWidget *da;          /**< GtkDrawingArea for this desktop thumbnail.
                              *   Owned by the GTK container pg->box;
-                             *   gtk_widget_destroy'd in desk_free(). */
-    Pixmap xpix;            /**< X11 Pixmap for wallpaper (stub; never assigned). */
-    cairo_surface_t *gpix;  /**< Wallpaper cache surface (CAIRO_FORMAT_RGB24, desk size).
-                             *   Allocated in desk_configure_event when pg->wallpaper.
-                             *   cairo_surface_destroy'd in desk_configure_event (resize)
-                             *   and desk_free(). desk_draw_bg() is currently a no-op. */
+                             *   gtk_widget_destroy'd in desk_free().
+                             *   NULL with SingleSurface (pg->da draws all desks). */
+    Pixmap wall;            /**< Root pixmap whose thumbnail this desk shows (key in
+                             *   pg->walls); None to show the current root pixmap.
+                             *   Bound while counting switch hits; painted only
+                             *   in per-desktop wallpaper mode. */
     cairo_surface_t *pix;   /**< Off-screen backing buffer (CAIRO_FORMAT_RGB24, desk size).
                              *   Rebuilt on configure_event; blitted to GDK in draw event.
-                             *   cairo_surface_destroy'd in desk_configure_event and desk_free(). */
+                             *   cairo_surface_destroy'd in desk_configure_event and desk_free().
+                             *   With SingleSurface, a sub-surface of pg->pix. */
+    int x, y;               /**< Position of pix in its widget; 0, 0 unless SingleSurface. */
+    int w, h;               /**< Size of pix (pixels); 0 until laid out. */
     guint no;               /**< Desktop number (0-based index). */
-    guint dirty;            /**< Non-zero: backing surface needs redraw before next paint. */
+    guint dirty;            /**< Non-zero: whole backing surface needs redraw before next paint. */
+    cairo_region_t *damage; /**< Areas of pix to repaint before next paint when not dirty;
+                             *   NULL if none.  Emptied by desk_draw_event(). */
+    GdkRGBA fg_sel, bg_sel; /**< Theme SELECTED foreground/background colours of da. */
+    GdkRGBA fg_norm, bg_norm;/**< Theme NORMAL foreground/background colours of da.
+                             *   All four resolved by desk_style_updated(), so
+                             *   redraws make no style context lookups. */
     guint first;            /**< Set to 1 in desk_new(); never read. (BUG-022) */
     gfloat scalew;          /**< Scale from screen height to desk height (desk_h/screen_h).
                              *   Used to scale task x-pos and width. Naming is swapped
@@ -204,11 +274,37 @@ struct _pager_priv {
                                      *   NULL'd by task_remove_stale when the task is removed. */
     FbBg *fbbg;                     /**< FbBg singleton ref; (transfer full, g_object_unref).
                                      *   Only acquired when pg->wallpaper is TRUE. */
+    GHashTable *walls;              /**< Pixmap -> cairo_surface_t* wallpaper thumbnails
+                                     *   (RGB24, desk size); (transfer full) values.
+                                     *   NULL unless pg->wallpaper. */
+    Pixmap wall_root;               /**< Root pixmap as of the last "changed" signal. */
+    gboolean wall_per_desk;         /**< The WM switches wallpapers with desktops. */
+    guint wall_hits;                /**< Consecutive desktop switches followed by a new
+                                     *   root pixmap; per-desktop mode from WALL_HITS. */
+    gint64 wall_time;               /**< Monotonic time of the last root pixmap change. */
+    guint wall_timer;               /**< Timeout running pager_wall_check(); 0 if idle. */
+    guint prevdesk;                 /**< Current desktop before the last switch. */
+    gint64 switch_time;             /**< Monotonic time of the last desktop switch. */
     gint dah, daw;                  /**< Desk area height and width (pixels); computed from
                                      *   panel dimensions and monitor aspect ratio. */
+    GHashTable *ftable;             /**< Frame Window -> task* map; key is &task::frame.
+                                     *   Holds only tasks with a gdkframe. */
+    guint move_idle;                /**< Idle source running pager_flush_moves(); 0 if none. */
+    gint single;                    /**< Config: one widget and surface for all desks
+                                     *   (SingleSurface). */
+    gint rows;                      /**< Config: grid lines with SingleSurface (Rows);
+                                     *   columns on a vertical panel. */
+    guint cols, lines;              /**< SingleSurface grid size in desks; set by
+                                     *   pager_grid_size(). */
+    GtkWidget *da;                  /**< SingleSurface drawing area in pg->box; else NULL. */
+    cairo_surface_t *pix;           /**< SingleSurface backing surface (RGB24, da size);
+                                     *   parent of every desk's pix.  NULL otherwise. */
+    gint thumbnails;                /**< Config: draw live window thumbnails (ShowThumbnails). */
+    gint thumb_rate;                /**< Config: max thumbnail captures per second
+                                     *   (ThumbnailRate, 1..60). */
+    guint thumb_timer;              /**< Timeout running pager_thumb_tick(); 0 if idle. */
     GdkPixbuf *gen_pixbuf;          /**< Default icon used for tasks without icons (transfer full).
-                                     *   Loaded from default.xpm at construction.
-                                     *   NOT freed in pager_destructor (BUG-020). */
+                                     *   Shared default.xpm pixbuf from the pixbuf cache. */
 };
 
 
@@ -225,14 +321,15 @@ struct _pager_priv {
 
 
 static void pager_rebuild_all(FbEv *ev, pager_priv *pg);
-static void desk_draw_bg(pager_priv *pg, desk *d1);
 static GdkFilterReturn pager_event_filter(XEvent *, GdkEvent *, pager_priv *);
 
 static void pager_destructor(plugin_instance *p);
 
-static inline void desk_set_dirty_by_win(pager_priv *p, task *t);
+static void desk_damage_by_win(pager_priv *p, task *t);
+static void task_unset_frame(pager_priv *p, task *t);
+static void task_flush_move(Window *win, task *t, pager_priv *p);
+static void pager_thumb_schedule(pager_priv *pg);
 static inline void desk_set_dirty(desk *d);
-static inline void desk_set_dirty_all(pager_priv *pg);
 
 #ifdef EXTRA_DEBUG
 static pager_priv *cp;
@@ -273,23 +370,27 @@ sig_usr(int signum)
  * before the increment (now 0 after post-decrement) was absent from the list
  * and is removed.
  *
- * Note: does NOT free t->pixbuf (BUG-023).
- *
  * Returns: TRUE to remove and free the hash entry; FALSE to keep.
  */
 static gboolean
 task_remove_stale(Window *win, task *t, pager_priv *p)
 {
     if (t->refcount-- == 0) {
-        desk_set_dirty_by_win(p, t);
+        task_flush_move(win, t, p);
+        desk_damage_by_win(p, t);
         if (p->focusedtask == t)
             p->focusedtask = NULL;
         DBG("del %lx\n", t->win);
+        task_unset_frame(p, t);
+        if (t->thumb)
+            cairo_surface_destroy(t->thumb);
         if (t->gdkwin) {
             gdk_window_remove_filter(t->gdkwin,
                     (GdkFilterFunc)pager_event_filter, p);
             g_object_unref(t->gdkwin);
         }
+        if (t->pixbuf != NULL)
+            g_object_unref(t->pixbuf);
         g_free(t);
         return TRUE;
     }
@@ -304,7 +405,8 @@ task_remove_stale(Window *win, task *t, pager_priv *p)
  *
  * Called via g_hash_table_foreach_remove() during pager_destructor() and
  * pager_rebuild_all() (after desk count change).  Removes the per-window
- * GDK filter, unrefs gdkwin, and frees t->pixbuf if set.
+ * GDK filters, unrefs gdkwin and gdkframe, and frees t->pixbuf and
+ * t->thumb if set.
  *
  * Returns: TRUE always (remove all).
  */
@@ -313,6 +415,9 @@ task_remove_all(Window *win, task *t, pager_priv *p)
 {
     if (t->pixbuf != NULL)
         g_object_unref(t->pixbuf);
+    task_unset_frame(p, t);
+    if (t->thumb)
+        cairo_surface_destroy(t->thumb);
     if (t->gdkwin) {
         gdk_window_remove_filter(t->gdkwin,
                 (GdkFilterFunc)pager_event_filter, p);
@@ -363,85 +468,209 @@ task_get_sizepos(task *t)
 
 
 /**
- * task_update_pix - draw one task's scaled rectangle into a desk's backing surface.
- * @t: Task to draw. (transfer none)
- * @d: Desk whose pix surface to draw into. (transfer none)
+ * task_set_frame - find and track the frame a window manager put a task in.
+ * @p: Pager instance. (transfer none)
+ * @t: Task whose position task_get_sizepos() has just read. (transfer none)
+ *
+ * Walks up from t->win with XQueryTree() to the child of the root window.
+ * With a reparenting WM that is the frame: StructureNotifyMask is selected
+ * on it and pager_event_filter installed, so frame moves arrive as
+ * ConfigureNotify in root coordinates and pager_configurenotify() can track
+ * the task without querying the server.  These round trips happen only when
+ * a window is first seen and when it is reparented.
  *
- * Skips tasks that are:
+ * In thumbnail mode the frame (or unparented window) is also watched for
+ * damage, and a first capture is scheduled.
+ */
+static void
+task_set_frame(pager_priv *p, task *t)
+{
+    Window root, parent, *children, w;
+    unsigned int n, fw, fh, fbw, depth;
+    int fx, fy;
+
+    t->frame = t->parent = None;
+    for (w = t->win; ; w = parent) {
+        if (!XQueryTree(GDK_DPY, w, &root, &parent, &children, &n))
+            return;
+        if (children)
+            XFree(children);
+        if (t->parent == None)
+            t->parent = parent;
+        if (parent == root || parent == None)
+            break;
+    }
+    if (w == t->win) {
+        t->frame = w;
+        goto watch;
+    }
+    if (!XGetGeometry(GDK_DPY, w, &root, &fx, &fy, &fw, &fh, &fbw, &depth))
+        return;
+    t->frame = w;
+    t->fx = fx;
+    t->fy = fy;
+    t->fbw = fbw;
+    XSelectInput(GDK_DPY, w, StructureNotifyMask);
+    t->gdkframe = gdk_x11_window_foreign_new_for_display(
+            gdk_display_get_default(), w);
+    if (t->gdkframe) {
+        gdk_window_add_filter(t->gdkframe,
+                (GdkFilterFunc)pager_event_filter, p);
+        g_hash_table_insert(p->ftable, &t->frame, t);
+    }
+    DBG("win=0x%lx frame=0x%lx\n", t->win, t->frame);
+
+watch:
+    if (p->thumbnails) {
+        t->damage = winthumb_watch(t->frame);
+        t->thumb_stale = 1;
+        pager_thumb_schedule(p);
+    }
+    return;
+}
+
+/**
+ * task_unset_frame - stop tracking a task's frame window.
+ * @p: Pager instance. (transfer none)
+ * @t: Task. (transfer none)
+ */
+static void
+task_unset_frame(pager_priv *p, task *t)
+{
+    winthumb_unwatch(t->damage);
+    t->damage = 0;
+    if (t->gdkframe) {
+        g_hash_table_remove(p->ftable, &t->frame);
+        gdk_window_remove_filter(t->gdkframe,
+                (GdkFilterFunc)pager_event_filter, p);
+        g_object_unref(t->gdkframe);
+        t->gdkframe = NULL;
+    }
+    t->frame = t->parent = None;
+    return;
+}
+
+
+/**
+ * task_get_rect - compute a task's scaled rectangle on a desk.
+ * @t: Task. (transfer none)
+ * @d: Desk. (transfer none)
+ * @r: (out) Rectangle in desk pixels, as passed to cairo_rectangle().
+ *
+ * Tasks are not drawn when they are:
  *  - not TASK_VISIBLE (hidden or skip_pager)
  *  - on a different desktop than d->no (unless desktop > desknum, shown on all)
  *  - too small after scaling (w<3 or h<3 pixels)
  *
- * Draws onto d->pix:
- *  1. Filled rectangle in the GTK SELECTED background colour (focused task) or
- *     NORMAL background colour (unfocused).
- *  2. Outlined rectangle in the corresponding foreground colour.
- *  3. If the scaled rectangle is at least 10x10: draws t->pixbuf (or
- *     pg->gen_pixbuf as fallback) centred within the rectangle, scaling the
- *     icon down if the rectangle is smaller than 18x18.
- *
  * For shaded windows, height is clamped to 3 pixels.
  *
  * Note: BUG-019 — scalew and scaleh names are swapped vs conventional usage,
  * but values are equal for a correctly-proportioned desk, so rendering is correct.
+ *
+ * Returns: TRUE if the task is drawn on @d.
  */
-static void
-task_update_pix(task *t, desk *d)
+static gboolean
+task_get_rect(task *t, desk *d, GdkRectangle *r)
 {
-    int x, y, w, h;
-    GtkWidget *widget;
-    cairo_t *cr;
-    GtkStyleContext *ctx;
-    GdkRGBA fg_sel, fg_norm, bg_sel, bg_norm;
-
-    g_return_if_fail(d->pix != NULL);
     if (!TASK_VISIBLE(t))
-        return;
+        return FALSE;
 
     if (t->desktop < d->pg->desknum &&
           t->desktop != d->no)
-        return;
+        return FALSE;
 
-    x = (gfloat)t->x * d->scalew;
-    y = (gfloat)t->y * d->scaleh;
-    w = (gfloat)t->w * d->scalew;
-    //h = (gfloat)t->h * d->scaleh;
-    h = (t->nws.shaded) ? 3 : (gfloat)t->h * d->scaleh;
-    if (w < 3 || h < 3)
-        return;
-    widget = GTK_WIDGET(d->da);
+    r->x = (gfloat)t->x * d->scalew;
+    r->y = (gfloat)t->y * d->scaleh;
+    r->width = (gfloat)t->w * d->scalew;
+    r->height = (t->nws.shaded) ? 3 : (gfloat)t->h * d->scaleh;
+    return (r->width >= 3 && r->height >= 3);
+}
 
-    ctx = gtk_widget_get_style_context(widget);
-    gtk_style_context_save(ctx);
-    gtk_style_context_set_state(ctx, GTK_STATE_FLAG_SELECTED);
-    gtk_style_context_get(ctx, GTK_STATE_FLAG_SELECTED, GTK_STYLE_PROPERTY_BACKGROUND_COLOR, &bg_sel, NULL);
-    gtk_style_context_get_color(ctx, GTK_STATE_FLAG_SELECTED, &fg_sel);
-    gtk_style_context_set_state(ctx, GTK_STATE_FLAG_NORMAL);
-    gtk_style_context_get(ctx, GTK_STATE_FLAG_NORMAL, GTK_STYLE_PROPERTY_BACKGROUND_COLOR, &bg_norm, NULL);
-    gtk_style_context_get_color(ctx, GTK_STATE_FLAG_NORMAL, &fg_norm);
-    gtk_style_context_restore(ctx);
+/**
+ * task_get_damage - the area of a desk that task_update_pix() paints.
+ * @t: Task. (transfer none)
+ * @d: Desk. (transfer none)
+ * @r: (out) Rectangle in desk pixels.
+ *
+ * The task rectangle grown by one pixel on each side for the outline, which
+ * is stroked with cairo's default 2 px line width.
+ *
+ * Returns: TRUE if the task is drawn on @d.
+ */
+static gboolean
+task_get_damage(task *t, desk *d, GdkRectangle *r)
+{
+    if (!task_get_rect(t, d, r))
+        return FALSE;
+    r->x -= 1;
+    r->y -= 1;
+    r->width += 2;
+    r->height += 2;
+    return TRUE;
+}
 
-    cr = cairo_create(d->pix);
+/**
+ * task_update_pix - draw one task's scaled rectangle into a desk's backing surface.
+ * @t:  Task to draw. (transfer none)
+ * @d:  Desk whose pix surface is drawn into. (transfer none)
+ * @cr: Cairo context on d->pix, clipped by the caller. (transfer none)
+ *
+ * Skips tasks that task_get_rect() says are not drawn on @d.
+ *
+ * Draws onto d->pix:
+ *  1. The live thumbnail t->thumb if there is one; otherwise a filled
+ *     rectangle in the desk's cached SELECTED background colour (focused
+ *     task) or NORMAL background colour (unfocused).
+ *  2. Outlined rectangle in the corresponding foreground colour.
+ *  3. Without a thumbnail, if the rectangle is at least 10x10: draws
+ *     t->pixbuf (or pg->gen_pixbuf as fallback) centred within the
+ *     rectangle, scaling the icon down (via the window icon cache) if the
+ *     rectangle is smaller than 18x18.
+ */
+static void
+task_update_pix(task *t, desk *d, cairo_t *cr)
+{
+    int x, y, w, h;
+    GdkRectangle r;
 
-    /* filled rectangle with bg color */
-    if (d->pg->focusedtask == t)
-        gdk_cairo_set_source_rgba(cr, &bg_sel);
-    else
-        gdk_cairo_set_source_rgba(cr, &bg_norm);
-    cairo_rectangle(cr, x+1, y+1, w-1, h-1);
-    cairo_fill(cr);
+    if (!task_get_rect(t, d, &r))
+        return;
+    x = r.x;
+    y = r.y;
+    w = r.width;
+    h = r.height;
+
+    if (t->thumb) {
+        /* live thumbnail, stretched if captured at another size */
+        cairo_save(cr);
+        cairo_rectangle(cr, x+1, y+1, w-1, h-1);
+        cairo_clip(cr);
+        cairo_translate(cr, x+1, y+1);
+        cairo_scale(cr,
+            (double) (w-1) / cairo_image_surface_get_width(t->thumb),
+            (double) (h-1) / cairo_image_surface_get_height(t->thumb));
+        cairo_set_source_surface(cr, t->thumb, 0, 0);
+        cairo_paint(cr);
+        cairo_restore(cr);
+    } else {
+        /* filled rectangle with bg color */
+        if (d->pg->focusedtask == t)
+            gdk_cairo_set_source_rgba(cr, &d->bg_sel);
+        else
+            gdk_cairo_set_source_rgba(cr, &d->bg_norm);
+        cairo_rectangle(cr, x+1, y+1, w-1, h-1);
+        cairo_fill(cr);
+    }
 
     /* outline rectangle with fg color */
     if (d->pg->focusedtask == t)
-        gdk_cairo_set_source_rgba(cr, &fg_sel);
+        gdk_cairo_set_source_rgba(cr, &d->fg_sel);
     else
-        gdk_cairo_set_source_rgba(cr, &fg_norm);
+        gdk_cairo_set_source_rgba(cr, &d->fg_norm);
     cairo_rectangle(cr, x, y, w-1, h);
     cairo_stroke(cr);
 
-    cairo_destroy(cr);
-
-    if (w>=10 && h>=10) {
+    if (!t->thumb && w>=10 && h>=10) {
         GdkPixbuf* source_buf = t->pixbuf;
         if (source_buf == NULL)
             source_buf = d->pg->gen_pixbuf;
@@ -457,9 +686,14 @@ task_update_pix(task *t, desk *d)
             if (scale % 2 != 0)
                 scale++;
 
-            scaled = gdk_pixbuf_scale_simple(source_buf,
-                                    scale, scale,
-                                    GDK_INTERP_BILINEAR);
+            /* the window icon cache keeps each size it has been asked for */
+            scaled = NULL;
+            if (t->pixbuf != NULL)
+                scaled = get_window_icon(t->win, scale, scale, NULL);
+            if (scaled == NULL)
+                scaled = gdk_pixbuf_scale_simple(source_buf,
+                                        scale, scale,
+                                        GDK_INTERP_BILINEAR);
         }
 
         /* position */
@@ -467,186 +701,370 @@ task_update_pix(task *t, desk *d)
         int pixy = y+((h/2)-(scale/2))+1;
 
         /* draw pixbuf via cairo */
-        cr = cairo_create(d->pix);
         gdk_cairo_set_source_pixbuf(cr, scaled, pixx, pixy);
         cairo_paint(cr);
-        cairo_destroy(cr);
 
-        /* free it if its been scaled and its not the default */
-        if (!noscale && t->pixbuf != NULL)
+        /* drop the reference taken above; the unscaled icon is borrowed */
+        if (!noscale)
             g_object_unref(scaled);
     }
     return;
 }
 
 
+/*****************************************************************
+ * Wallpaper                                                     *
+ *****************************************************************/
+
+/** A root pixmap change this soon after a desktop switch belongs to it. */
+#define WALL_SWITCH_US  G_USEC_PER_SEC
+/** Consecutive switch-and-change hits that enable per-desktop mode. */
+#define WALL_HITS       2
+
+/**
+ * pager_wall_render - downscale the current root pixmap into pg->walls.
+ * @pg:    Pager instance. (transfer none)
+ * @w:     Thumbnail width; -1 for the size of desk 0.
+ * @h:     Thumbnail height; -1 for the size of desk 0.
+ * @force: Render even if a thumbnail of that size exists (the pixmap XID
+ *         may have been reused for a new wallpaper).
+ *
+ * The area scaled is the primary monitor's size from the root origin, the
+ * same mapping task_get_rect() uses for windows.  If FbBg cannot provide
+ * the pixmap, a forced render drops the entry rather than keep stale pixels.
+ */
+static void
+pager_wall_render(pager_priv *pg, int w, int h, gboolean force)
+{
+    cairo_surface_t *s;
+    GdkRectangle geom;
+
+    if (pg->wall_root == None)
+        return;
+    if (w < 0 || h < 0) {
+        if (pg->desknum && pg->desks[0]->pix) {
+            w = pg->desks[0]->w;
+            h = pg->desks[0]->h;
+        } else {
+            w = pg->daw;
+            h = pg->dah;
+        }
+    }
+    s = g_hash_table_lookup(pg->walls, GUINT_TO_POINTER(pg->wall_root));
+    if (!force && s && cairo_image_surface_get_width(s) == w
+          && cairo_image_surface_get_height(s) == h)
+        return;
+    gdk_monitor_get_geometry(
+        gdk_display_get_primary_monitor(gdk_display_get_default()), &geom);
+    s = fb_bg_get_xroot_pix_scaled(pg->fbbg, 0, 0, geom.width, geom.height,
+        w, h);
+    DBG("pixmap %lx -> %dx%d %p\n", pg->wall_root, w, h, s);
+    if (s)
+        g_hash_table_replace(pg->walls, GUINT_TO_POINTER(pg->wall_root), s);
+    else
+        g_hash_table_remove(pg->walls, GUINT_TO_POINTER(pg->wall_root));
+    return;
+}
+
+/**
+ * pager_wall_unused - g_hash_table_foreach_remove() callback for pruning.
+ *
+ * Returns: TRUE if @key is neither the root pixmap nor bound to any desk.
+ */
+static gboolean
+pager_wall_unused(gpointer key, gpointer value, pager_priv *pg)
+{
+    Pixmap pix = GPOINTER_TO_UINT(key);
+    int i;
+
+    if (pix == pg->wall_root)
+        return FALSE;
+    for (i = 0; i < pg->desknum; i++)
+        if (pg->desks[i]->wall == pix)
+            return FALSE;
+    DBG("drop pixmap %lx\n", pix);
+    return TRUE;
+}
+
+/**
+ * pager_wall_prune - free wallpaper thumbnails no desk shows any more.
+ * @pg: Pager instance. (transfer none)
+ */
+static void
+pager_wall_prune(pager_priv *pg)
+{
+    g_hash_table_foreach_remove(pg->walls, (GHRFunc) pager_wall_unused, pg);
+    return;
+}
+
+/**
+ * pager_wall_get - the wallpaper thumbnail to paint on a desk.
+ * @pg: Pager instance. (transfer none)
+ * @d:  Desk. (transfer none)
+ *
+ * Returns: (transfer none) the desk's own wallpaper, else the current one,
+ *          else NULL (wallpaper disabled or no root pixmap).
+ */
+static cairo_surface_t *
+pager_wall_get(pager_priv *pg, desk *d)
+{
+    cairo_surface_t *s = NULL;
+
+    if (!pg->walls)
+        return NULL;
+    if (pg->wall_per_desk && d->wall != None)
+        s = g_hash_table_lookup(pg->walls, GUINT_TO_POINTER(d->wall));
+    if (!s && pg->wall_root != None)
+        s = g_hash_table_lookup(pg->walls, GUINT_TO_POINTER(pg->wall_root));
+    return s;
+}
+
+
 /*****************************************************************
  * Desk Functions                                                *
  *****************************************************************/
 
 /**
  * desk_clear_pixmap - fill a desk's backing surface with the background.
- * @d: Desk to clear. (transfer none)
- *
- * If d->pix is NULL (not yet allocated), returns immediately.
+ * @d:  Desk to clear. (transfer none)
+ * @cr: Cairo context on d->pix, clipped by the caller. (transfer none)
  *
- * When pg->wallpaper is TRUE and d->xpix != None:
- *   Copies gpix (wallpaper cache) to pix.  Then if this is the current
- *   desktop, draws a SELECTED-colour border around the thumbnail.
+ * When pg->wallpaper is TRUE and a thumbnail exists for the desk:
+ *   Paints the shared wallpaper thumbnail (pager_wall_get), scaled only if
+ *   it was rendered for another desk size.
  *
- * When pg->wallpaper is FALSE (or xpix is None):
+ * Otherwise:
  *   Fills pix with SELECTED background colour for the current desktop,
- *   NORMAL background colour for all others.
+ *   NORMAL background colour for all others (colours cached on the desk).
  *
- * Note: desk_draw_bg() is a no-op in the GTK3 port, so gpix is always blank.
+ * With wallpaper enabled, the current desktop also gets a SELECTED-colour
+ * border around the thumbnail.
  */
 static void
-desk_clear_pixmap(desk *d)
+desk_clear_pixmap(desk *d, cairo_t *cr)
 {
-    GtkWidget *widget;
-    GtkStyleContext *ctx;
-    GdkRGBA color;
-    cairo_t *cr;
-    GtkAllocation alloc;
+    cairo_surface_t *wall;
+    int w, h, ww, wh;
 
     DBG("d->no=%d\n", d->no);
-    if (!d->pix)
-        return;
-    widget = GTK_WIDGET(d->da);
-    gtk_widget_get_allocation(widget, &alloc);
-    ctx = gtk_widget_get_style_context(widget);
-
-    if (d->pg->wallpaper && d->xpix != None) {
-        /* copy gpix to pix using cairo */
-        cr = cairo_create(d->pix);
-        cairo_set_source_surface(cr, d->gpix, 0, 0);
+    w = d->w;
+    h = d->h;
+
+    if ((wall = pager_wall_get(d->pg, d))) {
+        ww = cairo_image_surface_get_width(wall);
+        wh = cairo_image_surface_get_height(wall);
+        cairo_save(cr);
+        if (ww != w || wh != h)
+            cairo_scale(cr, (double) w / ww, (double) h / wh);
+        cairo_set_source_surface(cr, wall, 0, 0);
         cairo_paint(cr);
-        cairo_destroy(cr);
+        cairo_restore(cr);
     } else {
-        cr = cairo_create(d->pix);
-        gtk_style_context_save(ctx);
-        if (d->no == d->pg->curdesk) {
-            gtk_style_context_set_state(ctx, GTK_STATE_FLAG_SELECTED);
-            gtk_style_context_get(ctx, GTK_STATE_FLAG_SELECTED, GTK_STYLE_PROPERTY_BACKGROUND_COLOR, &color, NULL);
-        } else {
-            gtk_style_context_set_state(ctx, GTK_STATE_FLAG_NORMAL);
-            gtk_style_context_get(ctx, GTK_STATE_FLAG_NORMAL, GTK_STYLE_PROPERTY_BACKGROUND_COLOR, &color, NULL);
-        }
-        gtk_style_context_restore(ctx);
-        gdk_cairo_set_source_rgba(cr, &color);
-        cairo_rectangle(cr, 0, 0, alloc.width, alloc.height);
+        if (d->no == d->pg->curdesk)
+            gdk_cairo_set_source_rgba(cr, &d->bg_sel);
+        else
+            gdk_cairo_set_source_rgba(cr, &d->bg_norm);
+        cairo_rectangle(cr, 0, 0, w, h);
         cairo_fill(cr);
-        cairo_destroy(cr);
     }
     if (d->pg->wallpaper && d->no == d->pg->curdesk) {
-        cr = cairo_create(d->pix);
-        gtk_style_context_save(ctx);
-        gtk_style_context_set_state(ctx, GTK_STATE_FLAG_SELECTED);
-        gtk_style_context_get_color(ctx, GTK_STATE_FLAG_SELECTED, &color);
-        gtk_style_context_restore(ctx);
-        gdk_cairo_set_source_rgba(cr, &color);
-        cairo_rectangle(cr, 0, 0, alloc.width - 1, alloc.height - 1);
+        gdk_cairo_set_source_rgba(cr, &d->fg_sel);
+        cairo_rectangle(cr, 0, 0, w - 1, h - 1);
         cairo_stroke(cr);
-        cairo_destroy(cr);
     }
     return;
 }
 
 
+
 /**
- * desk_draw_bg - render the desktop wallpaper into a desk's gpix surface.
- * @pg: Pager instance. (transfer none)
- * @d1: Desk to update. (transfer none)
+ * desk_set_dirty - mark a whole desk as needing a redraw and queue a GDK draw.
+ * @d: Desk to mark dirty. (transfer none)
+ *
+ * Used when the background changes; task changes use desk_damage_by_win().
+ */
+static inline void
+desk_set_dirty(desk *d)
+{
+    d->dirty = 1;
+    if (d->da)
+        gtk_widget_queue_draw(d->da);
+    else
+        gtk_widget_queue_draw_area(d->pg->da, d->x, d->y, d->w, d->h);
+    return;
+}
+
+/**
+ * desk_damage - add a rectangle to a desk's damage region and queue its draw.
+ * @d: Desk. (transfer none)
+ * @r: Rectangle in desk pixels. (transfer none)
  *
- * STUB: wallpaper rendering is not implemented in the GTK3 port.
- * Returns immediately.
+ * Nothing to do if the whole desk is already due for a redraw.
  */
 static void
-desk_draw_bg(pager_priv *pg, desk *d1)
+desk_damage(desk *d, GdkRectangle *r)
 {
-    /* Wallpaper rendering not supported in GTK3 port */
+    if (d->dirty || !d->pix)
+        return;
+    if (d->damage)
+        cairo_region_union_rectangle(d->damage, r);
+    else
+        d->damage = cairo_region_create_rectangle(r);
+    gtk_widget_queue_draw_area(d->da ? d->da : d->pg->da,
+        d->x + r->x, d->y + r->y, r->width, r->height);
     return;
 }
 
+/**
+ * desk_damage_by_win - damage the area a task covers on every desk showing it.
+ * @p: Pager instance. (transfer none)
+ * @t: Task that changed or is about to change. (transfer none)
+ *
+ * Called both before a change (to erase the task where it was) and after it
+ * (to draw it where it is now).  Sticky windows (desktop >= desknum) damage
+ * the same small area on every desk rather than dirtying them all.
+ * Skips tasks with skip_pager or _NET_WM_WINDOW_TYPE_DESKTOP set.
+ */
+static void
+desk_damage_by_win(pager_priv *p, task *t)
+{
+    GdkRectangle r;
+    int i;
 
+    if (t->nws.skip_pager || t->nwwt.desktop /*|| t->nwwt.dock || t->nwwt.splash*/ )
+        return;
+    for (i = 0; i < p->desknum; i++)
+        if (task_get_damage(t, p->desks[i], &r))
+            desk_damage(p->desks[i], &r);
+    return;
+}
 
 /**
- * desk_set_dirty - mark a desk as needing a redraw and queue a GDK draw.
- * @d: Desk to mark dirty. (transfer none)
+ * task_flush_move - GHFunc: damage a moved task where it was and where it is.
+ * @win: Hash table key (unused). (transfer none)
+ * @t:   Task. (transfer none)
+ * @p:   Pager instance. (transfer none)
  */
-static inline void
-desk_set_dirty(desk *d)
+static void
+task_flush_move(Window *win, task *t, pager_priv *p)
 {
-    d->dirty = 1;
-    gtk_widget_queue_draw(d->da);
+    task old;
+
+    if (!t->moved)
+        return;
+    t->moved = 0;
+    old = *t;
+    old.x = t->mx;
+    old.y = t->my;
+    old.w = t->mw;
+    old.h = t->mh;
+    desk_damage_by_win(p, &old);
+    desk_damage_by_win(p, t);
     return;
 }
 
 /**
- * desk_set_dirty_all - mark every desk dirty and queue redraws.
- * @pg: Pager instance. (transfer none)
+ * pager_flush_moves - idle callback; damages all tasks moved since last run.
+ * @p: Pager instance. (transfer none)
+ *
+ * Runs at G_PRIORITY_HIGH_IDLE, ahead of GDK's redraw, so the burst of
+ * ConfigureNotify events that arrives while a window is dragged costs one
+ * damage pass per frame and only the start and end positions are repainted.
+ *
+ * Returns: FALSE (one-shot source).
  */
-static inline void
-desk_set_dirty_all(pager_priv *pg)
+static gboolean
+pager_flush_moves(pager_priv *p)
 {
-    int i;
-    for (i = 0; i < pg->desknum; i++)
-        desk_set_dirty(pg->desks[i]);
-    return;
+    p->move_idle = 0;
+    g_hash_table_foreach(p->htable, (GHFunc) task_flush_move, p);
+    return FALSE;
 }
 
 /**
- * desk_set_dirty_by_win - mark the desk(s) affected by a task change as dirty.
+ * task_move_begin - record a task's geometry before it changes.
  * @p: Pager instance. (transfer none)
- * @t: Task that changed. (transfer none)
+ * @t: Task about to be moved or resized. (transfer none)
  *
- * Skips tasks with skip_pager or _NET_WM_WINDOW_TYPE_DESKTOP set.
- * Marks t->desktop if it is a valid desktop index; otherwise marks all desks
- * (for sticky windows where desktop >= desknum).
+ * The first call after a flush saves the geometry to damage later and
+ * schedules pager_flush_moves().
  */
-static inline void
-desk_set_dirty_by_win(pager_priv *p, task *t)
+static void
+task_move_begin(pager_priv *p, task *t)
 {
-    if (t->nws.skip_pager || t->nwwt.desktop /*|| t->nwwt.dock || t->nwwt.splash*/ )
+    if (t->moved)
         return;
-    if (t->desktop < p->desknum)
-        desk_set_dirty(p->desks[t->desktop]);
-    else
-        desk_set_dirty_all(p);
+    t->moved = 1;
+    t->mx = t->x;
+    t->my = t->y;
+    t->mw = t->w;
+    t->mh = t->h;
+    if (!p->move_idle)
+        p->move_idle = g_idle_add_full(G_PRIORITY_HIGH_IDLE,
+                (GSourceFunc) pager_flush_moves, p, NULL);
     return;
 }
 
 /**
- * desk_draw_event - GDK "draw" signal handler for a desk's GtkDrawingArea.
- * @widget: The GtkDrawingArea. (transfer none)
- * @cr:     Cairo context provided by GDK for this draw cycle. (transfer none)
- * @d:      The desk this drawing area belongs to. (transfer none)
+ * desk_refresh - bring a desk's backing surface up to date.
+ * @d: The desk. (transfer none)
  *
  * If d->dirty: clears the backing surface (desk_clear_pixmap), then calls
  * task_update_pix() for every window in pg->wins[] in stacking order.
- *
- * Blits d->pix onto cr via cairo_set_source_surface + cairo_paint.
- *
- * Returns FALSE (allow further signal handlers; GTK convention for draw).
+ * Otherwise, if there is damage: does the same clipped to d->damage, skipping
+ * tasks outside it.  Either way d->damage is emptied.
  */
-static gint
-desk_draw_event (GtkWidget *widget, cairo_t *cr, desk *d)
+static void
+desk_refresh(desk *d)
 {
     DBG("d->no=%d\n", d->no);
 
-    if (d->dirty) {
+    if (d->pix && (d->dirty || d->damage)) {
         pager_priv *pg = d->pg;
+        GdkRectangle r;
+        cairo_t *pcr;
         task *t;
         int j;
 
-        d->dirty = 0;
-        desk_clear_pixmap(d);
+        pcr = cairo_create(d->pix);
+        if (!d->dirty) {
+            gdk_cairo_region(pcr, d->damage);
+            cairo_clip(pcr);
+        }
+        desk_clear_pixmap(d, pcr);
         for (j = 0; j < pg->winnum; j++) {
             if (!(t = g_hash_table_lookup(pg->htable, &pg->wins[j])))
                 continue;
-            task_update_pix(t, d);
+            if (!d->dirty && (!task_get_damage(t, d, &r)
+                    || cairo_region_contains_rectangle(d->damage, &r)
+                    == CAIRO_REGION_OVERLAP_OUT))
+                continue;
+            task_update_pix(t, d, pcr);
         }
+        cairo_destroy(pcr);
+    }
+    d->dirty = 0;
+    if (d->damage) {
+        cairo_region_destroy(d->damage);
+        d->damage = NULL;
     }
+    return;
+}
+
+/**
+ * desk_draw_event - GDK "draw" signal handler for a desk's GtkDrawingArea.
+ * @widget: The GtkDrawingArea. (transfer none)
+ * @cr:     Cairo context provided by GDK for this draw cycle. (transfer none)
+ * @d:      The desk this drawing area belongs to. (transfer none)
+ *
+ * Refreshes d->pix (desk_refresh) and blits it onto cr.
+ *
+ * Returns FALSE (allow further signal handlers; GTK convention for draw).
+ */
+static gint
+desk_draw_event (GtkWidget *widget, cairo_t *cr, desk *d)
+{
+    desk_refresh(d);
     if (d->pix) {
         cairo_set_source_surface(cr, d->pix, 0, 0);
         cairo_paint(cr);
@@ -656,42 +1074,42 @@ desk_draw_event (GtkWidget *widget, cairo_t *cr, desk *d)
 
 
 /**
- * desk_configure_event - GDK "configure_event" handler; reallocates backing surfaces.
- * @widget: The GtkDrawingArea. (transfer none)
- * @event:  Configure event (contains new size). (transfer none)
- * @d:      The desk. (transfer none)
- *
- * Destroys old d->pix (and d->gpix if wallpaper enabled) and creates new ones
- * sized to the widget's current allocation.
+ * desk_set_geometry - place a desk in its widget and recreate its surface.
+ * @d: The desk. (transfer none)
+ * @x: Left edge in the widget (0 unless SingleSurface).
+ * @y: Top edge in the widget.
+ * @w: Width in pixels.
+ * @h: Height in pixels.
+ *
+ * Destroys old d->pix and creates a new one of @w x @h: an image surface,
+ * or with SingleSurface a sub-surface of pg->pix at @x, @y.  For desk 0,
+ * also renders the current wallpaper thumbnail again if it was rendered for
+ * another size.  Marks the desk dirty.
  *
  * Recomputes d->scalew and d->scaleh from the primary monitor geometry:
- *   scalew = alloc.height / monitor_height   (scale for x/width)
- *   scaleh = alloc.width  / monitor_width    (scale for y/height)
+ *   scalew = h / monitor_height   (scale for x/width)
+ *   scaleh = w / monitor_width    (scale for y/height)
  * The naming appears swapped vs convention but the values are equal for a
  * correctly-proportioned desk, so rendering is unaffected (BUG-019).
- *
- * Returns FALSE.
  */
-static gint
-desk_configure_event (GtkWidget *widget, GdkEventConfigure *event, desk *d)
+static void
+desk_set_geometry(desk *d, int x, int y, int w, int h)
 {
-    int w, h;
-    GtkAllocation alloc;
-
-    gtk_widget_get_allocation(widget, &alloc);
-    w = alloc.width;
-    h = alloc.height;
-
-    DBG("d->no=%d %dx%d %dx%d\n", d->no, w, h, d->pg->daw, d->pg->dah);
+    DBG("d->no=%d %dx%d%+d%+d %dx%d\n", d->no, w, h, x, y,
+        d->pg->daw, d->pg->dah);
     if (d->pix)
         cairo_surface_destroy(d->pix);
-    if (d->gpix)
-        cairo_surface_destroy(d->gpix);
-    d->pix = cairo_image_surface_create(CAIRO_FORMAT_RGB24, w, h);
-    if (d->pg->wallpaper) {
-        d->gpix = cairo_image_surface_create(CAIRO_FORMAT_RGB24, w, h);
-        desk_draw_bg(d->pg, d);
-    }
+    d->x = x;
+    d->y = y;
+    d->w = w;
+    d->h = h;
+    if (d->pg->pix)
+        d->pix = cairo_surface_create_for_rectangle(d->pg->pix, x, y, w, h);
+    else
+        d->pix = cairo_image_surface_create(CAIRO_FORMAT_RGB24, w, h);
+    /* desks may differ by a pixel; the others scale desk 0's thumbnail */
+    if (d->pg->wallpaper && d->no == 0)
+        pager_wall_render(d->pg, w, h, FALSE);
     {
         GdkMonitor *mon = gdk_display_get_primary_monitor(gdk_display_get_default());
         GdkRectangle geom;
@@ -700,9 +1118,64 @@ desk_configure_event (GtkWidget *widget, GdkEventConfigure *event, desk *d)
         d->scaleh = (gfloat)w / (gfloat)geom.width;
     }
     desk_set_dirty(d);
+    return;
+}
+
+/**
+ * desk_configure_event - GDK "configure_event" handler; reallocates backing surface.
+ * @widget: The GtkDrawingArea. (transfer none)
+ * @event:  Configure event (contains new size). (transfer none)
+ * @d:      The desk. (transfer none)
+ *
+ * Sizes the desk to the widget's current allocation (desk_set_geometry).
+ *
+ * Returns FALSE.
+ */
+static gint
+desk_configure_event (GtkWidget *widget, GdkEventConfigure *event, desk *d)
+{
+    GtkAllocation alloc;
+
+    gtk_widget_get_allocation(widget, &alloc);
+    desk_set_geometry(d, 0, 0, alloc.width, alloc.height);
     return FALSE;
 }
 
+/**
+ * desk_style_updated - GtkWidget "style-updated" handler; caches colours.
+ * @widget: The GtkDrawingArea. (transfer none)
+ * @d:      The desk. (transfer none)
+ *
+ * Resolves the SELECTED and NORMAL foreground and background colours of the
+ * drawing area's style context into the desk, then marks the desk dirty.
+ * Also called once from desk_new().
+ *
+ * GTK_STYLE_PROPERTY_BACKGROUND_COLOR is returned as a newly allocated
+ * GdkRGBA*, which is copied and freed.
+ */
+static void
+desk_style_updated(GtkWidget *widget, desk *d)
+{
+    GtkStyleContext *ctx;
+    GdkRGBA *color;
+
+    ctx = gtk_widget_get_style_context(widget);
+    gtk_style_context_save(ctx);
+    gtk_style_context_set_state(ctx, GTK_STATE_FLAG_SELECTED);
+    gtk_style_context_get(ctx, GTK_STATE_FLAG_SELECTED, GTK_STYLE_PROPERTY_BACKGROUND_COLOR, &color, NULL);
+    d->bg_sel = *color;
+    gdk_rgba_free(color);
+    gtk_style_context_get_color(ctx, GTK_STATE_FLAG_SELECTED, &d->fg_sel);
+    gtk_style_context_set_state(ctx, GTK_STATE_FLAG_NORMAL);
+    gtk_style_context_get(ctx, GTK_STATE_FLAG_NORMAL, GTK_STYLE_PROPERTY_BACKGROUND_COLOR, &color, NULL);
+    d->bg_norm = *color;
+    gdk_rgba_free(color);
+    gtk_style_context_get_color(ctx, GTK_STATE_FLAG_NORMAL, &d->fg_norm);
+    gtk_style_context_restore(ctx);
+    desk_set_dirty(d);
+    return;
+}
+
 /**
  * desk_button_press_event - GDK "button_press_event" handler for a desk thumbnail.
  * @widget: The GtkDrawingArea. (transfer none)
@@ -731,8 +1204,10 @@ desk_button_press_event(GtkWidget * widget, GdkEventButton * event, desk *d)
  * @i:  Desktop index (must be < pg->desknum).
  *
  * Allocates pg->desks[i], creates a GtkDrawingArea sized daw x dah,
- * packs it into pg->box, and connects "draw", "configure_event", and
- * "button_press_event" signals.
+ * packs it into pg->box, and connects "draw", "configure_event",
+ * "style-updated" and "button_press_event" signals.  With SingleSurface
+ * only the colours are resolved, from pg->da; pager_grid_layout() places
+ * the desk.
  */
 static void
 desk_new(pager_priv *pg, int i)
@@ -747,6 +1222,10 @@ desk_new(pager_priv *pg, int i)
     d->first = 1;   /* set but never read (BUG-022) */
     d->no = i;
 
+    if (pg->single) {
+        desk_style_updated(pg->da, d);
+        return;
+    }
     d->da = gtk_drawing_area_new();
     gtk_widget_set_size_request(d->da, pg->daw, pg->dah);
     gtk_box_pack_start(GTK_BOX(pg->box), d->da, TRUE, TRUE, 0);
@@ -757,8 +1236,11 @@ desk_new(pager_priv *pg, int i)
           (GCallback) desk_draw_event, (gpointer)d);
     g_signal_connect (G_OBJECT (d->da), "configure_event",
           (GCallback) desk_configure_event, (gpointer)d);
+    g_signal_connect (G_OBJECT (d->da), "style-updated",
+          (GCallback) desk_style_updated, (gpointer)d);
     g_signal_connect (G_OBJECT (d->da), "button_press_event",
          (GCallback) desk_button_press_event, (gpointer)d);
+    desk_style_updated(d->da, d);
     gtk_widget_show_all(d->da);
     return;
 }
@@ -768,8 +1250,8 @@ desk_new(pager_priv *pg, int i)
  * @pg: Pager instance. (transfer none)
  * @i:  Desktop index to free.
  *
- * Destroys d->pix and d->gpix (cairo surfaces), calls gtk_widget_destroy on
- * d->da, then g_free's the desk struct.  Clears pg->desks[i] indirectly
+ * Destroys d->pix and d->damage, calls gtk_widget_destroy on
+ * d->da (if any), then g_free's the desk struct.  Clears pg->desks[i] indirectly
  * (caller is responsible for not accessing it after this).
  */
 static void
@@ -782,346 +1264,184 @@ desk_free(pager_priv *pg, int i)
           i, d->no, d->da, d->pix);
     if (d->pix)
         cairo_surface_destroy(d->pix);
-    if (d->gpix)
-        cairo_surface_destroy(d->gpix);
-    gtk_widget_destroy(d->da);
+    if (d->damage)
+        cairo_region_destroy(d->damage);
+    if (d->da)
+        gtk_widget_destroy(d->da);
     g_free(d);
     return;
 }
 
 
 /*****************************************************************
- * Stuff to grab icons from windows - ripped from taskbar.c      *
+ * Single Surface                                                *
  *****************************************************************/
 
 /**
- * _wnck_gdk_pixbuf_get_from_pixmap - convert an X11 Pixmap to a GdkPixbuf.
- * @dest:     Ignored (pass NULL). Kept for API compatibility.
- * @xpixmap:  X11 Pixmap ID to read. (transfer none)
- * @src_x:    Source X offset within the pixmap.
- * @src_y:    Source Y offset within the pixmap.
- * @dest_x:   Ignored.
- * @dest_y:   Ignored.
- * @width:    Width of the region to extract (pixels).
- * @height:   Height of the region to extract (pixels).
- *
- * Uses cairo-xlib to copy the pixmap into an RGB24 image surface, then
- * calls gdk_pixbuf_get_from_surface() to produce a GdkPixbuf.
- *
- * Handles 1-bit bitmaps (icon masks): renders white-on-black so that
- * apply_mask() can use pixel value 0 as transparent, 255 as opaque.
- *
- * Returns: (transfer full) new GdkPixbuf, or NULL on X11 / cairo failure.
+ * pager_grid_size - size the grid for the current desktop count.
+ * @pg: Pager instance with SingleSurface. (transfer none)
+ *
+ * A horizontal panel gets pg->rows rows and as many columns as needed; a
+ * vertical one pg->rows columns and as many rows as needed.  Requests
+ * daw x dah per desk with DESK_GAP between them.
  */
-static GdkPixbuf*
-_wnck_gdk_pixbuf_get_from_pixmap (GdkPixbuf   *dest,
-                                  Pixmap       xpixmap,
-                                  int          src_x,
-                                  int          src_y,
-                                  int          dest_x,
-                                  int          dest_y,
-                                  int          width,
-                                  int          height)
+static void
+pager_grid_size(pager_priv *pg)
 {
-    Display *dpy = GDK_DPY;
-    cairo_surface_t *xlib_surf, *image;
-    GdkPixbuf *ret;
-    cairo_t *cr;
-    Window root_ret;
-    int rx, ry;
-    unsigned int rw, rh, rborder, depth;
+    guint n = MAX(pg->desknum, 1);
 
-    (void)dest; (void)dest_x; (void)dest_y;
-
-    if (!XGetGeometry(dpy, xpixmap, &root_ret, &rx, &ry, &rw, &rh, &rborder, &depth))
-        return NULL;
-
-    image = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height);
-    if (cairo_surface_status(image) != CAIRO_STATUS_SUCCESS) {
-        cairo_surface_destroy(image);
-        return NULL;
-    }
-
-    if (depth == 1) {
-        /* 1-bit X bitmap (icon mask).  Render white-on-black so that
-         * apply_mask() can read black=transparent, white=opaque. */
-        xlib_surf = cairo_xlib_surface_create_for_bitmap(
-            dpy, xpixmap, DefaultScreenOfDisplay(dpy), (int)rw, (int)rh);
-        if (cairo_surface_status(xlib_surf) != CAIRO_STATUS_SUCCESS) {
-            cairo_surface_destroy(xlib_surf);
-            cairo_surface_destroy(image);
-            return NULL;
-        }
-        cr = cairo_create(image);
-        cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
-        cairo_paint(cr);
-        cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
-        cairo_mask_surface(cr, xlib_surf, -src_x, -src_y);
-        cairo_destroy(cr);
+    if (pg->plugin.panel->orientation == GTK_ORIENTATION_HORIZONTAL) {
+        pg->lines = pg->rows;
+        pg->cols = (n + pg->lines - 1) / pg->lines;
     } else {
-        /* Full-depth colour pixmap (icon image). */
-        xlib_surf = cairo_xlib_surface_create(
-            dpy, xpixmap,
-            DefaultVisual(dpy, DefaultScreen(dpy)),
-            (int)rw, (int)rh);
-        if (cairo_surface_status(xlib_surf) != CAIRO_STATUS_SUCCESS) {
-            cairo_surface_destroy(xlib_surf);
-            cairo_surface_destroy(image);
-            return NULL;
-        }
-        cr = cairo_create(image);
-        cairo_set_source_surface(cr, xlib_surf, -src_x, -src_y);
-        cairo_paint(cr);
-        cairo_destroy(cr);
+        pg->cols = pg->rows;
+        pg->lines = (n + pg->cols - 1) / pg->cols;
     }
-
-    cairo_surface_destroy(xlib_surf);
-    ret = gdk_pixbuf_get_from_surface(image, 0, 0, width, height);
-    cairo_surface_destroy(image);
-    return ret;
+    gtk_widget_set_size_request(pg->da,
+        pg->cols * pg->daw + (pg->cols - 1) * DESK_GAP,
+        pg->lines * pg->dah + (pg->lines - 1) * DESK_GAP);
+    DBG("%ux%u desks\n", pg->cols, pg->lines);
+    return;
 }
 
 /**
- * apply_mask - composite a 1-bit mask into a GdkPixbuf's alpha channel.
- * @pixbuf: Source RGB pixbuf. (transfer none)
- * @mask:   Mask pixbuf (from _wnck_gdk_pixbuf_get_from_pixmap on a 1-bit bitmap).
- *          Pixels with value 0 become transparent; non-zero become opaque.
- *          (transfer none)
- *
- * Returns: (transfer full) new RGBA GdkPixbuf with alpha channel set from @mask.
- *          Caller must g_object_unref the result and the input pixbufs separately.
+ * pager_grid_layout - place every desk in its cell of pg->pix.
+ * @pg: Pager instance with SingleSurface. (transfer none)
+ *
+ * Cells split the allocation evenly; leftover pixels stay at the right and
+ * bottom edges.  Desk i is in row i / cols, column i % cols.
  */
-static GdkPixbuf*
-apply_mask (GdkPixbuf *pixbuf,
-            GdkPixbuf *mask)
+static void
+pager_grid_layout(pager_priv *pg)
 {
-  int w, h;
-  int i, j;
-  GdkPixbuf *with_alpha;
-  guchar *src;
-  guchar *dest;
-  int src_stride;
-  int dest_stride;
-
-  w = MIN (gdk_pixbuf_get_width (mask), gdk_pixbuf_get_width (pixbuf));
-  h = MIN (gdk_pixbuf_get_height (mask), gdk_pixbuf_get_height (pixbuf));
-
-  with_alpha = gdk_pixbuf_add_alpha (pixbuf, FALSE, 0, 0, 0);
-
-  dest = gdk_pixbuf_get_pixels (with_alpha);
-  src = gdk_pixbuf_get_pixels (mask);
-
-  dest_stride = gdk_pixbuf_get_rowstride (with_alpha);
-  src_stride = gdk_pixbuf_get_rowstride (mask);
-
-  i = 0;
-  while (i < h)
-    {
-      j = 0;
-      while (j < w)
-        {
-          guchar *s = src + i * src_stride + j * 3;
-          guchar *d = dest + i * dest_stride + j * 4;
-
-          /* s[0] == s[1] == s[2], they are 255 if the bit was set, 0
-           * otherwise
-           */
-          if (s[0] == 0)
-            d[3] = 0;   /* transparent */
-          else
-            d[3] = 255; /* opaque */
-
-          ++j;
-        }
+    int w, h, cw, ch, i;
 
-      ++i;
-    }
-
-  return with_alpha;
+    if (!pg->pix)
+        return;
+    w = cairo_image_surface_get_width(pg->pix);
+    h = cairo_image_surface_get_height(pg->pix);
+    cw = MAX(1, (w - ((int) pg->cols - 1) * DESK_GAP) / (int) pg->cols);
+    ch = MAX(1, (h - ((int) pg->lines - 1) * DESK_GAP) / (int) pg->lines);
+    for (i = 0; i < pg->desknum; i++)
+        desk_set_geometry(pg->desks[i],
+            (i % pg->cols) * (cw + DESK_GAP),
+            (i / pg->cols) * (ch + DESK_GAP), cw, ch);
+    gtk_widget_queue_draw(pg->da);
+    return;
 }
 
 /**
- * free_pixels - GdkPixbuf destroy notify to free a g_new'd pixel buffer.
- * @pixels: Pixel data to free. (transfer full)
- * @data:   Unused user data.
+ * pager_configure_event - "configure_event" handler of pg->da.
+ * @widget: pg->da. (transfer none)
+ * @event:  Configure event. (transfer none)
+ * @pg:     Pager instance. (transfer none)
+ *
+ * Recreates pg->pix at the new size and lays the desks out again.  The
+ * desks' sub-surfaces are dropped first; they keep their parent alive.
+ *
+ * Returns FALSE.
  */
-static void
-free_pixels (guchar *pixels, gpointer data)
+static gint
+pager_configure_event(GtkWidget *widget, GdkEventConfigure *event,
+    pager_priv *pg)
 {
-    g_free (pixels);
-    return;
+    GtkAllocation alloc;
+
+    gtk_widget_get_allocation(widget, &alloc);
+    if (pg->pix && cairo_image_surface_get_width(pg->pix) == alloc.width
+          && cairo_image_surface_get_height(pg->pix) == alloc.height)
+        return FALSE;
+    if (pg->pix)
+        cairo_surface_destroy(pg->pix);
+    pg->pix = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+        alloc.width, alloc.height);
+    pager_grid_layout(pg);
+    return FALSE;
 }
 
 /**
- * argbdata_to_pixdata - convert ARGB gulong array to packed RGBA bytes.
- * @argb_data: Array of @len ARGB values (as returned by XGetWindowProperty
- *             with XA_CARDINAL type). (transfer none)
- * @len:       Number of ARGB entries.
+ * pager_draw_event - "draw" handler of pg->da.
+ * @widget: pg->da. (transfer none)
+ * @cr:     Cairo context from GDK. (transfer none)
+ * @pg:     Pager instance. (transfer none)
  *
- * Converts each entry: `rgba = (argb << 8) | (argb >> 24)`, then unpacks
- * RGBA bytes in order: R, G, B, A.
+ * Refreshes every desk that is dirty or damaged (desk_refresh), paints the
+ * theme background for the gaps and blits the desk cells of pg->pix.
  *
- * Returns: (transfer full) newly g_new'd byte array of length len*4;
- *          must be freed by the GdkPixbuf destroy-notify (free_pixels).
+ * Returns FALSE.
  */
-static guchar *
-argbdata_to_pixdata (gulong *argb_data, int len)
+static gint
+pager_draw_event(GtkWidget *widget, cairo_t *cr, pager_priv *pg)
 {
-    guchar *p, *ret;
     int i;
 
-    ret = p = g_new (guchar, len * 4);
-    if (!ret)
-        return NULL;
-    /* One could speed this up a lot. */
-    i = 0;
-    while (i < len) {
-        guint32 argb;
-        guint32 rgba;
-
-        argb = argb_data[i];
-        rgba = (argb << 8) | (argb >> 24);
-
-        *p = rgba >> 24;
-        ++p;
-        *p = (rgba >> 16) & 0xff;
-        ++p;
-        *p = (rgba >> 8) & 0xff;
-        ++p;
-        *p = rgba & 0xff;
-        ++p;
-
-        ++i;
+    if (!pg->pix)
+        return FALSE;
+    gtk_render_background(gtk_widget_get_style_context(widget), cr, 0, 0,
+        gtk_widget_get_allocated_width(widget),
+        gtk_widget_get_allocated_height(widget));
+    for (i = 0; i < pg->desknum; i++) {
+        desk *d = pg->desks[i];
+
+        if (!d->pix)
+            continue;
+        desk_refresh(d);
+        cairo_rectangle(cr, d->x, d->y, d->w, d->h);
     }
-    return ret;
+    cairo_set_source_surface(cr, pg->pix, 0, 0);
+    cairo_fill(cr);
+    return FALSE;
 }
 
 /**
- * get_netwm_icon - load a task icon from _NET_WM_ICON (ARGB format).
- * @tkwin: X11 window to query. (transfer none)
- * @iw:    Desired icon width.
- * @ih:    Desired icon height.
+ * pager_button_press_event - "button_press_event" handler of pg->da.
+ * @widget: pg->da. (transfer none)
+ * @event:  Button press event. (transfer none)
+ * @pg:     Pager instance. (transfer none)
  *
- * Reads XA_CARDINAL _NET_WM_ICON property, validates dimensions are in
- * [16, 256] range, converts ARGB to RGBA via argbdata_to_pixdata, creates a
- * GdkPixbuf, and scales to iw x ih if needed.
+ * Finds the cell under the pointer by dividing by the cell pitch, then
+ * behaves as desk_button_press_event() for that desk.  Clicks on a gap or
+ * an empty cell only pass Ctrl+RMB through.
  *
- * Returns: (transfer full) new GdkPixbuf scaled to iw x ih, or NULL on failure.
- *          Data array freed by XFree regardless of outcome.
+ * Returns TRUE if the event was consumed.
  */
-static GdkPixbuf *
-get_netwm_icon(Window tkwin, int iw, int ih)
+static gint
+pager_button_press_event(GtkWidget *widget, GdkEventButton *event,
+    pager_priv *pg)
 {
-    gulong *data;
-    GdkPixbuf *ret = NULL;
-    int n;
-    guchar *p;
-    GdkPixbuf *src;
-    int w, h;
-
-    data = get_xaproperty(tkwin, a_NET_WM_ICON, XA_CARDINAL, &n);
-    if (!data)
-        return NULL;
-
-    /* check that data indeed represents icon in w + h + ARGB[] format
-     * with 16x16 dimension at least */
-    if (n < (16 * 16 + 1 + 1)) {
-        ERR("win %lx: icon is too small or broken (size=%d)\n", tkwin, n);
-        goto out;
-    }
-    w = data[0];
-    h = data[1];
-    /* check that sizes are in 64-256 range */
-    if (w < 16 || w > 256 || h < 16 || h > 256) {
-        ERR("win %lx: icon size (%d, %d) is not in 64-256 range\n",
-            tkwin, w, h);
-        goto out;
-    }
-
-    DBG("orig  %dx%d dest %dx%d\n", w, h, iw, ih);
-    p = argbdata_to_pixdata(data + 2, w * h);
-    if (!p)
-        goto out;
-    src = gdk_pixbuf_new_from_data (p, GDK_COLORSPACE_RGB, TRUE,
-        8, w, h, w * 4, free_pixels, NULL);
-    if (src == NULL)
-        goto out;
-    ret = src;
-    if (w != iw || h != ih) {
-        ret = gdk_pixbuf_scale_simple(src, iw, ih, GDK_INTERP_HYPER);
-        g_object_unref(src);
-    }
+    desk *d;
+    int x, y, col, row, i;
 
-out:
-    XFree(data);
-    return ret;
+    if (!pg->desknum || !pg->desks[0]->pix)
+        return FALSE;
+    x = event->x;
+    y = event->y;
+    col = x / (pg->desks[0]->w + DESK_GAP);
+    row = y / (pg->desks[0]->h + DESK_GAP);
+    i = row * pg->cols + col;
+    if (x < 0 || y < 0 || col >= (int) pg->cols || i >= (int) pg->desknum)
+        return FALSE;
+    d = pg->desks[i];
+    if (x - d->x >= d->w || y - d->y >= d->h)
+        return FALSE;
+    return desk_button_press_event(widget, event, d);
 }
 
 /**
- * get_wm_icon - load a task icon from WM_HINTS (X11 Pixmap path).
- * @tkwin: X11 window to query. (transfer none)
- * @iw:    Desired icon width.
- * @ih:    Desired icon height.
- *
- * Reads XGetWMHints; if IconPixmapHint is set, converts the X11 Pixmap to
- * a GdkPixbuf via _wnck_gdk_pixbuf_get_from_pixmap + cairo-xlib.  If
- * IconMaskHint is also set, composites the mask via apply_mask().
- * Scales the result to iw x ih using GDK_INTERP_TILES.
- *
- * Returns: (transfer full) new GdkPixbuf scaled to iw x ih, or NULL on failure.
- *          Intermediate pixbufs are g_object_unref'd before returning.
+ * pager_style_updated - "style-updated" handler of pg->da.
+ * @widget: pg->da. (transfer none)
+ * @pg:     Pager instance. (transfer none)
+ *
+ * Resolves the colours of every desk (desk_style_updated).
  */
-static GdkPixbuf*
-get_wm_icon(Window tkwin, int iw, int ih)
+static void
+pager_style_updated(GtkWidget *widget, pager_priv *pg)
 {
-    XWMHints *hints;
-    Pixmap xpixmap = None, xmask = None;
-    Window win;
-    unsigned int w, h;
-    int sd;
-    GdkPixbuf *ret, *masked, *pixmap, *mask = NULL;
-
-    hints = XGetWMHints(GDK_DPY, tkwin);
-    DBG("\nwm_hints %s\n", hints ? "ok" : "failed");
-    if (!hints)
-        return NULL;
-
-    if ((hints->flags & IconPixmapHint))
-        xpixmap = hints->icon_pixmap;
-    if ((hints->flags & IconMaskHint))
-        xmask = hints->icon_mask;
-    DBG("flag=%ld xpixmap=%lx flag=%ld xmask=%lx\n", (hints->flags & IconPixmapHint), xpixmap,
-         (hints->flags & IconMaskHint),  xmask);
-    XFree(hints);
-    if (xpixmap == None)
-        return NULL;
-
-    if (!XGetGeometry (GDK_DPY, xpixmap, &win, &sd, &sd, &w, &h,
-              (guint *)&sd, (guint *)&sd)) {
-        DBG("XGetGeometry failed for %x pixmap\n", (unsigned int)xpixmap);
-        return NULL;
-    }
-    DBG("tkwin=%x icon pixmap w=%d h=%d\n", tkwin, w, h);
-    pixmap = _wnck_gdk_pixbuf_get_from_pixmap (NULL, xpixmap, 0, 0, 0, 0, w, h);
-    if (!pixmap)
-        return NULL;
-    if (xmask != None && XGetGeometry (GDK_DPY, xmask,
-              &win, &sd, &sd, &w, &h, (guint *)&sd, (guint *)&sd)) {
-        mask = _wnck_gdk_pixbuf_get_from_pixmap (NULL, xmask, 0, 0, 0, 0, w, h);
-
-        if (mask) {
-            masked = apply_mask (pixmap, mask);
-            g_object_unref (G_OBJECT (pixmap));
-            g_object_unref (G_OBJECT (mask));
-            pixmap = masked;
-        }
-    }
-    if (!pixmap)
-        return NULL;
-    ret = gdk_pixbuf_scale_simple (pixmap, iw, ih, GDK_INTERP_TILES);
-    g_object_unref(pixmap);
+    int i;
 
-    return ret;
+    for (i = 0; i < pg->desknum; i++)
+        desk_style_updated(widget, pg->desks[i]);
+    return;
 }
 
 
@@ -1135,7 +1455,7 @@ get_wm_icon(Window tkwin, int iw, int ih)
  * @p:  Pager instance. (transfer none)
  *
  * Reads _NET_ACTIVE_WINDOW from the root window.  Updates p->focusedtask
- * and marks the previously- and newly-focused desks dirty so they repaint
+ * and damages the previously- and newly-focused tasks so they repaint
  * with the correct highlight colour.
  *
  * The data pointer from get_xaproperty is XFree'd after hash lookup.
@@ -1152,21 +1472,49 @@ do_net_active_window(FbEv *ev, pager_priv *p)
         t = g_hash_table_lookup(p->htable, fwin);
         if (t != p->focusedtask) {
             if (p->focusedtask)
-                desk_set_dirty_by_win(p, p->focusedtask);
+                desk_damage_by_win(p, p->focusedtask);
             p->focusedtask = t;
             if (t)
-                desk_set_dirty_by_win(p, t);
+                desk_damage_by_win(p, t);
         }
         XFree(fwin);
     } else {
         if (p->focusedtask) {
-            desk_set_dirty_by_win(p, p->focusedtask);
+            desk_damage_by_win(p, p->focusedtask);
             p->focusedtask = NULL;
         }
     }
     return;
 }
 
+/**
+ * pager_wall_check - WALL_SWITCH_US after a desktop switch.
+ * @pg: Pager instance. (transfer none)
+ *
+ * If no new root pixmap came since the switch, the wallpaper is global:
+ * leaves per-desktop mode (or stops counting hits) and unbinds every desk.
+ *
+ * Returns: G_SOURCE_REMOVE.
+ */
+static gboolean
+pager_wall_check(pager_priv *pg)
+{
+    int i;
+
+    pg->wall_timer = 0;
+    if (pg->wall_time >= pg->switch_time || !pg->wall_hits)
+        return G_SOURCE_REMOVE;
+    DBG("global wallpaper\n");
+    pg->wall_hits = 0;
+    pg->wall_per_desk = FALSE;
+    for (i = 0; i < pg->desknum; i++) {
+        pg->desks[i]->wall = None;
+        desk_set_dirty(pg->desks[i]);
+    }
+    pager_wall_prune(pg);
+    return G_SOURCE_REMOVE;
+}
+
 /**
  * do_net_current_desktop - FbEv "current_desktop" signal handler.
  * @ev: FbEv instance (may be NULL when called from pager_rebuild_all). (transfer none)
@@ -1179,13 +1527,30 @@ do_net_active_window(FbEv *ev, pager_priv *p)
 static void
 do_net_current_desktop(FbEv *ev, pager_priv *pg)
 {
+    guint prev = pg->curdesk;
+
     desk_set_dirty(pg->desks[pg->curdesk]);
-    gtk_widget_set_state_flags(pg->desks[pg->curdesk]->da, GTK_STATE_FLAG_NORMAL, TRUE);
+    if (pg->desks[pg->curdesk]->da)
+        gtk_widget_set_state_flags(pg->desks[pg->curdesk]->da, GTK_STATE_FLAG_NORMAL, TRUE);
     pg->curdesk =  get_net_current_desktop ();
     if (pg->curdesk >= pg->desknum)
         pg->curdesk = 0;
+    if (pg->curdesk != prev) {
+        /* for pager_bg_changed(): a wallpaper change follows if per-desktop */
+        pg->prevdesk = prev;
+        pg->switch_time = g_get_monotonic_time();
+        if (pg->walls) {
+            if (pg->wall_timer)
+                g_source_remove(pg->wall_timer);
+            pg->wall_timer = g_timeout_add(WALL_SWITCH_US / 1000,
+                (GSourceFunc) pager_wall_check, pg);
+        }
+    }
     desk_set_dirty(pg->desks[pg->curdesk]);
-    gtk_widget_set_state_flags(pg->desks[pg->curdesk]->da, GTK_STATE_FLAG_SELECTED, TRUE);
+    if (pg->desks[pg->curdesk]->da)
+        gtk_widget_set_state_flags(pg->desks[pg->curdesk]->da, GTK_STATE_FLAG_SELECTED, TRUE);
+    /* windows damaged while their desktop was hidden can be captured now */
+    pager_thumb_schedule(pg);
     return;
 }
 
@@ -1227,7 +1592,7 @@ do_net_client_list_stacking(FbEv *ev, pager_priv *p)
             t->refcount++;
             if (t->stacking != i) {
                 t->stacking = i;
-                desk_set_dirty_by_win(p, t);
+                desk_damage_by_win(p, t);
             }
         } else {
             t = g_new0(task, 1);
@@ -1245,15 +1610,13 @@ do_net_client_list_stacking(FbEv *ev, pager_priv *p)
             get_net_wm_state(t->win, &t->nws);
             get_net_wm_window_type(t->win, &t->nwwt);
             task_get_sizepos(t);
-            /* Icon loading: try _NET_WM_ICON first, fall back to WM_HINTS pixmap. */
-            t->pixbuf = get_netwm_icon(t->win, 16, 16);
-            t->using_netwm_icon = (t->pixbuf != NULL);
-            if (!t->using_netwm_icon) {
-                t->pixbuf = get_wm_icon(t->win, 16, 16);
-            }
+            if (t->gdkwin)
+                task_set_frame(p, t);
+            /* _NET_WM_ICON, else WM_HINTS pixmap; shared with the taskbar */
+            t->pixbuf = get_window_icon(t->win, 16, 16, NULL);
             g_hash_table_insert(p->htable, &t->win, t);
             DBG("add %lx\n", t->win);
-            desk_set_dirty_by_win(p, t);
+            desk_damage_by_win(p, t);
         }
     }
     /* pass throu hash table and delete stale windows */
@@ -1262,30 +1625,209 @@ do_net_client_list_stacking(FbEv *ev, pager_priv *p)
 }
 
 
+/*****************************************************************
+ * Live Thumbnails                                               *
+ *****************************************************************/
+
+/**
+ * task_thumb_drop - GHFunc: forget a task's thumbnail.
+ * @win: Hash table key (unused). (transfer none)
+ * @t:   Task. (transfer none)
+ * @pg:  Pager instance. (transfer none)
+ */
+static void
+task_thumb_drop(Window *win, task *t, pager_priv *pg)
+{
+    if (!t->thumb)
+        return;
+    cairo_surface_destroy(t->thumb);
+    t->thumb = NULL;
+    t->thumb_stale = 1;
+    desk_damage_by_win(pg, t);
+    return;
+}
+
+/**
+ * task_thumb_visible - test whether a task's window can be captured now.
+ * @pg: Pager instance. (transfer none)
+ * @t:  Task. (transfer none)
+ *
+ * Windows on other desktops are unmapped by the window manager and keep
+ * their last thumbnail until their desktop is shown.
+ *
+ * Returns: TRUE if the window is shown in the pager and on screen.
+ */
+static gboolean
+task_thumb_visible(pager_priv *pg, task *t)
+{
+    return t->frame != None && TASK_VISIBLE(t)
+        && (t->desktop == pg->curdesk || t->desktop >= pg->desknum);
+}
+
+/**
+ * pager_thumb_tick - timeout callback; captures one stale thumbnail.
+ * @pg: Pager instance. (transfer none)
+ *
+ * Runs every 1000 / thumb_rate ms while thumbnails are stale, so captures
+ * never exceed ThumbnailRate per second however often windows repaint.
+ * Picks the visible stale task captured longest ago, so one busy window
+ * (a video) cannot starve the others.  The thumbnail is captured at the
+ * task's rectangle size on the desk that shows it.
+ *
+ * If the compositing manager went away, drops all thumbnails so the pager
+ * falls back to plain rectangles.
+ *
+ * Returns: TRUE while more visible tasks are stale; FALSE stops the timer.
+ */
+static gboolean
+pager_thumb_tick(pager_priv *pg)
+{
+    GHashTableIter iter;
+    gpointer key, value;
+    task *t, *pick = NULL;
+    cairo_surface_t *thumb;
+    GdkRectangle r;
+    desk *d;
+    int n = 0;
+
+    g_hash_table_iter_init(&iter, pg->htable);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        t = value;
+        if (!t->thumb_stale || !task_thumb_visible(pg, t))
+            continue;
+        n++;
+        if (!pick || t->thumb_time < pick->thumb_time)
+            pick = t;
+    }
+    if (!pick || !winthumb_available()) {
+        if (pick)
+            g_hash_table_foreach(pg->htable, (GHFunc) task_thumb_drop, pg);
+        pg->thumb_timer = 0;
+        return FALSE;
+    }
+    d = pg->desks[pick->desktop < pg->desknum ? pick->desktop : pg->curdesk];
+    pick->thumb_stale = 0;
+    pick->thumb_time = g_get_monotonic_time();
+    if (task_get_rect(pick, d, &r)
+            && (thumb = winthumb_capture(pick->frame, r.width - 1, r.height - 1))) {
+        if (pick->thumb)
+            cairo_surface_destroy(pick->thumb);
+        pick->thumb = thumb;
+        desk_damage_by_win(pg, pick);
+    }
+    DBG("win=0x%lx captured, %d stale\n", pick->win, n - 1);
+    if (n > 1)
+        return TRUE;
+    pg->thumb_timer = 0;
+    return FALSE;
+}
+
+/**
+ * pager_thumb_schedule - start the capture timer if thumbnails are stale.
+ * @pg: Pager instance. (transfer none)
+ */
+static void
+pager_thumb_schedule(pager_priv *pg)
+{
+    if (pg->thumbnails && !pg->thumb_timer)
+        pg->thumb_timer = g_timeout_add(1000 / pg->thumb_rate,
+            (GSourceFunc) pager_thumb_tick, pg);
+    return;
+}
+
+/**
+ * pager_damagenotify - handle DamageNotify for a task's frame.
+ * @pg:  Pager instance. (transfer none)
+ * @win: Damaged window (frame, or unparented client). (transfer none)
+ */
+static void
+pager_damagenotify(pager_priv *pg, Window win)
+{
+    task *t;
+
+    if (!(t = g_hash_table_lookup(pg->ftable, &win))
+            && !(t = g_hash_table_lookup(pg->htable, &win)))
+        return;
+    t->thumb_stale = 1;
+    if (task_thumb_visible(pg, t))
+        pager_thumb_schedule(pg);
+    return;
+}
+
+
 /*****************************************************************
  * Pager Functions                                               *
  *****************************************************************/
 
 /**
- * pager_configurenotify - handle ConfigureNotify from a managed window.
+ * pager_configurenotify - handle ConfigureNotify from a managed window or its frame.
  * @p:  Pager instance. (transfer none)
  * @ev: XConfigureEvent from the per-window GDK filter. (transfer none)
  *
- * Looks up the window in the hash table.  If found, refreshes the task's
- * position and size via task_get_sizepos(), then marks the desk dirty.
+ * Takes the new geometry from the event instead of asking the server:
+ *  - frame moved: shift the task by the same amount;
+ *  - synthetic event (ICCCM 4.1.5, sent by the WM on moves): root coordinates;
+ *  - real event: size, plus position relative to the parent, which is the
+ *    root window or the frame (nested WM wrappers report size only).
+ * Falls back to task_get_sizepos() if the frame is unknown.  Repaints are
+ * deferred to pager_flush_moves() via task_move_begin().
  */
 static void
 pager_configurenotify(pager_priv *p, XEvent *ev)
 {
-    Window win = ev->xconfigure.window;
+    XConfigureEvent *ce = &ev->xconfigure;
+    Window win = ce->window;
     task *t;
 
+    if ((t = g_hash_table_lookup(p->htable, &win))) {
+        DBG("win=0x%lx send_event=%d\n", win, ce->send_event);
+        task_move_begin(p, t);
+        if (t->frame == None) {
+            task_get_sizepos(t);
+            return;
+        }
+        t->w = ce->width;
+        t->h = ce->height;
+        if (ce->send_event || t->frame == t->win) {
+            t->x = ce->x;
+            t->y = ce->y;
+        } else if (t->parent == t->frame) {
+            t->x = t->fx + t->fbw + ce->x;
+            t->y = t->fy + t->fbw + ce->y;
+        }
+    } else if ((t = g_hash_table_lookup(p->ftable, &win))) {
+        DBG("frame=0x%lx win=0x%lx\n", win, t->win);
+        task_move_begin(p, t);
+        t->x += ce->x - t->fx;
+        t->y += ce->y - t->fy;
+        t->fx = ce->x;
+        t->fy = ce->y;
+        t->fbw = ce->border_width;
+    }
+    return;
+}
+
+/**
+ * pager_reparentnotify - handle ReparentNotify from a managed window.
+ * @p:  Pager instance. (transfer none)
+ * @ev: XReparentEvent from the per-window GDK filter. (transfer none)
+ *
+ * The window got a new frame (WM restart or unmanage): re-read its
+ * geometry and frame with round trips.
+ */
+static void
+pager_reparentnotify(pager_priv *p, XEvent *ev)
+{
+    Window win = ev->xreparent.window;
+    task *t;
 
     if (!(t = g_hash_table_lookup(p->htable, &win)))
         return;
-    DBG("win=0x%lx\n", win);
+    DBG("win=0x%lx parent=0x%lx\n", win, ev->xreparent.parent);
+    task_move_begin(p, t);
+    task_unset_frame(p, t);
     task_get_sizepos(t);
-    desk_set_dirty_by_win(p, t);
+    task_set_frame(p, t);
     return;
 }
 
@@ -1295,10 +1837,12 @@ pager_configurenotify(pager_priv *p, XEvent *ev)
  * @ev: XPropertyEvent from the per-window GDK filter. (transfer none)
  *
  * Ignores root-window property changes (handled via FbEv signals).
- * Handles _NET_WM_STATE: updates t->nws.
- * Handles _NET_WM_DESKTOP: marks old desk dirty, updates t->desktop.
+ * Handles _NET_WM_STATE: damages the old rectangle, updates t->nws.
+ * Handles _NET_WM_DESKTOP: damages the old rectangle, updates t->desktop.
+ * Handles _NET_WM_ICON and WM_HINTS: re-fetches t->pixbuf from the window
+ * icon cache, which the core has already invalidated for this event.
  * Other atoms are ignored.
- * Always marks the affected desk dirty after state update.
+ * Damages the task's new rectangle after the update.
  */
 static void
 pager_propertynotify(pager_priv *p, XEvent *ev)
@@ -1314,15 +1858,25 @@ pager_propertynotify(pager_priv *p, XEvent *ev)
     DBG("window=0x%lx\n", t->win);
     if (at == a_NET_WM_STATE) {
         DBG("event=NET_WM_STATE\n");
+        desk_damage_by_win(p, t);
         get_net_wm_state(t->win, &t->nws);
     } else if (at == a_NET_WM_DESKTOP) {
         DBG("event=NET_WM_DESKTOP\n");
-        desk_set_dirty_by_win(p, t); // to clean up desks where this task was
+        desk_damage_by_win(p, t); // to clean up desks where this task was
         t->desktop = get_net_wm_desktop(t->win);
+    } else if (at == a_NET_WM_ICON || at == XA_WM_HINTS) {
+        GdkPixbuf *old = t->pixbuf;
+
+        DBG("event=NET_WM_ICON/WM_HINTS\n");
+        t->pixbuf = get_window_icon(t->win, 16, 16, NULL);
+        if (old)
+            g_object_unref(old);
+        if (t->pixbuf == old)
+            return;
     } else {
         return;
     }
-    desk_set_dirty_by_win(p, t);
+    desk_damage_by_win(p, t);
     return;
 }
 
@@ -1333,40 +1887,82 @@ pager_propertynotify(pager_priv *p, XEvent *ev)
  * @pg:    Pager instance. (transfer none)
  *
  * Installed on each task's GdkWindow via gdk_window_add_filter().
- * Dispatches PropertyNotify to pager_propertynotify() and
- * ConfigureNotify to pager_configurenotify().
+ * Also installed on each task's frame window (see task_set_frame()).
+ * Dispatches PropertyNotify to pager_propertynotify(), ConfigureNotify to
+ * pager_configurenotify(), ReparentNotify to pager_reparentnotify() and,
+ * in thumbnail mode, DamageNotify to pager_damagenotify().
  *
  * Always returns GDK_FILTER_CONTINUE (events are not consumed).
  */
 static GdkFilterReturn
 pager_event_filter( XEvent *xev, GdkEvent *event, pager_priv *pg)
 {
-    if (xev->type == PropertyNotify )
+    Window damaged;
+
+    if (pg->thumbnails && (damaged = winthumb_damaged(xev)) != None)
+        pager_damagenotify(pg, damaged);
+    else if (xev->type == PropertyNotify )
         pager_propertynotify(pg, xev);
     else if (xev->type == ConfigureNotify )
         pager_configurenotify(pg, xev);
+    else if (xev->type == ReparentNotify)
+        pager_reparentnotify(pg, xev);
     return GDK_FILTER_CONTINUE;
 }
 
 /**
- * pager_bg_changed - FbBg "changed" signal handler; redraws all desks.
- * @bg: FbBg instance (unused). (transfer none)
+ * pager_bg_changed - FbBg "changed" signal handler; renders the wallpaper.
+ * @bg: FbBg instance. (transfer none)
  * @pg: Pager instance. (transfer none)
  *
- * Called when the X root window background changes.  Redraws the wallpaper
- * cache (desk_draw_bg) and marks all desks dirty.  desk_draw_bg is a no-op
- * in the GTK3 port, so this only triggers a full repaint.
+ * Called when the root pixmap changes (or the panel moved while transparent).
+ * FbBg's own handler runs first (G_SIGNAL_RUN_FIRST), so its cache already
+ * refers to the new pixmap.
+ *
+ * The first new root pixmap within WALL_SWITCH_US of a desktop switch is a
+ * hit: the WM showing the new desktop's wallpaper.  The previous desk keeps
+ * the old pixmap and the current desk is bound to the new one; the
+ * WALL_HITS-th consecutive hit switches per-desktop mode on.  In that mode
+ * any change binds the current desk.  Otherwise a change that is not a hit
+ * means one global wallpaper: the count restarts and every desk follows
+ * the root pixmap.  The thumbnail is then rendered once and unused ones are
+ * pruned.
  */
 static void
 pager_bg_changed(FbBg *bg, pager_priv *pg)
 {
+    Pixmap old;
+    gint64 now;
     int i;
 
-    for (i = 0; i < pg->desknum; i++) {
-        desk *d = pg->desks[i];
-        desk_draw_bg(pg, d);
-        desk_set_dirty(d);
+    now = g_get_monotonic_time();
+    old = pg->wall_root;
+    pg->wall_root = fb_bg_get_xrootpmap(bg);
+    if (pg->wall_root != old) {
+        if (old != None && pg->curdesk != pg->prevdesk
+              && pg->wall_time < pg->switch_time
+              && now - pg->switch_time < WALL_SWITCH_US) {
+            if (pg->wall_hits < WALL_HITS && ++pg->wall_hits == WALL_HITS) {
+                DBG("per-desktop wallpapers\n");
+                pg->wall_per_desk = TRUE;
+            }
+            if (pg->prevdesk < pg->desknum
+                  && pg->desks[pg->prevdesk]->wall == None)
+                pg->desks[pg->prevdesk]->wall = old;
+            pg->desks[pg->curdesk]->wall = pg->wall_root;
+        } else if (pg->wall_per_desk) {
+            pg->desks[pg->curdesk]->wall = pg->wall_root;
+        } else {
+            pg->wall_hits = 0;
+            for (i = 0; i < pg->desknum; i++)
+                pg->desks[i]->wall = None;
+        }
+        pg->wall_time = now;
     }
+    pager_wall_render(pg, -1, -1, TRUE);
+    pager_wall_prune(pg);
+    for (i = 0; i < pg->desknum; i++)
+        desk_set_dirty(pg->desks[i]);
     return;
 }
 
@@ -1419,7 +2015,13 @@ pager_rebuild_all(FbEv *ev, pager_priv *pg)
         for (i = desknum; i < pg->desknum; i++)
             desk_new(pg, i);
     }
+    if (pg->single) {
+        pager_grid_size(pg);
+        pager_grid_layout(pg);
+    }
     g_hash_table_foreach_remove(pg->htable, (GHRFunc) task_remove_all, (gpointer)pg);
+    if (pg->walls)
+        pager_wall_prune(pg);
     do_net_current_desktop(NULL, pg);
     do_net_client_list_stacking(NULL, pg);
 
@@ -1438,9 +2040,11 @@ pager_rebuild_all(FbEv *ev, pager_priv *pg)
  *  2. Create inner GtkBox (horizontal or vertical, spacing=1).
  *  3. Set GtkBgbox background to BG_STYLE; add inner box to plug->pwid.
  *  4. Compute desk aspect ratio from primary monitor geometry.
- *  5. Compute dah/daw (desk area height/width) from panel dimensions.
- *  6. Optionally acquire FbBg and connect "changed" signal for wallpaper.
- *  7. Load default XPM icon into pg->gen_pixbuf.
+ *  5. Read SingleSurface/Rows; compute dah/daw (desk area height/width)
+ *     from panel dimensions and, with SingleSurface, create pg->da.
+ *  6. Optionally acquire FbBg, connect "changed" signal and create the
+ *     wallpaper thumbnail table.
+ *  7. Take the shared default XPM icon into pg->gen_pixbuf.
  *  8. Call pager_rebuild_all() to create desks and populate tasks.
  *  9. Connect FbEv signals for desktop/window changes.
  *
@@ -1459,7 +2063,8 @@ pager_constructor(plugin_instance *plug)
 #endif
 
     pg->htable = g_hash_table_new (g_int_hash, g_int_equal);
-    pg->box = plug->panel->my_box_new(TRUE, 1);
+    pg->ftable = g_hash_table_new (g_int_hash, g_int_equal);
+    pg->box = plug->panel->my_box_new(TRUE, DESK_GAP);
     gtk_container_set_border_width (GTK_CONTAINER (pg->box), 0);
     gtk_widget_show(pg->box);
 
@@ -1473,25 +2078,58 @@ pager_constructor(plugin_instance *plug)
         gdk_monitor_get_geometry(mon, &geom);
         pg->ratio = (gfloat)geom.width / (gfloat)geom.height;
     }
+    pg->single = 0;
+    XCG(plug->xc, "singlesurface", &pg->single, enum, bool_enum);
+    pg->rows = 1;
+    XCG(plug->xc, "rows", &pg->rows, int);
+    pg->rows = pg->single ? CLAMP(pg->rows, 1, 8) : 1;
+    /* with several rows, the panel's thickness is shared between them */
     if (plug->panel->orientation == GTK_ORIENTATION_HORIZONTAL) {
-        pg->dah = plug->panel->ah - 2 * BORDER;
+        pg->dah = (plug->panel->ah - 2 * BORDER - (pg->rows - 1) * DESK_GAP)
+            / pg->rows;
         pg->daw = (gfloat) pg->dah * pg->ratio;
     } else {
-        pg->daw = plug->panel->aw - 2 * BORDER;
+        pg->daw = (plug->panel->aw - 2 * BORDER - (pg->rows - 1) * DESK_GAP)
+            / pg->rows;
         pg->dah = (gfloat) pg->daw / pg->ratio;
     }
+    if (pg->single) {
+        pg->da = gtk_drawing_area_new();
+        gtk_box_pack_start(GTK_BOX(pg->box), pg->da, TRUE, TRUE, 0);
+        gtk_widget_add_events(pg->da, GDK_EXPOSURE_MASK
+              | GDK_BUTTON_PRESS_MASK
+              | GDK_BUTTON_RELEASE_MASK);
+        g_signal_connect(G_OBJECT(pg->da), "draw",
+              G_CALLBACK(pager_draw_event), pg);
+        g_signal_connect(G_OBJECT(pg->da), "configure_event",
+              G_CALLBACK(pager_configure_event), pg);
+        g_signal_connect(G_OBJECT(pg->da), "style-updated",
+              G_CALLBACK(pager_style_updated), pg);
+        g_signal_connect(G_OBJECT(pg->da), "button_press_event",
+              G_CALLBACK(pager_button_press_event), pg);
+        gtk_widget_show(pg->da);
+    }
     pg->wallpaper = 1;
     XCG(plug->xc, "showwallpaper", &pg->wallpaper, enum, bool_enum);
+    pg->thumbnails = 0;
+    XCG(plug->xc, "showthumbnails", &pg->thumbnails, enum, bool_enum);
+    pg->thumb_rate = 5;
+    XCG(plug->xc, "thumbnailrate", &pg->thumb_rate, int);
+    pg->thumb_rate = CLAMP(pg->thumb_rate, 1, 60);
     if (pg->wallpaper) {
         pg->fbbg = fb_bg_get_for_display();
         DBG("get fbbg %p\n", pg->fbbg);
         g_signal_connect(G_OBJECT(pg->fbbg), "changed",
             G_CALLBACK(pager_bg_changed), pg);
+        pg->walls = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+            NULL, (GDestroyNotify) cairo_surface_destroy);
+        pg->wall_root = fb_bg_get_xrootpmap(pg->fbbg);
     }
 
-    /* Default icon for windows without _NET_WM_ICON or WM_HINTS icon.
-     * Note: gen_pixbuf is not freed in pager_destructor (BUG-020). */
-    pg->gen_pixbuf = gdk_pixbuf_new_from_xpm_data((const char **)icon_xpm);
+    /* Default icon for windows without _NET_WM_ICON or WM_HINTS icon;
+     * decoded once and shared with the taskbar. */
+    pg->gen_pixbuf = fb_pixbuf_new_from_xpm("default.xpm",
+        (const char **)icon_xpm);
 
     pager_rebuild_all(fbev, pg);
 
@@ -1513,14 +2151,14 @@ pager_constructor(plugin_instance *plug)
  * Teardown sequence:
  *  1. Disconnect all FbEv signal handlers (current_desktop, active_window,
  *     number_of_desktops, client_list_stacking).
- *  2. desk_free() for each desk (destroys cairo surfaces and GtkDrawingAreas).
+ *  2. desk_free() for each desk (destroys cairo surfaces and GtkDrawingAreas),
+ *     then the SingleSurface backing surface.
  *  3. task_remove_all() for all hash table entries via foreach_remove.
  *  4. g_hash_table_destroy().
  *  5. gtk_widget_destroy(pg->box).
- *  6. If wallpaper: disconnect pager_bg_changed and g_object_unref(pg->fbbg).
- *  7. XFree(pg->wins) if set.
- *
- * Note: pg->gen_pixbuf is NOT freed here (BUG-020).
+ *  6. If wallpaper: disconnect pager_bg_changed, g_object_unref(pg->fbbg)
+ *     and destroy pg->walls.
+ *  7. XFree(pg->wins) if set; drop the gen_pixbuf reference.
  */
 static void
 pager_destructor(plugin_instance *p)
@@ -1538,18 +2176,30 @@ pager_destructor(plugin_instance *p)
     while (pg->desknum--) {
         desk_free(pg, pg->desknum);
     }
+    if (pg->pix)
+        cairo_surface_destroy(pg->pix);
+    if (pg->move_idle)
+        g_source_remove(pg->move_idle);
+    if (pg->thumb_timer)
+        g_source_remove(pg->thumb_timer);
+    if (pg->wall_timer)
+        g_source_remove(pg->wall_timer);
     g_hash_table_foreach_remove(pg->htable, (GHRFunc) task_remove_all,
             (gpointer)pg);
     g_hash_table_destroy(pg->htable);
+    g_hash_table_destroy(pg->ftable);
     gtk_widget_destroy(pg->box);
     if (pg->wallpaper) {
         g_signal_handlers_disconnect_by_func(G_OBJECT (pg->fbbg),
               pager_bg_changed, pg);
         DBG("put fbbg %p\n", pg->fbbg);
         g_object_unref(pg->fbbg);
+        g_hash_table_destroy(pg->walls);
     }
     if (pg->wins)
         XFree(pg->wins);
+    if (pg->gen_pixbuf)
+        g_object_unref(G_OBJECT(pg->gen_pixbuf));
     return;
 }
 
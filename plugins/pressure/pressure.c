@@ -0,0 +1,351 @@
+/**
+ * @file pressure.c
+ * @brief Pressure stall information (PSI) scrolling chart plugin for fbpanel.
+ *
+ * Displays a three-row scrolling chart of CPU, memory and I/O pressure
+ * ("some" avg10, in percent) read from /proc/pressure/{cpu,memory,io},
+ * using the chart_class base plugin in auto-ranging mode.
+ *
+ * Rather than polling quickly, the plugin registers a PSI trigger on each
+ * resource ("some <StallMs> <WindowMs>" written to a dedicated descriptor)
+ * and watches it for POLLPRI through a g_unix_fd_add() GSource, so the
+ * kernel wakes the panel only when stall time in a window crosses the
+ * threshold.  A trigger event samples all resources at once, refreshing the
+ * tooltip and marking the resource as stalled; the values it saw are folded
+ * into the column being accumulated (the highest reading wins), so stalls
+ * between two samples still show.  Chart columns are only pushed by the
+ * low-frequency timeout (PollingTime), which keeps the time axis evenly
+ * spaced.
+ *
+ * Unprivileged triggers need a window that is a multiple of 2 s on recent
+ * kernels (and are unavailable before 6.5); a rejected trigger is retried
+ * with the window rounded up, then the resource falls back to sampling only.
+ *
+ * Config keys (transfer-none xconf strings unless noted):
+ *   CpuColor    (str, default "green")  — chart colour for CPU pressure.
+ *   MemColor    (str, default "red")    — chart colour for memory pressure.
+ *   IoColor     (str, default "blue")   — chart colour for I/O pressure.
+ *   PollingTime (int, seconds, default 10) — chart sampling interval.
+ *   StallMs     (int, ms, default 150)  — trigger stall threshold.
+ *   WindowMs    (int, ms, default 1000) — trigger window.
+ *
+ * Delegates construction and destruction to chart_class (obtained via
+ * class_get("chart")/class_put("chart")).
+ */
+
+#include "../chart/chart.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <glib-unix.h>
+
+//#define DEBUGPRN
+#include "dbg.h"
+
+#define PSI_DIR "/proc/pressure/"
+#define PSI_FLOOR 10 /* percent; smallest auto-range full scale */
+
+enum { PSI_CPU, PSI_MEM, PSI_IO, PSI_NUM };
+
+static const char *psi_name[PSI_NUM] = { "cpu", "memory", "io" };
+static const char *psi_label[PSI_NUM] = { "Cpu", "Mem", "IO" };
+
+typedef struct {
+    chart_priv chart;       /**< Embedded chart_priv; must be first member. */
+    int timer;              /**< GLib timeout source ID (chart sampling). */
+    int fd[PSI_NUM];        /**< Sampling descriptors; -1 if unavailable. */
+    int tfd[PSI_NUM];       /**< Trigger descriptors; -1 if no trigger. */
+    guint tsrc[PSI_NUM];    /**< g_unix_fd_add() source IDs for triggers. */
+    gfloat some[PSI_NUM];   /**< Last "some" avg10 values (percent). */
+    gfloat full[PSI_NUM];   /**< Last "full" avg10 values (percent). */
+    gboolean stalled[PSI_NUM]; /**< Trigger fired since the last timed sample. */
+    gfloat peak[PSI_NUM];   /**< Highest "some" read by triggers since the last column. */
+    int period;             /**< Sampling interval in seconds. */
+    int stall_ms;           /**< Trigger threshold in ms. */
+    int window_ms;          /**< Trigger window in ms. */
+    gchar *colors[PSI_NUM]; /**< Colour strings per row (transfer-none). */
+} pressure_priv;
+
+static chart_class *k;
+
+
+/**
+ * psi_read - read "some" and "full" avg10 from one pressure file.
+ * @fd:   open descriptor of /proc/pressure/<res>.
+ * @some: (out) some avg10 in percent.
+ * @full: (out) full avg10 in percent (0 for cpu on older kernels).
+ *
+ * Returns: 0 on success, -1 on read or parse error.
+ */
+static int
+psi_read(int fd, gfloat *some, gfloat *full)
+{
+    char buf[256], *s;
+    ssize_t n;
+
+    *some = *full = 0;
+    n = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0)
+        return -1;
+    buf[n] = 0;
+    if (sscanf(buf, "some avg10=%f", some) != 1)
+        return -1;
+    if ((s = strstr(buf, "full avg10=")))
+        sscanf(s, "full avg10=%f", full);
+    return 0;
+}
+
+/**
+ * psi_trigger_open - open a descriptor and register a PSI trigger on it.
+ * @path:      /proc/pressure/<res>.
+ * @stall_us:  stall threshold in microseconds.
+ * @window_us: window in microseconds.
+ *
+ * Returns: the trigger descriptor, or -1 if the kernel rejected it.
+ */
+static int
+psi_trigger_open(const char *path, int stall_us, int window_us)
+{
+    char buf[64];
+    int fd, len;
+
+    fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    len = g_snprintf(buf, sizeof(buf), "some %d %d", stall_us, window_us);
+    if (write(fd, buf, len + 1) < 0) {
+        DBG("%s: trigger '%s' rejected: %s\n", path, buf, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static gboolean pressure_trigger(gint fd, GIOCondition cond, pressure_priv *c);
+
+/**
+ * pressure_open - open sampling and trigger descriptors for resource @i.
+ * @c: pressure_priv. (transfer none)
+ * @i: PSI_CPU, PSI_MEM or PSI_IO.
+ *
+ * The trigger is first tried with the configured window, then with the
+ * window rounded up to a multiple of 2 s (the unprivileged limit), keeping
+ * the threshold's share of the window.
+ */
+static void
+pressure_open(pressure_priv *c, int i)
+{
+    gchar *path;
+    int window;
+
+    c->tfd[i] = -1;
+    path = g_strconcat(PSI_DIR, psi_name[i], NULL);
+    c->fd[i] = open(path, O_RDONLY | O_CLOEXEC);
+    if (c->fd[i] < 0) {
+        DBG("can't open %s\n", path);
+        g_free(path);
+        return;
+    }
+    c->tfd[i] = psi_trigger_open(path, c->stall_ms * 1000, c->window_ms * 1000);
+    if (c->tfd[i] < 0 && c->window_ms % 2000) {
+        window = (c->window_ms / 2000 + 1) * 2000;
+        c->tfd[i] = psi_trigger_open(path,
+            c->stall_ms * window / c->window_ms * 1000, window * 1000);
+    }
+    if (c->tfd[i] >= 0)
+        c->tsrc[i] = g_unix_fd_add(c->tfd[i], G_IO_PRI | G_IO_ERR,
+            (GUnixFDSourceFunc) pressure_trigger, c);
+    else
+        LOG(LOG_INFO, "pressure: no trigger on %s, sampling only\n", path);
+    g_free(path);
+}
+
+/**
+ * pressure_sample - read all resources and update the tooltip.
+ * @c:    pressure_priv. (transfer none)
+ * @tick: push a chart column (timed sample) rather than refreshing the
+ *        pending one (trigger).
+ *
+ * The column takes, per resource, the higher of the current reading and
+ * the peaks recorded by triggers since the previous column.
+ */
+static void
+pressure_sample(pressure_priv *c, gboolean tick)
+{
+    GString *str;
+    float total[PSI_NUM];
+    int i;
+
+    str = g_string_sized_new(160);
+    g_string_append(str, "<b>Pressure</b> (avg10 some/full)");
+    for (i = 0; i < PSI_NUM; i++) {
+        if (c->fd[i] < 0 || psi_read(c->fd[i], &c->some[i], &c->full[i]))
+            c->some[i] = c->full[i] = 0;
+        c->peak[i] = MAX(c->peak[i], c->some[i]);
+        total[i] = c->peak[i];
+        if (tick)
+            c->peak[i] = 0;
+        g_string_append_printf(str, "\n<b>%s:</b> %.1f%% / %.1f%%%s",
+            psi_label[i], c->some[i], c->full[i],
+            c->stalled[i] ? " <b>stalled</b>" : "");
+    }
+    DBG("cpu=%f mem=%f io=%f\n", total[0], total[1], total[2]);
+    if (tick)
+        k->add_tick(&c->chart, total);
+    gtk_widget_set_tooltip_markup(((plugin_instance *)c)->pwid, str->str);
+    g_string_free(str, TRUE);
+}
+
+/**
+ * pressure_update - low-frequency timeout: sample for the chart history.
+ * @c: pressure_priv. (transfer none)
+ *
+ * Clears the stalled flags after sampling, so a stall stays marked in the
+ * tooltip until the next regular sample.  Also closes the descriptors of
+ * triggers whose source pressure_trigger() removed after an error.
+ *
+ * Returns: TRUE to keep the timeout active.
+ */
+static gboolean
+pressure_update(pressure_priv *c)
+{
+    int i;
+
+    pressure_sample(c, TRUE);
+    for (i = 0; i < PSI_NUM; i++) {
+        c->stalled[i] = FALSE;
+        if (c->tfd[i] >= 0 && !c->tsrc[i]) {
+            close(c->tfd[i]);
+            c->tfd[i] = -1;
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * pressure_trigger - PSI trigger callback (POLLPRI on a trigger descriptor).
+ * @fd:   the trigger descriptor.
+ * @cond: G_IO_PRI on a threshold crossing, G_IO_ERR if the trigger is gone.
+ * @c:    pressure_priv. (transfer none)
+ *
+ * The descriptor is left open on error: the source still polls it until
+ * G_SOURCE_REMOVE is returned, so pressure_update() closes it later.
+ *
+ * Returns: G_SOURCE_CONTINUE to keep watching, G_SOURCE_REMOVE on error.
+ */
+static gboolean
+pressure_trigger(gint fd, GIOCondition cond, pressure_priv *c)
+{
+    int i;
+
+    for (i = 0; i < PSI_NUM && c->tfd[i] != fd; i++)
+        ;
+    if (i == PSI_NUM)
+        return G_SOURCE_REMOVE;
+    if (cond & G_IO_ERR) {
+        ERR("pressure: trigger on %s failed\n", psi_name[i]);
+        c->tsrc[i] = 0;
+        return G_SOURCE_REMOVE;
+    }
+    DBG("%s stall\n", psi_name[i]);
+    c->stalled[i] = TRUE;
+    pressure_sample(c, FALSE);
+    return G_SOURCE_CONTINUE;
+}
+
+/**
+ * pressure_constructor - initialise the PSI chart plugin on top of chart_class.
+ * @p: plugin_instance. (transfer none)
+ *
+ * Obtains chart_class via class_get("chart"), calls its constructor, reads
+ * config keys (transfer-none), opens the pressure files and registers the
+ * triggers, configures three auto-ranging chart rows and installs the
+ * sampling timeout.  Samples once immediately.
+ *
+ * Returns: 1 on success, 0 if chart class is unavailable.
+ */
+static int
+pressure_constructor(plugin_instance *p)
+{
+    pressure_priv *c;
+    int i;
+
+    if (!(k = class_get("chart")))
+        return 0;
+    if (!PLUGIN_CLASS(k)->constructor(p))
+        return 0;
+    c = (pressure_priv *) p;
+
+    c->colors[PSI_CPU] = "green";
+    c->colors[PSI_MEM] = "red";
+    c->colors[PSI_IO] = "blue";
+    c->period = 10;
+    c->stall_ms = 150;
+    c->window_ms = 1000;
+    XCG(p->xc, "CpuColor", &c->colors[PSI_CPU], str);
+    XCG(p->xc, "MemColor", &c->colors[PSI_MEM], str);
+    XCG(p->xc, "IoColor", &c->colors[PSI_IO], str);
+    XCG(p->xc, "PollingTime", &c->period, int);
+    XCG(p->xc, "StallMs", &c->stall_ms, int);
+    XCG(p->xc, "WindowMs", &c->window_ms, int);
+    c->period = MAX(c->period, 1);
+    c->window_ms = CLAMP(c->window_ms, 500, 10000);
+    c->stall_ms = CLAMP(c->stall_ms, 1, c->window_ms);
+
+    for (i = 0; i < PSI_NUM; i++)
+        pressure_open(c, i);
+    if (c->fd[PSI_CPU] < 0 && c->fd[PSI_MEM] < 0 && c->fd[PSI_IO] < 0)
+        ERR("pressure: %s not available (kernel without CONFIG_PSI?)\n",
+            PSI_DIR);
+
+    k->set_rows(&c->chart, PSI_NUM, c->colors);
+    k->set_autoscale(&c->chart, FALSE, PSI_FLOOR);
+    pressure_update(c);
+    c->timer = g_timeout_add_seconds(c->period,
+        (GSourceFunc) pressure_update, (gpointer) c);
+    return 1;
+}
+
+
+/**
+ * pressure_destructor - stop the timer and triggers, release chart_class.
+ * @p: plugin_instance. (transfer none)
+ *
+ * Closing a trigger descriptor unregisters the trigger in the kernel.
+ */
+static void
+pressure_destructor(plugin_instance *p)
+{
+    pressure_priv *c = (pressure_priv *) p;
+    int i;
+
+    if (c->timer)
+        g_source_remove(c->timer);
+    for (i = 0; i < PSI_NUM; i++) {
+        if (c->tsrc[i])
+            g_source_remove(c->tsrc[i]);
+        if (c->tfd[i] >= 0)
+            close(c->tfd[i]);
+        if (c->fd[i] >= 0)
+            close(c->fd[i]);
+    }
+    PLUGIN_CLASS(k)->destructor(p);
+    class_put("chart");
+    return;
+}
+
+
+static plugin_class class = {
+    .count       = 0,
+    .type        = "pressure",
+    .name        = "Pressure",
+    .version     = "1.0",
+    .description = "Display CPU, memory and I/O pressure (PSI)",
+    .priv_size   = sizeof(pressure_priv),
+
+    .constructor = pressure_constructor,
+    .destructor  = pressure_destructor,
+};
+static plugin_class *class_ptr = (plugin_class *) &class;
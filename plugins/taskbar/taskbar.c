@@ -20,14 +20,18 @@
  * DESTRUCTOR SEQUENCE
  * -------------------
  * taskbar_destructor():
- *   1. Cancel any pending dim idle (pending_dim_id).
+ *   1. Cancel any pending dim idle (pending_dim_id) and preview timeouts.
  *   2. Disconnect all FbEv signal handlers by func pointer.
  *   3. Remove all tasks from the hash table via task_remove_every (which calls
- *      del_task with hdel=0 for each task — per-window filters removed there).
- *   4. Destroy the hash table.
+ *      del_task with hdel=0 for each task — per-window filters and cached
+ *      previews are released there).
+ *   4. Destroy the hash table, the (now empty) desktop index and group table,
+ *      and the button background cache.
  *   5. XFree(tb->wins) if non-NULL.
- *   6. gtk_widget_destroy(tb->menu) — the bar itself is destroyed by the parent
- *      p->pwid destruction.
+ *   6. gtk_widget_destroy(tb->menu), the group member list (tb->gmenu) and
+ *      the preview popup (tb->pwin) —
+ *      the bar itself is destroyed by the parent p->pwid destruction.
+ *   7. Drop the reference to the shared gen_pixbuf.
  *
  * NOTE ON MULTI-TU CLASS REGISTRATION
  * ------------------------------------
@@ -69,11 +73,18 @@ taskbar_constructor(plugin_instance *p)
     tb->task_width_max    = TASK_WIDTH_MAX;
     tb->task_height_max   = p->panel->max_elem_height;
     tb->task_list         = g_hash_table_new(g_int_hash, g_int_equal);
+    tb->desk_tasks        = g_hash_table_new_full(g_direct_hash,
+        g_direct_equal, NULL, (GDestroyNotify) g_queue_free);
+    tb->groups            = g_hash_table_new(g_str_hash, g_str_equal);
+    tb->bg_cache          = g_hash_table_new_full(g_direct_hash,
+        g_direct_equal, NULL, (GDestroyNotify) cairo_surface_destroy);
     tb->focused_state     = GTK_STATE_FLAG_ACTIVE;
     tb->normal_state      = GTK_STATE_FLAG_NORMAL;
     tb->spacing           = 0;
     tb->use_mouse_wheel   = 1;
     tb->use_urgency_hint  = 1;
+    tb->preview_size      = 240;
+    tb->preview_cache     = 8192;
 
     XCG(xc, "tooltips", &tb->tooltips, enum, bool_enum);
     XCG(xc, "iconsonly", &tb->icons_only, enum, bool_enum);
@@ -84,6 +95,18 @@ taskbar_constructor(plugin_instance *p)
     XCG(xc, "usemousewheel", &tb->use_mouse_wheel, enum, bool_enum);
     XCG(xc, "useurgencyhint", &tb->use_urgency_hint, enum, bool_enum);
     XCG(xc, "maxtaskwidth", &tb->task_width_max, int);
+    XCG(xc, "groupbyclass", &tb->group_by_class, enum, bool_enum);
+    XCG(xc, "showpreviews", &tb->show_previews, enum, bool_enum);
+    XCG(xc, "previewsize", &tb->preview_size, int);
+    XCG(xc, "previewcache", &tb->preview_cache, int);
+    tb->preview_size = CLAMP(tb->preview_size, 32, 1024);
+    tb->preview_cache = MAX(tb->preview_cache, 256);
+    /* previews hang off per-window buttons, which grouping replaces; when
+     * they are shown, the preview popup carries the title */
+    if (tb->group_by_class)
+        tb->show_previews = 0;
+    else if (tb->show_previews)
+        tb->tooltips = 0;
 
     /* FIXME: until per-plugin elem height limit is ready, lets
      * use hardcoded TASK_HEIGHT_MAX pixels */
@@ -127,6 +150,10 @@ taskbar_destructor(plugin_instance *p)
         g_source_remove(tb->pending_dim_id);
         tb->pending_dim_id = 0;
     }
+    if (tb->preview_delay)
+        g_source_remove(tb->preview_delay);
+    if (tb->preview_timer)
+        g_source_remove(tb->preview_timer);
     /* Per-window filters are removed in del_task via task_remove_every below. */
     g_signal_handlers_disconnect_by_func(G_OBJECT (fbev),
             tb_net_current_desktop, tb);
@@ -140,10 +167,22 @@ taskbar_destructor(plugin_instance *p)
     g_hash_table_foreach_remove(tb->task_list, (GHRFunc) task_remove_every,
             NULL);
     g_hash_table_destroy(tb->task_list);
+    g_hash_table_destroy(tb->desk_tasks);
+    g_hash_table_destroy(tb->groups);
+    /* the bar outlives us until p->pwid goes; keep it off the cache */
+    g_signal_handlers_disconnect_matched(G_OBJECT(tb->bar),
+        G_SIGNAL_MATCH_DATA, 0, 0, NULL, NULL, tb);
+    g_hash_table_destroy(tb->bg_cache);
     if (tb->wins)
         XFree(tb->wins);
     //gtk_widget_destroy(tb->bar); // destroy of p->pwid does it all
     gtk_widget_destroy(tb->menu);
+    if (tb->gmenu)
+        gtk_widget_destroy(tb->gmenu);
+    if (tb->pwin)
+        gtk_widget_destroy(tb->pwin);
+    if (tb->gen_pixbuf)
+        g_object_unref(G_OBJECT(tb->gen_pixbuf));
     DBG("alloc_no=%d\n", tb->alloc_no);
     return;
 }
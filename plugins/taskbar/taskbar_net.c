@@ -9,7 +9,8 @@
  * ROOT WINDOW EVENTS (via FbEv signals)
  * ---------------------------------------
  * tb_net_client_list:   _NET_CLIENT_LIST changed -> rebuild task list.
- * tb_net_current_desktop: _NET_CURRENT_DESKTOP changed -> update cur_desk, refresh display.
+ * tb_net_current_desktop: _NET_CURRENT_DESKTOP changed -> update cur_desk, refresh
+ *                         the tasks of the old and new desktop only.
  * tb_net_number_of_desktops: _NET_NUMBER_OF_DESKTOPS changed -> update desk_num.
  * tb_net_active_window: _NET_ACTIVE_WINDOW changed -> update tb->focused.
  *
@@ -58,7 +59,9 @@ gboolean use_net_active = FALSE;
  * Creates task entries for newly-appeared windows (after filtering by
  * accept_net_wm_state and accept_net_wm_window_type), increments refcount
  * for existing tasks, then calls task_remove_stale to delete tasks whose
- * windows are no longer in the list.
+ * windows are no longer in the list.  New buttons are shown or hidden as
+ * they are built and removed ones are destroyed, so the other tasks need no
+ * refresh.
  *
  * Ownership: tb->wins is replaced on each call (old value XFree'd first).
  */
@@ -95,6 +98,7 @@ tb_net_client_list(GtkWidget *widget, taskbar_priv *tb)
             tk->tb = tb;
             tk->iconified = nws.hidden;
             tk->desktop = get_net_wm_desktop(tk->win);
+            tk_index_add(tb, tk);
             tk->nws = nws;
             tk->nwwt = nwwt;
             if( tb->use_urgency_hint && tk_has_urgency(tk)) {
@@ -114,7 +118,6 @@ tb_net_client_list(GtkWidget *widget, taskbar_priv *tb)
     /* remove windows that arn't in the NET_CLIENT_LIST anymore */
     g_hash_table_foreach_remove(tb->task_list, (GHRFunc) task_remove_stale,
         NULL);
-    tb_display(tb);
     return;
 }
 
@@ -125,14 +128,20 @@ tb_net_client_list(GtkWidget *widget, taskbar_priv *tb)
  * @widget: FbEv GObject (unused).
  * @tb:     Taskbar instance.
  *
- * Updates tb->cur_desk and refreshes the display to show/hide tasks
- * based on the new active desktop.
+ * Updates tb->cur_desk.  Only tasks of the old and the new desktop can
+ * change visibility (sticky ones are shown on both), so only those two
+ * queues of the desktop index are refreshed; with show_all_desks, none.
  */
 void
 tb_net_current_desktop(GtkWidget *widget, taskbar_priv *tb)
 {
+    guint old = tb->cur_desk;
+
     tb->cur_desk = get_net_current_desktop();
-    tb_display(tb);
+    if (tb->cur_desk == old || tb->show_all_desks)
+        return;
+    tb_display_desk(tb, old);
+    tb_display_desk(tb, tb->cur_desk);
     return;
 }
 
@@ -224,12 +233,12 @@ tb_net_active_window(GtkWidget *widget, taskbar_priv *tb)
  * (not the root window).  Looks up the task by window ID and dispatches
  * based on the changed atom:
  *
- *   a_NET_WM_DESKTOP  -> update task desktop, refresh display
+ *   a_NET_WM_DESKTOP  -> move task in the desktop index, refresh its button
  *   XA_WM_NAME        -> re-read and re-display window title
  *   XA_WM_HINTS       -> re-read icon (may have just been set after map);
  *                        start/stop flash if urgency hint changed
  *   a_NET_WM_STATE    -> re-check accept filter; remove task if no longer accepted;
- *                        otherwise update iconified state and title
+ *                        otherwise update iconified state, title and visibility
  *   a_NET_WM_ICON     -> refresh ARGB icon
  *   a_NET_WM_WINDOW_TYPE -> re-check accept filter; remove task if window type changed
  */
@@ -249,8 +258,7 @@ tb_propertynotify(taskbar_priv *tb, XEvent *ev)
         DBG("win=%x\n", ev->xproperty.window);
         if (at == a_NET_WM_DESKTOP) {
             DBG("NET_WM_DESKTOP\n");
-            tk->desktop = get_net_wm_desktop(win);
-            tb_display(tb);
+            tk_set_desktop(tb, tk, get_net_wm_desktop(win));
         } else if (at == XA_WM_NAME) {
             DBG("WM_NAME\n");
             tk_get_names(tk);
@@ -258,8 +266,7 @@ tb_propertynotify(taskbar_priv *tb, XEvent *ev)
         } else if (at == XA_WM_HINTS)   {
             /* some windows set their WM_HINTS icon after mapping */
             DBG("XA_WM_HINTS\n");
-            tk_update_icon (tb, tk, XA_WM_HINTS);
-            gtk_image_set_from_pixbuf (GTK_IMAGE(tk->image), tk->pixbuf);
+            tk_set_icon(tb, tk);
             if (tb->use_urgency_hint) {
                 if (tk_has_urgency(tk)) {
                     //tk->urgency = 1;
@@ -267,6 +274,7 @@ tb_propertynotify(taskbar_priv *tb, XEvent *ev)
                 } else {
                     //tk->urgency = 0;
                     tk_unflash_window(tk);
+                    tk_display(tb, tk);
                 }
             }
         } else if (at == a_NET_WM_STATE) {
@@ -276,27 +284,21 @@ tb_propertynotify(taskbar_priv *tb, XEvent *ev)
             get_net_wm_state(tk->win, &nws);
             if (!accept_net_wm_state(&nws, tb->accept_skip_pager)) {
                 del_task(tb, tk, 1);
-                tb_display(tb);
             } else {
                 tk->iconified = nws.hidden;
                 tk_set_names(tk);
+                tk_display(tb, tk);
             }
         } else if (at == a_NET_WM_ICON) {
             DBG("_NET_WM_ICON\n");
-            DBG("#0 %d\n", GDK_IS_PIXBUF (tk->pixbuf));
-            tk_update_icon (tb, tk, a_NET_WM_ICON);
-            DBG("#1 %d\n", GDK_IS_PIXBUF (tk->pixbuf));
-            gtk_image_set_from_pixbuf (GTK_IMAGE(tk->image), tk->pixbuf);
-            DBG("#2 %d\n", GDK_IS_PIXBUF (tk->pixbuf));
+            tk_set_icon(tb, tk);
         } else if (at == a_NET_WM_WINDOW_TYPE) {
             net_wm_window_type nwwt;
 
             DBG("_NET_WM_WINDOW_TYPE\n");
             get_net_wm_window_type(tk->win, &nwwt);
-            if (!accept_net_wm_window_type(&nwwt)) {
+            if (!accept_net_wm_window_type(&nwwt))
                 del_task(tb, tk, 1);
-                tb_display(tb);
-            }
         } else {
             DBG("at = %d\n", at);
         }
@@ -310,8 +312,10 @@ tb_propertynotify(taskbar_priv *tb, XEvent *ev)
  * @event: GDK-translated event (unused).
  * @tb:    Taskbar instance.
  *
- * Installed on each task's GdkWindow via gdk_window_add_filter.
- * Passes PropertyNotify events to tb_propertynotify and always returns
+ * Installed on each task's GdkWindow via gdk_window_add_filter, and with
+ * showpreviews on the frames of previewed windows.  Passes PropertyNotify
+ * events to tb_propertynotify, DamageNotify to tk_preview_damaged, and
+ * drops the preview of a reparented window.  Always returns
  * GDK_FILTER_CONTINUE so GDK continues normal event processing.
  *
  * Returns: GDK_FILTER_CONTINUE always (we observe, never consume events).
@@ -319,11 +323,18 @@ tb_propertynotify(taskbar_priv *tb, XEvent *ev)
 GdkFilterReturn
 tb_event_filter( XEvent *xev, GdkEvent *event, taskbar_priv *tb)
 {
+    Window damaged;
+    task *tk;
 
     //RET(GDK_FILTER_CONTINUE);
     g_assert(tb != NULL);
-    if (xev->type == PropertyNotify )
+    if (tb->show_previews && (damaged = winthumb_damaged(xev)) != None)
+        tk_preview_damaged(tb, damaged);
+    else if (xev->type == PropertyNotify )
         tb_propertynotify(tb, xev);
+    else if (xev->type == ReparentNotify && tb->show_previews
+            && (tk = find_task(tb, xev->xreparent.window)))
+        tk_preview_drop(tb, tk);    /* the frame changed */
     return GDK_FILTER_CONTINUE;
 }
 
@@ -24,24 +24,56 @@
  * _NET_CLIENT_LIST that passes the accept_net_wm_state / accept_net_wm_window_type
  * filters.  Each task is:
  *   1. g_new0(task, 1) — zeroed allocation
- *   2. tk_build_gui    — button + label + image + per-window GDK filter
+ *   2. tk_build_gui    — button + label + image (or group membership) +
+ *                        per-window GDK filter
  *   3. tk_get_names    — read _NET_WM_NAME or WM_NAME
  *   4. tk_set_names    — populate label text and tooltip
- *   5. g_hash_table_insert into tb->task_list (keyed by tk->win)
+ *   5. g_hash_table_insert into tb->task_list (keyed by tk->win), and
+ *      tk_index_add into the queue of its desktop
  *
  * Tasks are destroyed in del_task(), which:
  *   1. Removes the flash timer (g_source_remove tk->flash_timeout)
  *   2. Removes the per-window GDK filter and unref's the GdkWindow
- *   3. gtk_widget_destroy(tk->button) — removes from bar widget tree
+ *   3. gtk_widget_destroy(tk->button) — removes from bar widget tree (or
+ *      tk_group_remove when grouped); tk_index_remove unlinks it from its
+ *      desktop queue
  *   4. tk_free_names — g_free's name and iname
  *   5. g_free(tk)
  *
+ * VISIBILITY INDEX
+ * ----------------
+ * Every task is linked (through its embedded tk->desk_link, so no allocation)
+ * into the GQueue of its desktop in tb->desk_tasks; sticky windows share the
+ * ALL_WORKSPACES queue.  A desktop switch only re-evaluates the tasks of the
+ * old and the new desktop (tb_display_desk), and tk_update() touches a
+ * button only if its visibility or focus state actually changed (tk->shown
+ * and the button's state flags), so switching among hundreds of windows
+ * costs work proportional to the two desktops involved.  tb_display() still
+ * walks every task, for the rare changes that can affect all of them.
+ *
+ * GROUPING BY WM_CLASS
+ * --------------------
+ * With groupbyclass set, tasks get no button of their own.  tk_build_gui()
+ * files each task under its WM_CLASS (task::ch, res_class else res_name) in
+ * a tk_group from tb->groups, and the group owns the one button (icon of its
+ * first member, a count badge, and a label naming either the sole visible
+ * member or the class).  The group's visible count follows tk->shown, so
+ * tk_update() keeps the same delta rules; a group with several visible
+ * members pops up a list of them instead of acting on a window.  Groups are
+ * freed with their last member.  TK_BUTTON() gives the widget showing a task
+ * in either mode.
+ *
+ * HOVER PREVIEWS
+ * --------------
+ * With showpreviews, a task's captured preview lives on the task
+ * (tk->preview, tk->frame, tk->damage) and in the tb->previews LRU list;
+ * see taskbar_ui.c.  del_task() releases it with tk_preview_drop().
+ *
  * ICON LOADING PRIORITY
  * ---------------------
- * tk_update_icon() tries sources in this order:
- *   1. _NET_WM_ICON (ARGB pixel data) via get_netwm_icon()
- *   2. WM_HINTS icon_pixmap via get_wm_icon() (cairo-xlib path)
- *   3. tb->gen_pixbuf (built from default.xpm) as fallback
+ * tk_update_icon() takes the icon from get_window_icon() (panel/wmicon.c),
+ * which caches it per window from _NET_WM_ICON or the WM_HINTS pixmap, and
+ * falls back to tb->gen_pixbuf (built from default.xpm).
  *
  * Ownership: tk->pixbuf is a (transfer full) GdkPixbuf ref; replaced in
  * tk_update_icon by g_object_unref of the old value if it changes.
@@ -100,6 +132,7 @@
 /* Task and taskbar structs */
 typedef struct _task task;
 typedef struct _taskbar taskbar_priv;
+typedef struct _tk_group tk_group;
 
 /**
  * struct _task - per-window task entry.
@@ -118,17 +151,18 @@ struct _task {
     char *iname;            /**< Iconified title with brackets: "[Title]" (g_strdup'd).
                              *   Both name and iname are freed together in tk_free_names. */
     GtkWidget *button;      /**< GtkButton for this task; owned by tb->bar widget tree.
-                             *   gtk_widget_destroy'd in del_task. */
+                             *   gtk_widget_destroy'd in del_task.  NULL when grouped. */
     GtkWidget *label;       /**< GtkLabel inside button (NULL if icons_only). */
     GtkWidget *eb;          /**< Unused; kept for potential future use. */
-    GtkWidget *image;       /**< GtkImage showing tk->pixbuf inside button. */
+    GtkWidget *image;       /**< GtkImage showing tk->pixbuf inside button (NULL when grouped). */
     GdkPixbuf *pixbuf;      /**< Current task icon; (transfer full) ref.
                              *   Replaced in tk_update_icon; old ref is g_object_unref'd. */
 
     int refcount;           /**< Reference count for tb_net_client_list stale removal.
                              *   Incremented when win still appears in _NET_CLIENT_LIST;
                              *   decremented in task_remove_stale; removed when it hits 0. */
-    XClassHint ch;          /**< WM_CLASS hint (res_name + res_class); not currently used. */
+    XClassHint ch;          /**< WM_CLASS hint (res_name + res_class); read in group mode
+                             *   only, both strings XFree'd in del_task. */
     int pos_x;              /**< Unused; kept for potential future use. */
     int width;              /**< Unused; kept for potential future use. */
     guint desktop;          /**< Virtual desktop this window is on (_NET_WM_DESKTOP).
@@ -136,14 +170,46 @@ struct _task {
     net_wm_state nws;       /**< _NET_WM_STATE bitfield snapshot. */
     net_wm_window_type nwwt;/**< _NET_WM_WINDOW_TYPE bitfield snapshot. */
     guint flash_timeout;    /**< g_timeout_add source ID for urgency flash; 0 if not flashing. */
+    GList desk_link;        /**< Link in the tb->desk_tasks queue of tk->desktop;
+                             *   data is tk.  Embedded, so indexing never allocates. */
+    Window frame;           /**< Child of the root captured for the preview (WM frame or
+                             *   win); None until first captured.  See tk_preview_watch. */
+    GdkWindow *gdkframe;    /**< GDK wrapper for frame holding tb_event_filter (for
+                             *   DamageNotify); NULL if frame == win or None. */
+    gulong damage;          /**< XDamage id on frame while previewed; 0 otherwise. */
+    cairo_surface_t *preview; /**< Cached hover preview (RGB24); NULL if none.  Counted
+                             *   in tb->preview_bytes; freed in tk_preview_drop. */
+    GList preview_link;     /**< Link in tb->previews while preview is set; data is tk. */
+    tk_group *group;        /**< Group showing this task; NULL unless groupbyclass. */
+    GList group_link;       /**< Link in group->tasks; data is tk. */
     unsigned int focused:1;         /**< Non-zero when this is the active (_NET_ACTIVE_WINDOW) task. */
     unsigned int iconified:1;       /**< Non-zero when the window is hidden/iconified. */
     unsigned int urgency:1;         /**< Non-zero when WM_HINTS has XUrgencyHint set. */
-    unsigned int using_netwm_icon:1;/**< Non-zero if pixbuf came from _NET_WM_ICON. */
     unsigned int flash:1;           /**< Non-zero if urgency flash is active. */
     unsigned int flash_state:1;     /**< Current flash phase (toggles each interval). */
+    unsigned int shown:1;           /**< Button is shown; as last applied by tk_update(). */
+    unsigned int preview_stale:1;   /**< Window damaged since preview was captured. */
+};
+
+/**
+ * struct _tk_group - tasks of one WM_CLASS sharing a button (groupbyclass).
+ *
+ * Allocated with g_new0 by the first member; freed with the last one.
+ */
+struct _tk_group {
+    struct _taskbar *tb;    /**< Back-pointer to the owning taskbar instance. */
+    char *key;              /**< WM_CLASS res_class (else res_name, else ""); g_strdup'd.
+                             *   Also the key in tb->groups. */
+    GtkWidget *button;      /**< GtkButton for the group; owned by tb->bar widget tree. */
+    GtkWidget *image;       /**< GtkImage showing the first member's icon. */
+    GtkWidget *label;       /**< GtkLabel inside button (NULL if icons_only). */
+    GQueue tasks;           /**< Member tasks in arrival order, via task::group_link. */
+    int visible;            /**< Members with tk->shown set; shown as the count badge. */
 };
 
+/** The button showing @tk: its own, or its group's in groupbyclass mode. */
+#define TK_BUTTON(tk)  ((tk)->group ? (tk)->group->button : (tk)->button)
+
 /**
  * struct _taskbar - taskbar plugin private state.
  *
@@ -159,6 +225,25 @@ struct _taskbar {
     GHashTable  *task_list;     /**< Hash table: Window -> task*.  Owns all task values.
                                  *   Key is &tk->win (pointer into the task struct).
                                  *   Destroyed in taskbar_destructor after all tasks removed. */
+    GHashTable  *desk_tasks;    /**< Desktop number -> GQueue of task* (ALL_WORKSPACES for
+                                 *   sticky windows); links are task::desk_link.  Queues
+                                 *   are empty when destroyed with the table. */
+    GHashTable  *groups;        /**< WM_CLASS key -> tk_group* (groupbyclass only); keys are
+                                 *   owned by the groups.  Empty when destroyed. */
+    GHashTable  *bg_cache;      /**< (state, width, height) key -> cairo_surface_t* button
+                                 *   background; see tk_button_bg() in taskbar_ui.c. */
+    GQueue previews;            /**< Tasks with a cached preview, most recently captured
+                                 *   first (LRU); links are task::preview_link. */
+    gsize preview_bytes;        /**< Pixel memory of all cached previews. */
+    task *preview_tk;           /**< Hovered task whose preview is (to be) shown; NULL if none. */
+    GtkWidget *pwin;            /**< Preview popup (GTK_WINDOW_POPUP); created on first use,
+                                 *   destroyed in destructor.  pimage/plabel are its children. */
+    GtkWidget *pimage;
+    GtkWidget *plabel;
+    guint preview_delay;        /**< g_timeout_add source ID of the hover delay; 0 if none. */
+    guint preview_timer;        /**< g_timeout_add source ID of tk_preview_tick; 0 if none. */
+    GtkWidget *gmenu;           /**< Member list of the last popped-up group; NULL if none.
+                                 *   Replaced on each popup, destroyed in destructor. */
     GtkWidget *hbox;            /**< Unused; kept for potential future use. */
     GtkWidget *bar;             /**< GtkBar containing all task buttons; owned by p->pwid. */
     GtkWidget *space;           /**< Unused spacer; kept for potential future use. */
@@ -195,6 +280,10 @@ struct _taskbar {
     int icons_only;             /**< If non-zero, show only the icon (no text label). */
     int use_mouse_wheel;        /**< If non-zero, connect scroll-event for un/iconify. */
     int use_urgency_hint;       /**< If non-zero, flash buttons for windows with XUrgencyHint. */
+    int group_by_class;         /**< If non-zero, one button per WM_CLASS (config: groupbyclass). */
+    int show_previews;          /**< If non-zero, pop up window previews on hover (config: showpreviews). */
+    int preview_size;           /**< Preview bounding square in pixels (config: previewsize). */
+    int preview_cache;          /**< Cap on cached preview memory in KiB (config: previewcache). */
     int discard_release_event;  /**< Set to 1 when Ctrl+RMB propagated to bar to suppress next release. */
     int     pending_dim;        /**< Dimension value waiting to be applied via idle callback. */
     guint   pending_dim_id;     /**< g_idle_add source ID for taskbar_apply_dim; 0 if none pending. */
@@ -237,10 +326,13 @@ void del_task(taskbar_priv *tb, task *tk, int hdel);
 gboolean task_remove_every(Window *win, task *tk);
 gboolean task_remove_stale(Window *win, task *tk, gpointer data);
 gboolean tk_has_urgency(task *tk);
-void tk_update_icon(taskbar_priv *tb, task *tk, Atom a);
+void tk_update_icon(taskbar_priv *tb, task *tk);
 void tk_flash_window(task *tk);
 void tk_unflash_window(task *tk);
 void tk_raise_window(task *tk, guint32 time);
+void tk_index_add(taskbar_priv *tb, task *tk);
+void tk_index_remove(taskbar_priv *tb, task *tk);
+void tk_set_desktop(taskbar_priv *tb, task *tk, guint desktop);
 
 /* taskbar_net.c */
 void net_active_detect(void);
@@ -253,6 +345,12 @@ GdkFilterReturn tb_event_filter(XEvent *, GdkEvent *, taskbar_priv *);
 /* taskbar_ui.c */
 void tk_display(taskbar_priv *tb, task *tk);
 void tb_display(taskbar_priv *tb);
+void tb_display_desk(taskbar_priv *tb, guint desktop);
+void tk_set_icon(taskbar_priv *tb, task *tk);
+void tk_group_remove(taskbar_priv *tb, task *tk);
+void tk_group_set_names(tk_group *g);
+void tk_preview_drop(taskbar_priv *tb, task *tk);
+void tk_preview_damaged(taskbar_priv *tb, Window win);
 void tk_build_gui(taskbar_priv *tb, task *tk);
 void tb_make_menu(GtkWidget *widget, taskbar_priv *tb);
 void taskbar_build_gui(plugin_instance *p);
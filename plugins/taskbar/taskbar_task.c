@@ -12,6 +12,10 @@
  *   - show_iconified is set (when the task is minimised), OR
  *     show_mapped is set (when the task is not minimised).
  *
+ * The desktop index (tk_index_add / tk_index_remove / tk_set_desktop) keeps
+ * each task in the tb->desk_tasks queue of its desktop, so a desktop switch
+ * only has to look at the tasks of the two desktops involved.
+ *
  * ACCEPT FILTERS
  * --------------
  * accept_net_wm_state():
@@ -32,19 +36,12 @@
  *
  * ICON LOADING
  * ------------
- * tk_update_icon() tries three sources in order:
- *   1. get_netwm_icon() — reads _NET_WM_ICON (ARGB32 pixel data via XGetWindowProperty).
- *      Data format: [width, height, ARGB pixels...].  Validates dimensions (16-256).
- *      Converts ARGB -> RGBA bytes (argbdata_to_pixdata).  Scales to iconsize x iconsize.
- *      Data is (transfer full) XFree'd.
- *
- *   2. get_wm_icon() — reads WM_HINTS icon_pixmap/icon_mask via XGetWMHints.
- *      Uses cairo-xlib (_wnck_gdk_pixbuf_get_from_pixmap) to convert X11 Pixmap
- *      to GdkPixbuf (replaces the GTK2 GdkColormap path).  Applies mask via
- *      apply_mask() to create RGBA with transparency.  Scales to iconsize x iconsize.
- *
- *   3. get_generic_icon() — returns g_object_ref(tb->gen_pixbuf), the default.xpm
- *      fallback icon.
+ * tk_update_icon() asks get_window_icon() (panel/wmicon.c) for an
+ * iconsize x iconsize icon.  The core keeps one entry per client window,
+ * read from _NET_WM_ICON (best-fitting sub-icon) or else the WM_HINTS
+ * pixmap/mask, and shares it with the pager and icons plugins; it drops the
+ * entry itself when either property changes, before tb_event_filter runs.
+ * Windows without an icon get get_generic_icon(), a ref to tb->gen_pixbuf.
  *
  * The old tk->pixbuf ref is g_object_unref'd whenever tk->pixbuf changes.
  *
@@ -81,6 +78,64 @@ task_visible(taskbar_priv *tb, task *tk)
             || (!tk->iconified && tb->show_mapped)) );
 }
 
+/**
+ * tk_index_add - link a task into the queue of its desktop.
+ * @tb: Taskbar instance.
+ * @tk: Task not yet in any queue; tk->desktop must be set.
+ *
+ * Creates the queue on first use.  Uses the embedded tk->desk_link.
+ */
+void
+tk_index_add(taskbar_priv *tb, task *tk)
+{
+    GQueue *q;
+
+    q = g_hash_table_lookup(tb->desk_tasks, GUINT_TO_POINTER(tk->desktop));
+    if (!q) {
+        q = g_queue_new();
+        g_hash_table_insert(tb->desk_tasks, GUINT_TO_POINTER(tk->desktop), q);
+    }
+    tk->desk_link.data = tk;
+    g_queue_push_tail_link(q, &tk->desk_link);
+    return;
+}
+
+/**
+ * tk_index_remove - unlink a task from the queue of its desktop.
+ * @tb: Taskbar instance.
+ * @tk: Task added with tk_index_add(); tk->desktop must be unchanged since.
+ */
+void
+tk_index_remove(taskbar_priv *tb, task *tk)
+{
+    GQueue *q;
+
+    q = g_hash_table_lookup(tb->desk_tasks, GUINT_TO_POINTER(tk->desktop));
+    if (q)
+        g_queue_unlink(q, &tk->desk_link);
+    return;
+}
+
+/**
+ * tk_set_desktop - move a task to another desktop and update its button.
+ * @tb:      Taskbar instance.
+ * @tk:      Task.
+ * @desktop: New _NET_WM_DESKTOP value.
+ *
+ * Only this task's visibility can change, so only it is re-displayed.
+ */
+void
+tk_set_desktop(taskbar_priv *tb, task *tk, guint desktop)
+{
+    if (desktop == tk->desktop)
+        return;
+    tk_index_remove(tb, tk);
+    tk->desktop = desktop;
+    tk_index_add(tb, tk);
+    tk_display(tb, tk);
+    return;
+}
+
 /**
  * accept_net_wm_state - check whether a window's WM state passes the taskbar filter.
  * @nws:               Pointer to the window's net_wm_state bitfield.
@@ -183,12 +238,18 @@ tk_get_names(task *tk)
  * Sets the GtkLabel text to tk->iname if iconified, otherwise tk->name.
  * (No-op if icons_only is set — the label widget does not exist.)
  * Sets the tooltip on the button to tk->name if tooltips is enabled.
+ * A grouped task names its group only while it is the sole visible member.
  */
 void
 tk_set_names(task *tk)
 {
     char *name;
 
+    if (tk->group) {
+        if (tk->shown && tk->group->visible == 1)
+            tk_group_set_names(tk->group);
+        return;
+    }
     name = tk->iconified ? tk->iname : tk->name;
     if (!tk->tb->icons_only)
         gtk_label_set_text(GTK_LABEL(tk->label), name);
@@ -223,8 +284,9 @@ find_task (taskbar_priv * tb, Window win)
  *
  * Sequence:
  *   1. Cancel flash timeout (g_source_remove tk->flash_timeout).
- *   2. Remove GDK filter and unref GdkWindow.
- *   3. gtk_widget_destroy(tk->button) — removes from bar widget tree.
+ *   2. Remove GDK filter and unref GdkWindow; drop the hover preview.
+ *   3. gtk_widget_destroy(tk->button) — removes from bar widget tree, or
+ *      leave the group; unlink from the desktop index; free WM_CLASS.
  *   4. Decrement tb->num_tasks.
  *   5. tk_free_names.
  *   6. Clear tb->focused if it pointed to this task.
@@ -242,7 +304,16 @@ del_task (taskbar_priv * tb, task *tk, int hdel)
                 (GdkFilterFunc)tb_event_filter, tb);
         g_object_unref(tk->gdkwin);
     }
-    gtk_widget_destroy(tk->button);
+    tk_preview_drop(tb, tk);
+    if (tk->group)
+        tk_group_remove(tb, tk);
+    else
+        gtk_widget_destroy(tk->button);
+    tk_index_remove(tb, tk);
+    if (tk->ch.res_name)
+        XFree(tk->ch.res_name);
+    if (tk->ch.res_class)
+        XFree(tk->ch.res_class);
     tb->num_tasks--;
     tk_free_names(tk);
     if (tb->focused == tk)
@@ -293,366 +364,6 @@ task_remove_stale(Window *win, task *tk, gpointer data)
     return FALSE;
 }
 
-/**
- * _wnck_gdk_pixbuf_get_from_pixmap - read an X11 Pixmap into a GdkPixbuf via cairo-xlib.
- * @dest:    Optional destination pixbuf (if non-NULL, the pixels are copied here and
- *           @dest is returned; otherwise a new pixbuf is allocated).
- * @xpixmap: X11 Pixmap handle to read.
- * @src_x, @src_y: Source rectangle origin within @xpixmap.
- * @dest_x, @dest_y: Destination rectangle origin within @dest.
- * @width, @height: Rectangle dimensions.
- *
- * Uses XGetGeometry to determine the pixmap depth, XGetVisualInfo to find a
- * matching Visual, and cairo_xlib_surface_create to wrap the pixmap.
- * Then gdk_pixbuf_get_from_surface extracts RGBA pixels.
- *
- * This replaces the GTK2 GdkColormap/GdkPixmap path which was removed in GTK3.
- *
- * Returns: (transfer full) GdkPixbuf; caller must g_object_unref.
- *          Returns NULL on any failure (XGetGeometry, XGetVisualInfo, cairo error).
- */
-/* GTK3: GdkPixmap/GdkColormap removed; use cairo-xlib to read X11 pixmaps. */
-static GdkPixbuf*
-_wnck_gdk_pixbuf_get_from_pixmap (GdkPixbuf *dest,
-                                  Pixmap     xpixmap,
-                                  int        src_x,
-                                  int        src_y,
-                                  int        dest_x,
-                                  int        dest_y,
-                                  int        width,
-                                  int        height)
-{
-    Window       root_win;
-    int          px, py;
-    unsigned int pw, ph, pbw, pdepth;
-    XVisualInfo  vinfo_tmpl, *vinfo;
-    int          nvisuals;
-    cairo_surface_t *surface;
-    GdkPixbuf   *pixbuf;
-
-    if (!XGetGeometry(GDK_DPY, xpixmap, &root_win,
-                      &px, &py, &pw, &ph, &pbw, &pdepth))
-        return NULL;
-
-    vinfo_tmpl.screen = DefaultScreen(GDK_DPY);
-    vinfo_tmpl.depth  = pdepth;
-    vinfo = XGetVisualInfo(GDK_DPY, VisualScreenMask | VisualDepthMask,
-                           &vinfo_tmpl, &nvisuals);
-    if (!vinfo || !nvisuals)
-    {
-        if (vinfo) XFree(vinfo);
-        return NULL;
-    }
-
-    surface = cairo_xlib_surface_create(GDK_DPY, xpixmap,
-                                        vinfo[0].visual, pw, ph);
-    XFree(vinfo);
-
-    if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS)
-    {
-        cairo_surface_destroy(surface);
-        return NULL;
-    }
-
-    pixbuf = gdk_pixbuf_get_from_surface(surface, src_x, src_y, width, height);
-    cairo_surface_destroy(surface);
-
-    if (pixbuf && dest)
-    {
-        gdk_pixbuf_copy_area(pixbuf, 0, 0, width, height, dest, dest_x, dest_y);
-        g_object_unref(pixbuf);
-        return dest;
-    }
-    return pixbuf;
-}
-
-/**
- * apply_mask - apply a 1-bit pixmap mask to a pixbuf's alpha channel.
- * @pixbuf: Source pixbuf (may not have alpha).
- * @mask:   Mask pixbuf (RGB; pixels with R==0 are transparent, non-zero are opaque).
- *
- * Creates a new RGBA pixbuf from @pixbuf with alpha added, then writes 0 or 255
- * into the alpha channel based on the mask's red channel.
- * Processes the overlapping area (MIN of both dimensions).
- *
- * Returns: (transfer full) new RGBA GdkPixbuf; caller must g_object_unref.
- */
-static GdkPixbuf*
-apply_mask (GdkPixbuf *pixbuf,
-            GdkPixbuf *mask)
-{
-  int w, h;
-  int i, j;
-  GdkPixbuf *with_alpha;
-  guchar *src;
-  guchar *dest;
-  int src_stride;
-  int dest_stride;
-
-  w = MIN (gdk_pixbuf_get_width (mask), gdk_pixbuf_get_width (pixbuf));
-  h = MIN (gdk_pixbuf_get_height (mask), gdk_pixbuf_get_height (pixbuf));
-
-  with_alpha = gdk_pixbuf_add_alpha (pixbuf, FALSE, 0, 0, 0);
-
-  dest = gdk_pixbuf_get_pixels (with_alpha);
-  src = gdk_pixbuf_get_pixels (mask);
-
-  dest_stride = gdk_pixbuf_get_rowstride (with_alpha);
-  src_stride = gdk_pixbuf_get_rowstride (mask);
-
-  i = 0;
-  while (i < h)
-    {
-      j = 0;
-      while (j < w)
-        {
-          guchar *s = src + i * src_stride + j * 3;
-          guchar *d = dest + i * dest_stride + j * 4;
-
-          /* s[0] == s[1] == s[2], they are 255 if the bit was set, 0
-           * otherwise
-           */
-          if (s[0] == 0)
-            d[3] = 0;   /* transparent */
-          else
-            d[3] = 255; /* opaque */
-
-          ++j;
-        }
-
-      ++i;
-    }
-
-  return with_alpha;
-}
-
-
-/**
- * free_pixels - GdkPixbuf pixel data destructor callback.
- * @pixels: The pixel buffer to free (allocated by argbdata_to_pixdata).
- * @data:   Unused.
- *
- * Called by GdkPixbuf when the pixbuf is finalized.
- */
-static void
-free_pixels (guchar *pixels, gpointer data)
-{
-    g_free (pixels);
-    return;
-}
-
-
-/**
- * argbdata_to_pixdata - convert _NET_WM_ICON ARGB data to RGBA byte array.
- * @argb_data: Array of gulong values in ARGB format (as returned by XGetWindowProperty
- *             for XA_CARDINAL).  On 64-bit systems each gulong is 8 bytes but only the
- *             lower 32 bits are used (Xlib pads CARDINAL to sizeof(long)).
- * @len:       Number of gulong values (pixels) to convert.
- *
- * Each ARGB value (0xAARRGGBB) is converted to RGBA bytes [R, G, B, A] by
- * shifting: rgba = (argb << 8) | (argb >> 24), then writing the four bytes.
- *
- * Returns: (transfer full) guchar* RGBA pixel array of length @len * 4;
- *          caller must g_free (via the free_pixels destructor passed to
- *          gdk_pixbuf_new_from_data).
- */
-static guchar *
-argbdata_to_pixdata (gulong *argb_data, int len)
-{
-    guchar *p, *ret;
-    int i;
-
-    ret = p = g_new (guchar, len * 4);
-    if (!ret)
-        return NULL;
-    /* One could speed this up a lot. */
-    i = 0;
-    while (i < len) {
-        guint32 argb;
-        guint32 rgba;
-
-        argb = argb_data[i];
-        rgba = (argb << 8) | (argb >> 24);
-
-        *p = rgba >> 24;
-        ++p;
-        *p = (rgba >> 16) & 0xff;
-        ++p;
-        *p = (rgba >> 8) & 0xff;
-        ++p;
-        *p = rgba & 0xff;
-        ++p;
-
-        ++i;
-    }
-    return ret;
-}
-
-
-
-
-/**
- * get_netwm_icon - load and scale a window's _NET_WM_ICON ARGB icon.
- * @tkwin: X11 client window.
- * @iw:   Desired icon width in pixels.
- * @ih:   Desired icon height in pixels.
- *
- * Reads XA_CARDINAL data from _NET_WM_ICON.  Data format:
- *   data[0] = width, data[1] = height, data[2..] = ARGB pixel values.
- * Validates that dimensions are in range [16, 256].
- * Converts via argbdata_to_pixdata, wraps in a GdkPixbuf (with free_pixels
- * destructor), and scales to iw x ih if necessary.
- *
- * The raw Xlib data is (transfer full) XFree'd internally.
- *
- * Returns: (transfer full) scaled GdkPixbuf; caller must g_object_unref.
- *          NULL on failure (property absent, dimensions out of range, alloc error).
- */
-static GdkPixbuf *
-get_netwm_icon(Window tkwin, int iw, int ih)
-{
-    gulong *data;
-    GdkPixbuf *ret = NULL;
-    int n;
-    guchar *p;
-    GdkPixbuf *src;
-    int w, h;
-
-    data = get_xaproperty(tkwin, a_NET_WM_ICON, XA_CARDINAL, &n);
-    if (!data)
-        return NULL;
-
-    /* loop through all icons in data to find best fit */
-    if (0) {
-        gulong *tmp;
-        int len;
-
-        len = n/sizeof(gulong);
-        tmp = data;
-        while (len > 2) {
-            int size = tmp[0] * tmp[1];
-            DBG("sub-icon: %dx%d %d bytes\n", tmp[0], tmp[1], size * 4);
-            len -= size + 2;
-            tmp += size;
-        }
-    }
-
-    if (0) {
-        int i, j, nn;
-
-        nn = MIN(10, n);
-        p = (guchar *) data;
-        for (i = 0; i < nn; i++) {
-            for (j = 0; j < sizeof(gulong); j++)
-                ERR("%02x ", (guint) p[i*sizeof(gulong) + j]);
-            ERR("\n");
-        }
-    }
-
-    /* check that data indeed represents icon in w + h + ARGB[] format
-     * with 16x16 dimension at least */
-    if (n < (16 * 16 + 1 + 1)) {
-        ERR("win %lx: icon is too small or broken (size=%d)\n", tkwin, n);
-        goto out;
-    }
-    w = data[0];
-    h = data[1];
-    /* check that sizes are in 64-256 range */
-    if (w < 16 || w > 256 || h < 16 || h > 256) {
-        ERR("win %lx: icon size (%d, %d) is not in 64-256 range\n",
-            tkwin, w, h);
-        goto out;
-    }
-
-    DBG("orig  %dx%d dest %dx%d\n", w, h, iw, ih);
-    p = argbdata_to_pixdata(data + 2, w * h);
-    if (!p)
-        goto out;
-    src = gdk_pixbuf_new_from_data (p, GDK_COLORSPACE_RGB, TRUE,
-        8, w, h, w * 4, free_pixels, NULL);
-    if (src == NULL)
-        goto out;
-    ret = src;
-    if (w != iw || h != ih) {
-        ret = gdk_pixbuf_scale_simple(src, iw, ih, GDK_INTERP_HYPER);
-        g_object_unref(src);
-    }
-
-out:
-    XFree(data);
-    return ret;
-}
-
-/**
- * get_wm_icon - load and scale a window's WM_HINTS icon pixmap/mask.
- * @tkwin: X11 client window.
- * @iw:   Desired icon width in pixels.
- * @ih:   Desired icon height in pixels.
- *
- * Reads XGetWMHints for icon_pixmap and icon_mask.
- * Converts the icon_pixmap to a GdkPixbuf via _wnck_gdk_pixbuf_get_from_pixmap
- * (cairo-xlib path).  If a mask pixmap is present, applies it via apply_mask()
- * to create RGBA transparency.  Scales the result to iw x ih.
- *
- * All intermediate pixbufs are g_object_unref'd; the XWMHints struct is XFree'd.
- *
- * Returns: (transfer full) scaled RGBA GdkPixbuf; caller must g_object_unref.
- *          NULL if WM_HINTS is absent, icon_pixmap is None, or any conversion fails.
- */
-static GdkPixbuf *
-get_wm_icon(Window tkwin, int iw, int ih)
-{
-    XWMHints *hints;
-    Pixmap xpixmap = None, xmask = None;
-    Window win;
-    unsigned int w, h;
-    int sd;
-    GdkPixbuf *ret, *masked, *pixmap, *mask = NULL;
-
-    hints = XGetWMHints(GDK_DPY, tkwin);
-    DBG("\nwm_hints %s\n", hints ? "ok" : "failed");
-    if (!hints)
-        return NULL;
-
-    if ((hints->flags & IconPixmapHint))
-        xpixmap = hints->icon_pixmap;
-    if ((hints->flags & IconMaskHint))
-        xmask = hints->icon_mask;
-    DBG("flag=%ld xpixmap=%lx flag=%ld xmask=%lx\n",
-        (hints->flags & IconPixmapHint), xpixmap,
-        (hints->flags & IconMaskHint),  xmask);
-    XFree(hints);
-    if (xpixmap == None)
-        return NULL;
-
-    if (!XGetGeometry (GDK_DPY, xpixmap, &win, &sd, &sd, &w, &h,
-              (guint *)&sd, (guint *)&sd)) {
-        DBG("XGetGeometry failed for %x pixmap\n", (unsigned int)xpixmap);
-        return NULL;
-    }
-    DBG("tkwin=%x icon pixmap w=%d h=%d\n", tkwin, w, h);
-    pixmap = _wnck_gdk_pixbuf_get_from_pixmap (NULL, xpixmap, 0, 0, 0, 0, w, h);
-    if (!pixmap)
-        return NULL;
-    if (xmask != None && XGetGeometry (GDK_DPY, xmask,
-              &win, &sd, &sd, &w, &h, (guint *)&sd, (guint *)&sd)) {
-        mask = _wnck_gdk_pixbuf_get_from_pixmap (NULL, xmask, 0, 0, 0, 0, w, h);
-
-        if (mask) {
-            masked = apply_mask (pixmap, mask);
-            g_object_unref (G_OBJECT (pixmap));
-            g_object_unref (G_OBJECT (mask));
-            pixmap = masked;
-        }
-    }
-    if (!pixmap)
-        return NULL;
-    ret = gdk_pixbuf_scale_simple (pixmap, iw, ih, GDK_INTERP_TILES);
-    g_object_unref(pixmap);
-
-    return ret;
-}
-
 /**
  * get_generic_icon - return a ref to the taskbar's generic fallback icon.
  * @tb: Taskbar instance (owns gen_pixbuf).
@@ -673,28 +384,22 @@ get_generic_icon(taskbar_priv *tb)
  * tk_update_icon - load the best available icon for a task.
  * @tb: Taskbar instance.
  * @tk: Task whose icon is updated.
- * @a:  Atom hint: a_NET_WM_ICON or None -> try _NET_WM_ICON first;
- *      XA_WM_HINTS -> skip directly to WM_HINTS (used when only WM_HINTS changed).
  *
- * Tries icon sources in priority order (see file-level docblock).
+ * Takes the icon from the shared window icon cache (see file-level
+ * docblock), falling back to the generic icon.  Cheap when the cache entry
+ * is still valid, so callers need not know which property changed.
  * If tk->pixbuf changes, the old ref is g_object_unref'd.
  */
 void
-tk_update_icon (taskbar_priv *tb, task *tk, Atom a)
+tk_update_icon (taskbar_priv *tb, task *tk)
 {
     GdkPixbuf *pixbuf;
+    gboolean netwm = FALSE;
 
     DBG("%lx: ", tk->win);
     pixbuf = tk->pixbuf;
-    if (a == a_NET_WM_ICON || a == None) {
-        tk->pixbuf = get_netwm_icon(tk->win, tb->iconsize, tb->iconsize);
-        tk->using_netwm_icon = (tk->pixbuf != NULL);
-        DBGE("netwm_icon=%d ", tk->using_netwm_icon);
-    }
-    if (!tk->using_netwm_icon) {
-        tk->pixbuf = get_wm_icon(tk->win, tb->iconsize, tb->iconsize);
-        DBGE("wm_icon=%d ", (tk->pixbuf != NULL));
-    }
+    tk->pixbuf = get_window_icon(tk->win, tb->iconsize, tb->iconsize, &netwm);
+    DBGE("netwm_icon=%d wm_icon=%d ", netwm, (tk->pixbuf != NULL && !netwm));
     if (!tk->pixbuf) {
         tk->pixbuf = get_generic_icon(tb); // always exists
         DBGE("generic_icon=1");
@@ -710,7 +415,7 @@ tk_update_icon (taskbar_priv *tb, task *tk, Atom a)
 
 /**
  * on_flash_win - toggle button state for urgency flash animation.
- * @tk: Task to flash.
+ * @tk: Task to flash; a grouped task flashes its group's button.
  *
  * Called by g_timeout_add at the GTK cursor blink interval.
  * Toggles between GTK_STATE_FLAG_SELECTED and tb->normal_state.
@@ -721,9 +426,9 @@ static gboolean
 on_flash_win( task *tk )
 {
     tk->flash_state = !tk->flash_state;
-    gtk_widget_set_state_flags(tk->button,
+    gtk_widget_set_state_flags(TK_BUTTON(tk),
           tk->flash_state ? GTK_STATE_FLAG_SELECTED : tk->tb->normal_state, TRUE);
-    gtk_widget_queue_draw(tk->button);
+    gtk_widget_queue_draw(TK_BUTTON(tk));
     return TRUE;
 }
 
@@ -743,7 +448,7 @@ tk_flash_window( task *tk )
     tk->flash_state = !tk->flash_state;
     if (tk->flash_timeout)
         return;
-    g_object_get( gtk_widget_get_settings(tk->button),
+    g_object_get( gtk_widget_get_settings(TK_BUTTON(tk)),
           "gtk-cursor-blink-time", &interval, NULL );
     tk->flash_timeout = g_timeout_add(interval, (GSourceFunc)on_flash_win, tk);
 }
@@ -753,7 +458,7 @@ tk_flash_window( task *tk )
  * @tk: Task to stop flashing.
  *
  * Removes the flash timeout (g_source_remove) and resets flash/flash_state to 0.
- * The button state is NOT reset here — tb_display() will update it on the next redraw.
+ * The button state is NOT reset here; callers follow up with tk_display().
  */
 void
 tk_unflash_window( task *tk )
@@ -21,13 +21,27 @@
  *
  * The button is packed into tb->bar (GtkBar) via gtk_box_pack_start.
  *
+ * GROUP BUTTONS (groupbyclass)
+ * ----------------------------
+ * Grouped tasks have no button; tk_group_new() builds the same hierarchy
+ * once per WM_CLASS, drawn by tk_group_button_draw (tk_button_draw plus a
+ * count badge when several members are visible).  With a single visible
+ * member the group button behaves like that task's button; otherwise LMB
+ * and RMB pop up a menu of the members (tb->gmenu).  Group buttons are not
+ * drag targets.  The widget count thus follows applications, not windows.
+ *
  * CAIRO CUSTOM RENDERING
  * ----------------------
  * tk_button_draw() connects to the "draw" signal and returns TRUE to suppress
- * GTK3's default button drawing.  It renders a gradient-filled rounded rectangle
+ * GTK3's default button drawing.  It paints a gradient-filled rounded rectangle
  * (radius 3px) with a thin border, then calls gtk_container_propagate_draw on
  * the button's child widget so the icon and label are still drawn.
  *
+ * The background only depends on the state and the size, so tk_button_bg()
+ * renders it once per (state, width, height) into an image surface kept in
+ * tb->bg_cache, and every expose is a single blit.  The cache is flushed when
+ * the theme changes (style-updated on tb->bar) or when it fills up.
+ *
  * Three gradient stops:
  *   GTK_STATE_FLAG_ACTIVE (focused):  dark gray gradient (0.44 -> 0.35)
  *   GTK_STATE_FLAG_PRELIGHT (hover):  light gray gradient (0.75 -> 0.60)
@@ -47,6 +61,24 @@
  *   The discard_release_event flag prevents the release after Ctrl+RMB from
  *   accidentally triggering the task menu.
  *
+ * HOVER PREVIEWS (showpreviews)
+ * -----------------------------
+ * Hovering a task button for PREVIEW_DELAY ms pops up tb->pwin with a
+ * scaled capture of the window (winthumb_capture, panel/winthumb.c) over
+ * its title.  Captures never run in the hover handlers: entering a button
+ * only schedules tk_preview_tick(), which captures the hovered window at
+ * most once per PREVIEW_INTERVAL ms.  The capture itself is synchronous:
+ * its X round trips (frame lookup, geometry, XRender composite and the
+ * readback of up to previewsize^2 pixels) block the main loop while they
+ * run.  A worker thread would need its own Display and X error handling
+ * apart from GDK's process-wide handler, so the cost is bounded instead,
+ * by the rate limit, the previewsize clamp and the XDamage-driven cache.
+ * Each capture is cached on the task
+ * and its frame watched with XDamage; DamageNotify only marks the preview
+ * stale, and only the hovered one is recaptured.  Cached previews form an
+ * LRU list (tb->previews) whose pixel memory is capped at previewcache
+ * KiB; evicted tasks also lose their damage object.
+ *
  * DRAG-OVER ACTIVATION
  * --------------------
  * When a drag enters a task button, a DRAG_ACTIVE_DELAY ms timeout is started
@@ -65,37 +97,51 @@
 #include <math.h>
 #include "taskbar_priv.h"
 
+/** Cached backgrounds before the cache is flushed: 3 states x a few sizes. */
+#define TK_BG_CACHE_MAX  12
+
 /**
- * tk_button_draw - cairo custom rendering for a task button.
- * @widget:    The GtkButton being drawn.
- * @cr:        Cairo context for the current draw cycle.
- * @user_data: Unused.
+ * tk_button_bg - rendered background of a task button.
+ * @tb:    Taskbar instance (owns tb->bg_cache).
+ * @state: Button state flags; only ACTIVE and PRELIGHT matter.
+ * @w:     Button width.
+ * @h:     Button height.
  *
- * Draws a gradient-filled rounded rectangle with a 1px border.  Uses the
- * widget's current GTK state flags to choose the gradient colours.  After
- * filling, propagates the draw to the child widget (icon + label box).
+ * Renders a gradient-filled rounded rectangle with a 1px border into an
+ * ARGB32 image surface on first use of a (state, size) and keeps it in
+ * tb->bg_cache.  All buttons of a bar share a size, so a handful of entries
+ * cover it; when the sizes drift (tasks added, panel resized) the cache is
+ * simply flushed once it holds TK_BG_CACHE_MAX entries.
  *
- * Returns TRUE to suppress GTK's default button rendering.
+ * Returns: (transfer none) surface owned by the cache.
  */
-static gboolean
-tk_button_draw(GtkWidget *widget, cairo_t *cr, gpointer user_data)
+static cairo_surface_t *
+tk_button_bg(taskbar_priv *tb, GtkStateFlags state, int w, int h)
 {
-    GtkStateFlags state;
-    int w, h;
-    double r1, r2, r3;
+    cairo_surface_t *s;
     cairo_pattern_t *pat;
-    GtkWidget *child;
-
-    w = gtk_widget_get_allocated_width(widget);
-    h = gtk_widget_get_allocated_height(widget);
-    state = gtk_widget_get_state_flags(widget);
-
+    cairo_t *cr;
+    gpointer key;
+    guint variant;
+    double r1, r2;
+
+    variant = (state & GTK_STATE_FLAG_ACTIVE) ? 2
+        : (state & GTK_STATE_FLAG_PRELIGHT) ? 1 : 0;
+    key = GUINT_TO_POINTER((variant << 28) | ((w & 0x3fff) << 14)
+        | (h & 0x3fff));
+    if ((s = g_hash_table_lookup(tb->bg_cache, key)))
+        return s;
+    if (g_hash_table_size(tb->bg_cache) >= TK_BG_CACHE_MAX)
+        g_hash_table_remove_all(tb->bg_cache);
+
+    s = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, w, h);
+    cr = cairo_create(s);
     pat = cairo_pattern_create_linear(0, 0, 0, h);
-    if (state & GTK_STATE_FLAG_ACTIVE) {
+    if (variant == 2) {
         /* focused window: darker pressed look */
         cairo_pattern_add_color_stop_rgb(pat, 0, 0.44, 0.44, 0.44);
         cairo_pattern_add_color_stop_rgb(pat, 1, 0.35, 0.35, 0.35);
-    } else if (state & GTK_STATE_FLAG_PRELIGHT) {
+    } else if (variant == 1) {
         /* hover: slightly lighter */
         cairo_pattern_add_color_stop_rgb(pat, 0, 0.75, 0.75, 0.75);
         cairo_pattern_add_color_stop_rgb(pat, 1, 0.60, 0.60, 0.60);
@@ -122,6 +168,50 @@ tk_button_draw(GtkWidget *widget, cairo_t *cr, gpointer user_data)
     cairo_set_source_rgb(cr, r2, r2, r2);
     cairo_set_line_width(cr, 1.0);
     cairo_stroke(cr);
+    cairo_destroy(cr);
+
+    g_hash_table_insert(tb->bg_cache, key, s);
+    return s;
+}
+
+/**
+ * tk_bg_style_updated - drop the cached button backgrounds on theme change.
+ * @widget: tb->bar.
+ * @tb:     Taskbar instance.
+ */
+static void
+tk_bg_style_updated(GtkWidget *widget, taskbar_priv *tb)
+{
+    g_hash_table_remove_all(tb->bg_cache);
+    return;
+}
+
+/**
+ * tk_button_draw - cairo custom rendering for a task button.
+ * @widget: The GtkButton being drawn.
+ * @cr:     Cairo context for the current draw cycle.
+ * @tb:     Taskbar instance.
+ *
+ * Paints the cached background for the widget's current GTK state flags
+ * and size (tk_button_bg), then propagates the draw to the child widget
+ * (icon + label box).
+ *
+ * Returns TRUE to suppress GTK's default button rendering.
+ */
+static gboolean
+tk_button_draw(GtkWidget *widget, cairo_t *cr, taskbar_priv *tb)
+{
+    int w, h;
+    double r3;
+    GtkWidget *child;
+
+    w = gtk_widget_get_allocated_width(widget);
+    h = gtk_widget_get_allocated_height(widget);
+    if (w > 0 && h > 0) {
+        cairo_set_source_surface(cr,
+            tk_button_bg(tb, gtk_widget_get_state_flags(widget), w, h), 0, 0);
+        cairo_paint(cr);
+    }
 
     /* Label text colour: dark on light-gray background */
     r3 = 0.07;
@@ -135,6 +225,351 @@ tk_button_draw(GtkWidget *widget, cairo_t *cr, gpointer user_data)
     return TRUE; /* suppress GTK's default button rendering */
 }
 
+/** Hover time in ms before the preview pops up. */
+#define PREVIEW_DELAY     500
+
+/** Minimum ms between two captures of the hovered window (damage rate limit). */
+#define PREVIEW_INTERVAL  250
+
+/** Gap in pixels between the panel and the preview popup. */
+#define PREVIEW_PAD       4
+
+/**
+ * tk_preview_drop - forget a task's preview and stop watching its window.
+ * @tb: Taskbar instance.
+ * @tk: Task; may have no preview.
+ *
+ * Frees the surface (taking it off tb->previews and tb->preview_bytes),
+ * destroys the damage object and releases the frame.  Called on LRU
+ * eviction, ReparentNotify (the frame changed) and from del_task(); also
+ * hides the popup if it shows @tk.
+ */
+void
+tk_preview_drop(taskbar_priv *tb, task *tk)
+{
+    if (tk->preview) {
+        tb->preview_bytes -= cairo_image_surface_get_stride(tk->preview)
+            * cairo_image_surface_get_height(tk->preview);
+        cairo_surface_destroy(tk->preview);
+        tk->preview = NULL;
+        g_queue_unlink(&tb->previews, &tk->preview_link);
+    }
+    winthumb_unwatch(tk->damage);
+    tk->damage = 0;
+    if (tk->gdkframe) {
+        gdk_window_remove_filter(tk->gdkframe,
+                (GdkFilterFunc)tb_event_filter, tb);
+        g_object_unref(tk->gdkframe);
+        tk->gdkframe = NULL;
+    }
+    tk->frame = None;
+    tk->preview_stale = 0;
+    if (tb->preview_tk == tk) {
+        tb->preview_tk = NULL;
+        if (tb->pwin)
+            gtk_widget_hide(tb->pwin);
+    }
+    return;
+}
+
+/**
+ * tk_preview_watch - find the frame of a task's window and watch it.
+ * @tb: Taskbar instance.
+ * @tk: Task without a frame.
+ *
+ * Walks up with XQueryTree() (errors trapped: the window may be gone) to
+ * the child of the root window, which is what
+ * the compositor redirects (the WM frame, or the window itself).  A frame
+ * other than tk->win gets tb_event_filter through its own GdkWindow so that
+ * its DamageNotify events reach tk_preview_damaged().
+ *
+ * Returns: TRUE if tk->frame is set.
+ */
+static gboolean
+tk_preview_watch(taskbar_priv *tb, task *tk)
+{
+    GdkDisplay *display = gdk_display_get_default();
+    Window root, parent, *children, w;
+    unsigned int n;
+    int ok;
+
+    gdk_x11_display_error_trap_push(display);
+    for (w = tk->win; ; w = parent) {
+        if (!(ok = XQueryTree(GDK_DPY, w, &root, &parent, &children, &n)))
+            break;
+        if (children)
+            XFree(children);
+        if (parent == root || parent == None)
+            break;
+    }
+    if (gdk_x11_display_error_trap_pop(display) || !ok)
+        return FALSE;
+    tk->frame = w;
+    if (w != tk->win) {
+        tk->gdkframe = gdk_x11_window_foreign_new_for_display(
+                gdk_display_get_default(), w);
+        if (tk->gdkframe)
+            gdk_window_add_filter(tk->gdkframe,
+                    (GdkFilterFunc)tb_event_filter, tb);
+    }
+    tk->damage = winthumb_watch(w);
+    DBG("win=0x%lx frame=0x%lx damage=%lu\n", tk->win, w, tk->damage);
+    return TRUE;
+}
+
+/**
+ * tk_preview_capture - capture a task's frame into its cached preview.
+ * @tb: Taskbar instance.
+ * @tk: Task.
+ *
+ * Scales the frame to fit a preview_size square, keeping its aspect, and
+ * puts the task at the head of the LRU list; older previews are dropped
+ * until the cache fits in preview_cache KiB again.  The previous preview
+ * is kept if the window cannot be captured (iconified, other desktop).
+ *
+ * Returns: TRUE if a new preview was captured.
+ */
+static gboolean
+tk_preview_capture(taskbar_priv *tb, task *tk)
+{
+    GdkDisplay *display = gdk_display_get_default();
+    cairo_surface_t *s;
+    Window root;
+    int x, y, ok;
+    unsigned int fw, fh, bw, depth, w, h;
+    gsize cap;
+
+    tk->preview_stale = 0;
+    if (tk->frame == None && !tk_preview_watch(tb, tk))
+        return FALSE;
+    gdk_x11_display_error_trap_push(display);
+    ok = XGetGeometry(GDK_DPY, tk->frame, &root, &x, &y, &fw, &fh, &bw, &depth);
+    if (gdk_x11_display_error_trap_pop(display) || !ok || !fw || !fh)
+        return FALSE;
+    fw += 2 * bw;
+    fh += 2 * bw;
+    if (fw >= fh) {
+        w = MIN(fw, (unsigned) tb->preview_size);
+        h = MAX(1, fh * w / fw);
+    } else {
+        h = MIN(fh, (unsigned) tb->preview_size);
+        w = MAX(1, fw * h / fh);
+    }
+    if (!(s = winthumb_capture(tk->frame, w, h)))
+        return FALSE;
+
+    if (tk->preview) {
+        tb->preview_bytes -= cairo_image_surface_get_stride(tk->preview)
+            * cairo_image_surface_get_height(tk->preview);
+        cairo_surface_destroy(tk->preview);
+        g_queue_unlink(&tb->previews, &tk->preview_link);
+    }
+    tk->preview = s;
+    tb->preview_bytes += cairo_image_surface_get_stride(s) * h;
+    tk->preview_link.data = tk;
+    g_queue_push_head_link(&tb->previews, &tk->preview_link);
+
+    cap = (gsize) tb->preview_cache * 1024;
+    while (tb->preview_bytes > cap && tb->previews.length > 1)
+        tk_preview_drop(tb, tb->previews.tail->data);
+    DBG("win=0x%lx %ux%u, %d cached, %lu bytes\n", tk->win, w, h,
+        tb->previews.length, (unsigned long) tb->preview_bytes);
+    return TRUE;
+}
+
+/**
+ * tk_preview_show - fill the popup for the hovered task and place it.
+ * @tb: Taskbar instance; tb->preview_tk is the task.
+ *
+ * The popup (created on first use) holds the preview, if any, above the
+ * window title, and is placed beside the task button on the panel's inner
+ * side, pushed onto the primary monitor.
+ */
+static void
+tk_preview_show(taskbar_priv *tb)
+{
+    task *tk = tb->preview_tk;
+    GtkWidget *box;
+    GtkAllocation a;
+    GtkRequisition req;
+    GdkRectangle geom;
+    int x, y;
+
+    if (!tb->pwin) {
+        tb->pwin = gtk_window_new(GTK_WINDOW_POPUP);
+        gtk_window_set_resizable(GTK_WINDOW(tb->pwin), FALSE);
+        gtk_widget_set_name(tb->pwin, "gtk-tooltips");
+        gtk_container_set_border_width(GTK_CONTAINER(tb->pwin), 4);
+        box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 4);
+        tb->pimage = gtk_image_new();
+        gtk_box_pack_start(GTK_BOX(box), tb->pimage, FALSE, FALSE, 0);
+        tb->plabel = gtk_label_new(NULL);
+        gtk_label_set_ellipsize(GTK_LABEL(tb->plabel), PANGO_ELLIPSIZE_END);
+        gtk_label_set_max_width_chars(GTK_LABEL(tb->plabel), 40);
+        gtk_box_pack_start(GTK_BOX(box), tb->plabel, FALSE, FALSE, 0);
+        gtk_widget_show_all(box);
+        gtk_container_add(GTK_CONTAINER(tb->pwin), box);
+    }
+    if (tk->preview) {
+        gtk_image_set_from_surface(GTK_IMAGE(tb->pimage), tk->preview);
+        gtk_widget_show(tb->pimage);
+    } else {
+        gtk_widget_hide(tb->pimage);
+    }
+    gtk_label_set_text(GTK_LABEL(tb->plabel), tk->name);
+    gtk_widget_get_preferred_size(tb->pwin, NULL, &req);
+
+    gdk_window_get_origin(gtk_widget_get_window(tk->button), &x, &y);
+    gtk_widget_get_allocation(tk->button, &a);
+    x += a.x;
+    y += a.y;
+    switch (tb->plugin.panel->edge) {
+    case EDGE_TOP:
+        x += (a.width - req.width) / 2;
+        y += a.height + PREVIEW_PAD;
+        break;
+    case EDGE_LEFT:
+        x += a.width + PREVIEW_PAD;
+        y += (a.height - req.height) / 2;
+        break;
+    case EDGE_RIGHT:
+        x -= req.width + PREVIEW_PAD;
+        y += (a.height - req.height) / 2;
+        break;
+    default:
+        x += (a.width - req.width) / 2;
+        y -= req.height + PREVIEW_PAD;
+        break;
+    }
+    gdk_monitor_get_geometry(gdk_display_get_primary_monitor(
+        gdk_display_get_default()), &geom);
+    x = CLAMP(x, geom.x, MAX(geom.x, geom.x + geom.width - req.width));
+    y = CLAMP(y, geom.y, MAX(geom.y, geom.y + geom.height - req.height));
+    gtk_window_move(GTK_WINDOW(tb->pwin), x, y);
+    gtk_widget_show(tb->pwin);
+    return;
+}
+
+/**
+ * tk_preview_tick - timeout callback; captures the hovered window.
+ * @tb: Taskbar instance.
+ *
+ * Captures run here, never in the hover handlers, so entering a button
+ * costs nothing; a window that keeps repainting is recaptured at most
+ * every PREVIEW_INTERVAL ms while it is hovered.  The capture blocks the
+ * main loop for its X round trips; deferring it only keeps that cost out
+ * of the hover path.  Refreshes the popup if it is up.
+ *
+ * Returns: FALSE (one-shot; tk_preview_schedule() starts it again).
+ */
+static gboolean
+tk_preview_tick(taskbar_priv *tb)
+{
+    task *tk = tb->preview_tk;
+
+    tb->preview_timer = 0;
+    if (!tk || (tk->preview && !tk->preview_stale) || !winthumb_available())
+        return FALSE;
+    if (tk_preview_capture(tb, tk) && tb->pwin
+            && gtk_widget_get_visible(tb->pwin))
+        tk_preview_show(tb);
+    return FALSE;
+}
+
+/**
+ * tk_preview_schedule - start the capture timer for the hovered task.
+ * @tb: Taskbar instance.
+ */
+static void
+tk_preview_schedule(taskbar_priv *tb)
+{
+    if (!tb->preview_timer)
+        tb->preview_timer = g_timeout_add(PREVIEW_INTERVAL,
+            (GSourceFunc) tk_preview_tick, tb);
+    return;
+}
+
+/**
+ * tk_preview_damaged - handle DamageNotify for a previewed window.
+ * @tb:  Taskbar instance.
+ * @win: Damaged frame.
+ *
+ * Only cached previews are watched, so the LRU list is short to search.
+ * The preview is marked stale; only the hovered one is recaptured now.
+ */
+void
+tk_preview_damaged(taskbar_priv *tb, Window win)
+{
+    GList *l;
+    task *tk;
+
+    for (l = tb->previews.head; l; l = l->next) {
+        tk = l->data;
+        if (tk->frame != win)
+            continue;
+        tk->preview_stale = 1;
+        if (tk == tb->preview_tk)
+            tk_preview_schedule(tb);
+        return;
+    }
+    return;
+}
+
+/**
+ * tk_preview_popup - hover delay elapsed; show the popup.
+ * @tb: Taskbar instance.
+ *
+ * Returns: FALSE (one-shot).
+ */
+static gboolean
+tk_preview_popup(taskbar_priv *tb)
+{
+    tb->preview_delay = 0;
+    if (tb->preview_tk)
+        tk_preview_show(tb);
+    return FALSE;
+}
+
+/**
+ * tk_preview_enter - the pointer entered a task button.
+ * @tb: Taskbar instance.
+ * @tk: Task.
+ *
+ * Starts the hover delay and, if the cached preview is missing or stale,
+ * the capture, so that it is usually ready when the popup appears.
+ * Windows of the panel itself (no gdkwin) are never captured.
+ */
+static void
+tk_preview_enter(taskbar_priv *tb, task *tk)
+{
+    tb->preview_tk = tk;
+    if (tk->gdkwin && (!tk->preview || tk->preview_stale))
+        tk_preview_schedule(tb);
+    if (!tb->preview_delay)
+        tb->preview_delay = g_timeout_add(PREVIEW_DELAY,
+            (GSourceFunc) tk_preview_popup, tb);
+    return;
+}
+
+/**
+ * tk_preview_leave - the pointer left a task button, or it was clicked.
+ * @tb: Taskbar instance.
+ *
+ * Hides the popup and cancels the hover delay; the preview stays cached.
+ */
+static void
+tk_preview_leave(taskbar_priv *tb)
+{
+    tb->preview_tk = NULL;
+    if (tb->preview_delay) {
+        g_source_remove(tb->preview_delay);
+        tb->preview_delay = 0;
+    }
+    if (tb->pwin)
+        gtk_widget_hide(tb->pwin);
+    return;
+}
+
 /**
  * tk_callback_leave - restore button state on mouse leave.
  * @widget: The task button.
@@ -142,12 +577,15 @@ tk_button_draw(GtkWidget *widget, cairo_t *cr, gpointer user_data)
  *
  * Sets the button state to focused_state if the window is focused, or
  * normal_state otherwise (hover state is implicitly cleared by GTK on leave).
+ * Hides the preview popup.
  */
 static void
 tk_callback_leave( GtkWidget *widget, task *tk)
 {
     gtk_widget_set_state_flags(widget,
           (tk->focused) ? tk->tb->focused_state : tk->tb->normal_state, TRUE);
+    if (tk->tb->show_previews)
+        tk_preview_leave(tk->tb);
     return;
 }
 
@@ -160,12 +598,15 @@ tk_callback_leave( GtkWidget *widget, task *tk)
  * Restores the correct (focused or normal) state on enter.  The prelight
  * gradient is applied by the cairo draw handler based on GTK state flags;
  * this callback ensures the focused/unfocused distinction is preserved.
+ * With showpreviews, starts the preview hover delay.
  */
 static void
 tk_callback_enter( GtkWidget *widget, task *tk )
 {
     gtk_widget_set_state_flags(widget,
           (tk->focused) ? tk->tb->focused_state : tk->tb->normal_state, TRUE);
+    if (tk->tb->show_previews)
+        tk_preview_enter(tk->tb, tk);
     return;
 }
 
@@ -283,12 +724,14 @@ tk_callback_scroll_event (GtkWidget *widget, GdkEventScroll *event, task *tk)
  * the task menu.  Returns TRUE to stop further propagation.
  *
  * All other press events: return FALSE (let GTK handle them normally; the
- * actual action is in the release handler).
+ * actual action is in the release handler).  Any press hides the preview.
  */
 static gboolean
 tk_callback_button_press_event(GtkWidget *widget, GdkEventButton *event,
     task *tk)
 {
+    if (tk->tb->show_previews)
+        tk_preview_leave(tk->tb);
     if (event->type == GDK_BUTTON_PRESS && event->button == 3
           && event->state & GDK_CONTROL_MASK) {
         tk->tb->discard_release_event = 1;
@@ -384,33 +827,488 @@ tk_callback_button_release_event(GtkWidget *widget, GdkEventButton *event,
 }
 
 
+/** State flags tk_update() manages; the rest belong to GTK (hover, direction). */
+#define TK_STATE_MASK  (GTK_STATE_FLAG_ACTIVE | GTK_STATE_FLAG_SELECTED)
+
+/**
+ * tk_group_first_shown - the first member of a group that is shown.
+ * @g: Group.
+ *
+ * Returns: (transfer none) task, or NULL if no member is shown.
+ */
+static task *
+tk_group_first_shown(tk_group *g)
+{
+    GList *l;
+
+    for (l = g->tasks.head; l; l = l->next)
+        if (((task *) l->data)->shown)
+            return l->data;
+    return NULL;
+}
+
+/**
+ * tk_group_state - button state for a group.
+ * @g: Group.
+ *
+ * Returns: focused_state if the focused task is a shown member of @g,
+ *          normal_state otherwise.
+ */
+static GtkStateFlags
+tk_group_state(tk_group *g)
+{
+    task *f = g->tb->focused;
+
+    return (f && f->group == g && f->shown) ?
+        g->tb->focused_state : g->tb->normal_state;
+}
+
+/**
+ * tk_group_set_names - label and tooltip of a group button.
+ * @g: Group.
+ *
+ * With one visible member the button carries that member's title, as an
+ * ungrouped button would; otherwise the class name (the count is drawn as
+ * a badge by tk_group_button_draw).
+ */
+void
+tk_group_set_names(tk_group *g)
+{
+    task *tk = NULL;
+    char *tip;
+
+    if (g->visible == 1)
+        tk = tk_group_first_shown(g);
+    if (g->label)
+        gtk_label_set_text(GTK_LABEL(g->label),
+            tk ? (tk->iconified ? tk->iname : tk->name) : g->key);
+    if (g->tb->tooltips) {
+        if (tk) {
+            gtk_widget_set_tooltip_text(g->button, tk->name);
+        } else {
+            tip = g_strdup_printf("%s (%d)", g->key, g->visible);
+            gtk_widget_set_tooltip_text(g->button, tip);
+            g_free(tip);
+        }
+    }
+    return;
+}
+
+/**
+ * tk_group_update - apply a group's visibility and state to its button.
+ * @g: Group.
+ *
+ * Same delta rules as tk_update(): the button is only shown, hidden or
+ * restyled when that changes something.
+ */
+static void
+tk_group_update(tk_group *g)
+{
+    GtkStateFlags state;
+
+    if (!g->visible) {
+        if (gtk_widget_get_visible(g->button))
+            gtk_widget_hide(g->button);
+        return;
+    }
+    state = tk_group_state(g);
+    if ((gtk_widget_get_state_flags(g->button) & TK_STATE_MASK)
+            != (state & TK_STATE_MASK)) {
+        gtk_widget_set_state_flags(g->button, state, TRUE);
+        gtk_widget_queue_draw(g->button);
+    }
+    if (!gtk_widget_get_visible(g->button))
+        gtk_widget_show(g->button);
+    return;
+}
+
+/**
+ * tk_group_update_task - tk_update() for a grouped task.
+ * @tb: Taskbar instance.
+ * @tk: Grouped task.
+ *
+ * Records the task's visibility in tk->shown and the group's count, then
+ * updates the group button.  Names and badge change only with the count.
+ */
+static void
+tk_group_update_task(taskbar_priv *tb, task *tk)
+{
+    tk_group *g = tk->group;
+    int vis;
+
+    vis = task_visible(tb, tk) ? 1 : 0;
+    if (vis != tk->shown) {
+        tk->shown = vis;
+        g->visible += vis ? 1 : -1;
+        tk_group_set_names(g);
+        gtk_widget_queue_draw(g->button);
+    }
+    tk_group_update(g);
+    return;
+}
+
+/**
+ * tk_group_button_draw - task button rendering plus the member count badge.
+ * @widget: The group's GtkButton.
+ * @cr:     Cairo context for the current draw cycle.
+ * @g:      Group.
+ *
+ * Draws the badge (a small pill with the visible count, top right) only
+ * when more than one member is visible.
+ *
+ * Returns TRUE to suppress GTK's default button rendering.
+ */
+static gboolean
+tk_group_button_draw(GtkWidget *widget, cairo_t *cr, tk_group *g)
+{
+    PangoLayout *layout;
+    char *buf;
+    int w, tw, th, bw;
+    double x, r;
+
+    tk_button_draw(widget, cr, g->tb);
+    if (g->visible < 2)
+        return TRUE;
+
+    buf = g_strdup_printf("<small>%d</small>", g->visible);
+    layout = gtk_widget_create_pango_layout(widget, NULL);
+    pango_layout_set_markup(layout, buf, -1);
+    g_free(buf);
+    pango_layout_get_pixel_size(layout, &tw, &th);
+    w = gtk_widget_get_allocated_width(widget);
+    bw = MAX(tw + 4, th);
+    x = w - bw - 1;
+    r = th / 2.0;
+
+    cairo_new_path(cr);
+    cairo_arc(cr, x + r,      1 + r, r,  M_PI / 2.0, 3 * M_PI / 2.0);
+    cairo_arc(cr, x + bw - r, 1 + r, r, -M_PI / 2.0, M_PI / 2.0);
+    cairo_close_path(cr);
+    cairo_set_source_rgb(cr, 0.20, 0.20, 0.20);
+    cairo_fill(cr);
+
+    cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
+    cairo_move_to(cr, x + (bw - tw) / 2.0, 1);
+    pango_cairo_show_layout(cr, layout);
+    g_object_unref(layout);
+    return TRUE;
+}
+
+/**
+ * tk_group_menu_activate - raise the window picked from a group's list.
+ * @widget: Menu item; the window is stored in object data "win".
+ * @tb:     Taskbar instance.
+ *
+ * The task is looked up again, since it may be gone by now.
+ */
+static void
+tk_group_menu_activate(GtkWidget *widget, taskbar_priv *tb)
+{
+    task *tk;
+
+    tk = find_task(tb, (Window) GPOINTER_TO_SIZE(
+        g_object_get_data(G_OBJECT(widget), "win")));
+    if (tk)
+        tk_raise_window(tk, gtk_get_current_event_time());
+    return;
+}
+
+/**
+ * tk_group_popup - pop up the list of a group's visible members.
+ * @g:     Group.
+ * @event: The button event that asked for it.
+ *
+ * One item (icon and title) per shown member; activating it raises that
+ * window.  The menu replaces the previous one in tb->gmenu.
+ */
+static void
+tk_group_popup(tk_group *g, GdkEventButton *event)
+{
+    taskbar_priv *tb = g->tb;
+    GtkWidget *menu, *mi, *box, *w;
+    GList *l;
+    task *tk;
+
+    menu = gtk_menu_new();
+    for (l = g->tasks.head; l; l = l->next) {
+        tk = l->data;
+        if (!tk->shown)
+            continue;
+        mi = gtk_menu_item_new();
+        box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 4);
+        w = gtk_image_new_from_pixbuf(tk->pixbuf);
+        gtk_box_pack_start(GTK_BOX(box), w, FALSE, FALSE, 0);
+        w = gtk_label_new(tk->iconified ? tk->iname : tk->name);
+        gtk_label_set_ellipsize(GTK_LABEL(w), PANGO_ELLIPSIZE_END);
+        gtk_label_set_max_width_chars(GTK_LABEL(w), 40);
+        gtk_widget_set_halign(w, GTK_ALIGN_START);
+        gtk_box_pack_start(GTK_BOX(box), w, TRUE, TRUE, 0);
+        gtk_container_add(GTK_CONTAINER(mi), box);
+        g_object_set_data(G_OBJECT(mi), "win", GSIZE_TO_POINTER(tk->win));
+        g_signal_connect(G_OBJECT(mi), "activate",
+            (GCallback)tk_group_menu_activate, tb);
+        gtk_menu_shell_append(GTK_MENU_SHELL(menu), mi);
+    }
+    gtk_widget_show_all(menu);
+    if (tb->gmenu)
+        gtk_widget_destroy(tb->gmenu);
+    tb->gmenu = menu;
+    gtk_menu_popup_at_pointer(GTK_MENU(menu), (GdkEvent *)event);
+    return;
+}
+
+/**
+ * tk_group_callback_button_press_event - button-press on a group button.
+ * @widget: The group button.
+ * @event:  The button-press event.
+ * @g:      Group.
+ *
+ * Ctrl+RMB goes to the panel, as for task buttons.
+ */
+static gboolean
+tk_group_callback_button_press_event(GtkWidget *widget, GdkEventButton *event,
+    tk_group *g)
+{
+    if (event->type == GDK_BUTTON_PRESS && event->button == 3
+          && event->state & GDK_CONTROL_MASK) {
+        g->tb->discard_release_event = 1;
+        gtk_propagate_event(g->tb->bar, (GdkEvent *)event);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * tk_group_callback_button_release_event - button-release on a group button.
+ * @widget: The group button.
+ * @event:  The button-release event.
+ * @g:      Group.
+ *
+ * With one visible member, acts exactly like that task's button.  With
+ * several, LMB and RMB pop up the member list (tk_group_popup).
+ *
+ * Returns: TRUE if the event was handled; FALSE to pass to GTK.
+ */
+static gboolean
+tk_group_callback_button_release_event(GtkWidget *widget,
+    GdkEventButton *event, tk_group *g)
+{
+    GtkAllocation alloc;
+    task *tk;
+
+    if (g->visible == 1 && (tk = tk_group_first_shown(g)))
+        return tk_callback_button_release_event(widget, event, tk);
+    if (event->type == GDK_BUTTON_RELEASE && g->tb->discard_release_event) {
+        g->tb->discard_release_event = 0;
+        return TRUE;
+    }
+    gtk_widget_get_allocation(widget, &alloc);
+    if ((event->type != GDK_BUTTON_RELEASE) ||
+        (event->x < 0 || event->x >= alloc.width ||
+         event->y < 0 || event->y >= alloc.height))
+        return FALSE;
+    if (event->button == 1 || event->button == 3)
+        tk_group_popup(g, event);
+    return TRUE;
+}
+
+/**
+ * tk_group_callback_scroll_event - mouse wheel on a group button.
+ * @widget: The group button.
+ * @event:  The scroll event.
+ * @g:      Group.
+ *
+ * Acts like the task button if one member is visible; ignored otherwise.
+ *
+ * Returns TRUE (event consumed).
+ */
+static gint
+tk_group_callback_scroll_event(GtkWidget *widget, GdkEventScroll *event,
+    tk_group *g)
+{
+    task *tk;
+
+    if (g->visible == 1 && (tk = tk_group_first_shown(g)))
+        return tk_callback_scroll_event(widget, event, tk);
+    return TRUE;
+}
+
+/**
+ * tk_group_callback_enter - restore group button state on enter and leave.
+ * @widget: The group button.
+ * @g:      Group.
+ *
+ * Counterpart of tk_callback_enter / tk_callback_leave.
+ */
+static void
+tk_group_callback_enter(GtkWidget *widget, tk_group *g)
+{
+    gtk_widget_set_state_flags(widget, tk_group_state(g), TRUE);
+    return;
+}
+
+/**
+ * tk_group_new - create a group and its (hidden) button.
+ * @tb:  Taskbar instance.
+ * @key: WM_CLASS key; copied.
+ * @tk:  First member; its icon becomes the group icon.
+ *
+ * Returns: (transfer none) new group, owned by tb->groups.
+ */
+static tk_group *
+tk_group_new(taskbar_priv *tb, const char *key, task *tk)
+{
+    tk_group *g;
+    GtkWidget *w1;
+
+    g = g_new0(tk_group, 1);
+    g->tb = tb;
+    g->key = g_strdup(key);
+    g_queue_init(&g->tasks);
+
+    g->button = gtk_button_new();
+    g_signal_connect(G_OBJECT(g->button), "draw",
+        G_CALLBACK(tk_group_button_draw), g);
+    gtk_container_set_border_width(GTK_CONTAINER(g->button), 0);
+    gtk_widget_add_events(g->button, GDK_BUTTON_RELEASE_MASK
+            | GDK_BUTTON_PRESS_MASK);
+    g_signal_connect(G_OBJECT(g->button), "button_release_event",
+        G_CALLBACK(tk_group_callback_button_release_event), g);
+    g_signal_connect(G_OBJECT(g->button), "button_press_event",
+        G_CALLBACK(tk_group_callback_button_press_event), g);
+    g_signal_connect_after(G_OBJECT(g->button), "leave",
+        G_CALLBACK(tk_group_callback_enter), g);
+    g_signal_connect_after(G_OBJECT(g->button), "enter",
+        G_CALLBACK(tk_group_callback_enter), g);
+    if (tb->use_mouse_wheel)
+        g_signal_connect_after(G_OBJECT(g->button), "scroll-event",
+            G_CALLBACK(tk_group_callback_scroll_event), g);
+
+    w1 = g->image = gtk_image_new_from_pixbuf(tk->pixbuf);
+    gtk_widget_set_halign(g->image, GTK_ALIGN_CENTER);
+    gtk_widget_set_valign(g->image, GTK_ALIGN_CENTER);
+    if (!tb->icons_only) {
+        w1 = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 1);
+        gtk_container_set_border_width(GTK_CONTAINER(w1), 0);
+        gtk_box_pack_start(GTK_BOX(w1), g->image, FALSE, FALSE, 0);
+        g->label = gtk_label_new(g->key);
+        gtk_label_set_ellipsize(GTK_LABEL(g->label), PANGO_ELLIPSIZE_END);
+        gtk_widget_set_halign(g->label, GTK_ALIGN_START);
+        gtk_widget_set_valign(g->label, GTK_ALIGN_CENTER);
+        gtk_box_pack_start(GTK_BOX(w1), g->label, TRUE, TRUE, 0);
+    }
+    gtk_container_add(GTK_CONTAINER(g->button), w1);
+    gtk_box_pack_start(GTK_BOX(tb->bar), g->button, FALSE, TRUE, 0);
+    gtk_widget_set_can_focus(g->button, FALSE);
+    gtk_widget_set_can_default(g->button, FALSE);
+    gtk_widget_show_all(w1);
+
+    g_hash_table_insert(tb->groups, g->key, g);
+    return g;
+}
+
+/**
+ * tk_group_add - file a new task under its WM_CLASS group.
+ * @tb: Taskbar instance.
+ * @tk: Task without a button; its icon must be loaded.
+ *
+ * Reads WM_CLASS into tk->ch and creates the group on first use.
+ */
+static void
+tk_group_add(taskbar_priv *tb, task *tk)
+{
+    tk_group *g;
+    const char *key;
+
+    XGetClassHint(GDK_DPY, tk->win, &tk->ch);
+    key = tk->ch.res_class ? tk->ch.res_class
+        : tk->ch.res_name ? tk->ch.res_name : "";
+    g = g_hash_table_lookup(tb->groups, key);
+    if (!g)
+        g = tk_group_new(tb, key, tk);
+    tk->group = g;
+    tk->group_link.data = tk;
+    g_queue_push_tail_link(&g->tasks, &tk->group_link);
+    tk->shown = 0;
+    tk_group_update_task(tb, tk);
+    return;
+}
+
+/**
+ * tk_group_remove - take a task out of its group.
+ * @tb: Taskbar instance.
+ * @tk: Grouped task.
+ *
+ * Frees the group and destroys its button when it was the last member;
+ * otherwise passes the group icon on if @tk was first, and refreshes.
+ */
+void
+tk_group_remove(taskbar_priv *tb, task *tk)
+{
+    tk_group *g = tk->group;
+    gboolean first;
+
+    if (tk->shown)
+        g->visible--;
+    first = (g->tasks.head == &tk->group_link);
+    g_queue_unlink(&g->tasks, &tk->group_link);
+    tk->group = NULL;
+    if (g_queue_is_empty(&g->tasks)) {
+        g_hash_table_remove(tb->groups, g->key);
+        gtk_widget_destroy(g->button);
+        g_free(g->key);
+        g_free(g);
+        return;
+    }
+    if (first)
+        gtk_image_set_from_pixbuf(GTK_IMAGE(g->image),
+            ((task *) g->tasks.head->data)->pixbuf);
+    tk_group_set_names(g);
+    gtk_widget_queue_draw(g->button);
+    tk_group_update(g);
+    return;
+}
+
 /**
  * tk_update - update visibility and state of a single task button.
  * @key: Hash table key (unused; task is iterated by g_hash_table_foreach).
  * @tk:  Task to update.
  * @tb:  Taskbar instance.
  *
- * If task_visible returns true: set button state (focused or normal),
- * queue a redraw, show the button, and update the tooltip.
- * Otherwise: hide the button.
+ * If task_visible returns true: set button state (focused or normal) and
+ * queue a redraw if the state differs, and show the button if hidden.
+ * Otherwise: hide the button if shown.  Unchanged buttons are not touched,
+ * so callers may refresh liberally.  The tooltip is kept by tk_set_names().
+ * Grouped tasks update their group's button instead.
  */
 static void
 tk_update(gpointer key, task *tk, taskbar_priv *tb)
 {
+    GtkStateFlags state;
+
     g_assert ((tb != NULL) && (tk != NULL));
+    if (tk->group) {
+        tk_group_update_task(tb, tk);
+        return;
+    }
     if (task_visible(tb, tk)) {
-        gtk_widget_set_state_flags(tk->button,
-              (tk->focused) ? tb->focused_state : tb->normal_state, TRUE);
-        gtk_widget_queue_draw(tk->button);
+        state = (tk->focused) ? tb->focused_state : tb->normal_state;
+        if (!tk->shown || (gtk_widget_get_state_flags(tk->button)
+                & TK_STATE_MASK) != (state & TK_STATE_MASK)) {
+            gtk_widget_set_state_flags(tk->button, state, TRUE);
+            gtk_widget_queue_draw(tk->button);
+        }
         //_gtk_button_set_depressed(GTK_BUTTON(tk->button), tk->focused);
-        gtk_widget_show(tk->button);
-
-        if (tb->tooltips) {
-            gtk_widget_set_tooltip_text(tk->button, tk->name);
+        if (!tk->shown) {
+            gtk_widget_show(tk->button);
+            tk->shown = 1;
         }
         return;
     }
-    gtk_widget_hide(tk->button);
+    if (tk->shown) {
+        gtk_widget_hide(tk->button);
+        tk->shown = 0;
+    }
     return;
 }
 
@@ -426,6 +1324,45 @@ tk_display(taskbar_priv *tb, task *tk)
     return;
 }
 
+/**
+ * tk_set_icon - reload a task's icon and show it.
+ * @tb: Taskbar instance.
+ * @tk: Task.
+ *
+ * A grouped task shows its icon only if it is the group's first member.
+ */
+void
+tk_set_icon(taskbar_priv *tb, task *tk)
+{
+    tk_update_icon(tb, tk);
+    if (tk->image)
+        gtk_image_set_from_pixbuf(GTK_IMAGE(tk->image), tk->pixbuf);
+    else if (tk->group && tk->group->tasks.head == &tk->group_link)
+        gtk_image_set_from_pixbuf(GTK_IMAGE(tk->group->image), tk->pixbuf);
+    return;
+}
+
+/**
+ * tb_display_desk - refresh the tasks on one desktop.
+ * @tb:      Taskbar instance.
+ * @desktop: Desktop number (ALL_WORKSPACES for sticky tasks).
+ *
+ * Walks the desktop's queue in the desktop index only.
+ */
+void
+tb_display_desk(taskbar_priv *tb, guint desktop)
+{
+    GQueue *q;
+    GList *l;
+
+    q = g_hash_table_lookup(tb->desk_tasks, GUINT_TO_POINTER(desktop));
+    if (!q)
+        return;
+    for (l = q->head; l; l = l->next)
+        tk_update(NULL, l->data, tb);
+    return;
+}
+
 /**
  * tb_display - refresh the display of all tasks.
  * @tb: Taskbar instance.
@@ -451,11 +1388,13 @@ tb_display(taskbar_priv *tb)
  *    XSelectInput for PropertyChangeMask + StructureNotifyMask, then wraps it
  *    in a GdkWindow (gdk_x11_window_foreign_new_for_display) and installs the
  *    per-window GDK filter (tb_event_filter).
- * 2. Creates the GtkButton and connects all event callbacks.
- * 3. Loads the task icon (tk_update_icon with a=None).
+ * 2. Loads the task icon (tk_update_icon).  In groupbyclass mode, files the
+ *    task under its WM_CLASS group (tk_group_add) instead of steps 3-5.
+ * 3. Creates the GtkButton and connects all event callbacks.
  * 4. In icons_only mode: adds the GtkImage directly to the button.
  *    Otherwise: creates an HBox with GtkImage + GtkLabel (PANGO_ELLIPSIZE_END).
- * 5. Packs the button into tb->bar; hides it if not currently visible.
+ * 5. Packs the button into tb->bar; hides it if not currently visible
+ *    (tk_update, which also records tk->shown).
  * 6. Starts the flash animation if tk->urgency is set.
  */
 void
@@ -485,12 +1424,18 @@ tk_build_gui(taskbar_priv *tb, task *tk)
                     (GdkFilterFunc)tb_event_filter, tb);
     }
 
+    tk_update_icon(tb, tk);
+    if (tb->group_by_class) {
+        tk_group_add(tb, tk);
+        goto flash;
+    }
+
     /* button */
     tk->button = gtk_button_new();
     /* gtk_button_new() has no child in GTK3; halign is set per-widget on
      * tk->image and tk->label below after they are created */
     g_signal_connect(G_OBJECT(tk->button), "draw",
-        G_CALLBACK(tk_button_draw), NULL);
+        G_CALLBACK(tk_button_draw), tb);
     gtk_widget_show(tk->button);
     gtk_container_set_border_width(GTK_CONTAINER(tk->button), 0);
     gtk_widget_add_events (tk->button, GDK_BUTTON_RELEASE_MASK
@@ -513,7 +1458,6 @@ tk_build_gui(taskbar_priv *tb, task *tk)
               G_CALLBACK(tk_callback_scroll_event), (gpointer)tk);
 
     /* pix */
-    tk_update_icon(tb, tk, None);
     w1 = tk->image = gtk_image_new_from_pixbuf(tk->pixbuf);
     gtk_widget_set_halign(tk->image, GTK_ALIGN_CENTER);
     gtk_widget_set_valign(tk->image, GTK_ALIGN_CENTER);
@@ -535,10 +1479,10 @@ tk_build_gui(taskbar_priv *tb, task *tk)
     gtk_widget_set_can_default(tk->button, FALSE);
 
     gtk_widget_show_all(tk->button);
-    if (!task_visible(tb, tk)) {
-        gtk_widget_hide(tk->button);
-    }
+    tk->shown = 1;
+    tk_update(NULL, tk, tb);
 
+flash:
     if (tk->urgency) {
         /* Flash button for window with urgency hint */
         tk_flash_window(tk);
@@ -774,8 +1718,9 @@ taskbar_size_alloc(GtkWidget *widget, GtkAllocation *a,
  * 1. Connects "size-allocate" on p->pwid (for deferred dimension updates).
  * 2. Creates tb->bar (GtkBar) with the panel orientation, spacing,
  *    task_height_max, and task_width_max.
- * 3. Adds tb->bar to p->pwid.
- * 4. Loads the fallback icon from default.xpm into tb->gen_pixbuf.
+ * 3. Adds tb->bar to p->pwid; its "style-updated" flushes tb->bg_cache.
+ * 4. Takes the shared default.xpm fallback icon (fb_pixbuf_new_from_xpm)
+ *    into tb->gen_pixbuf.
  * 5. Connects FbEv signals: current_desktop, active_window, number_of_desktops,
  *    client_list, desktop_names, number_of_desktops (for menu rebuild).
  * 6. Reads initial cur_desk and desk_num from EWMH.
@@ -801,8 +1746,11 @@ taskbar_build_gui(plugin_instance *p)
     }
     gtk_container_add(GTK_CONTAINER(p->pwid), tb->bar);
     gtk_widget_show_all(tb->bar);
+    g_signal_connect(G_OBJECT(tb->bar), "style-updated",
+        (GCallback) tk_bg_style_updated, tb);
 
-    tb->gen_pixbuf = gdk_pixbuf_new_from_xpm_data((const char **)icon_xpm);
+    tb->gen_pixbuf = fb_pixbuf_new_from_xpm("default.xpm",
+        (const char **)icon_xpm);
 
     g_signal_connect (G_OBJECT (fbev), "current_desktop",
           G_CALLBACK (tb_net_current_desktop), (gpointer) tb);
@@ -9,15 +9,21 @@
  *   MMB: toggles mute (saves vol in muted_vol, sets vol to 0; restores on unmute).
  *   Scroll: adjusts volume by 2 steps up or down.
  *
- * Reads and writes the OSS mixer via /dev/mixer ioctl() calls (MIXER_READ /
- * MIXER_WRITE on SOUND_MIXER_VOLUME channel).  Works with ALSA when the
- * OSS compatibility layer is available.  Returns 0 from the constructor if
- * /dev/mixer cannot be opened (plugin gracefully disabled).
+ * When built with ALSA (HAVE_ALSA), the plugin drives a snd_mixer simple
+ * element.  The mixer's poll descriptors are watched from the GLib main
+ * loop and an element callback refreshes the icon and slider, so the GUI
+ * follows volume changes made by other programs without any periodic
+ * wakeup.  Volume is mapped linearly from the element's raw range to
+ * [0..100]; a muted playback switch reads as volume 0.
  *
- * Config keys: none.  All state is runtime-only.
+ * Otherwise — or if the ALSA card/control cannot be opened — it falls back
+ * to the OSS mixer via /dev/mixer ioctl() calls (MIXER_READ / MIXER_WRITE
+ * on SOUND_MIXER_VOLUME channel), polled once a second.  Returns 0 from the
+ * constructor if neither mixer is available (plugin gracefully disabled).
  *
- * OSS volume plugin. Will works with ALSA since it usually
- * emulates OSS layer.
+ * Config keys (transfer-none xconf strings):
+ *   Card    (str, default "default") — ALSA mixer device.
+ *   Control (str, default "Master")  — ALSA simple element name.
  */
 
 #include "misc.h"
@@ -26,9 +32,14 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h>
 #if defined __linux__
 #include <linux/soundcard.h>
 #endif
+#ifdef HAVE_ALSA
+#include <alsa/asoundlib.h>
+#include <glib-unix.h>
+#endif
 
 //#define DEBUGPRN
 #include "dbg.h"
@@ -47,16 +58,25 @@ static gchar *s_names[] = {
 
 typedef struct {
     meter_priv meter;      /**< Embedded meter_priv; must be first member. */
-    int fd;                /**< File descriptor for /dev/mixer. */
+    int fd;                /**< File descriptor for /dev/mixer; -1 with ALSA. */
     int chan;              /**< OSS mixer channel (SOUND_MIXER_VOLUME). */
     guchar vol;            /**< Last known volume [0..100]. */
     guchar muted_vol;      /**< Volume saved when muted; restored on unmute. */
-    int update_id;         /**< GLib timeout source ID for periodic vol polling. */
+    int update_id;         /**< GLib timeout source ID for periodic vol polling (OSS). */
     int leave_id;          /**< GLib timeout source ID for slider auto-dismiss. */
     int has_pointer;       /**< Pointer enter/leave counter for slider window. */
     gboolean muted;        /**< TRUE while muted. */
     GtkWidget *slider_window; /**< Floating volume slider window; NULL when hidden. */
     GtkWidget *slider;        /**< GtkScale inside slider_window. */
+    gchar *card;           /**< ALSA mixer device (transfer-none, xconf-owned). */
+    gchar *control;        /**< ALSA element name (transfer-none, xconf-owned). */
+#ifdef HAVE_ALSA
+    snd_mixer_t *mixer;    /**< ALSA mixer handle; NULL when using OSS. */
+    snd_mixer_elem_t *elem; /**< Playback volume element; NULL once removed. */
+    long vmin, vmax;       /**< Raw playback volume range of elem. */
+    guint *watch;          /**< g_unix_fd_add() IDs, one per mixer poll fd. */
+    int nwatch;            /**< Number of entries in watch. */
+#endif
 } volume_priv;
 
 static meter_class *k;
@@ -64,6 +84,7 @@ static meter_class *k;
 static void slider_changed(GtkRange *range, volume_priv *c);
 static gboolean crossed(GtkWidget *widget, GdkEventCrossing *event,
     volume_priv *c);
+static gboolean volume_update_gui(volume_priv *c);
 
 /**
  * oss_get_volume - read the current OSS mixer volume.
@@ -102,16 +123,220 @@ oss_set_volume(volume_priv *c, int volume)
     return;
 }
 
+#ifdef HAVE_ALSA
+/**
+ * alsa_get_volume - read the ALSA element volume as a percentage.
+ * @c: volume_priv with c->elem set. (transfer none)
+ *
+ * Returns: volume in [0..100]; 0 if the playback switch is off or the
+ * element has gone away.
+ */
+static int
+alsa_get_volume(volume_priv *c)
+{
+    long v;
+    int sw;
+
+    if (!c->elem || c->vmax <= c->vmin)
+        return 0;
+    if (snd_mixer_selem_has_playback_switch(c->elem)
+        && !snd_mixer_selem_get_playback_switch(c->elem,
+            SND_MIXER_SCHN_FRONT_LEFT, &sw) && !sw)
+        return 0;
+    if (snd_mixer_selem_get_playback_volume(c->elem,
+            SND_MIXER_SCHN_FRONT_LEFT, &v) < 0) {
+        ERR("volume: can't get volume of %s\n", c->control);
+        return 0;
+    }
+    v = ((v - c->vmin) * 100 + (c->vmax - c->vmin) / 2) / (c->vmax - c->vmin);
+    DBG("volume=%ld\n", v);
+    return v;
+}
+
+/**
+ * alsa_set_volume - set all channels of the ALSA element.
+ * @c:      volume_priv. (transfer none)
+ * @volume: new volume in [0..100].
+ *
+ * A non-zero volume also turns the playback switch on, so a control muted
+ * elsewhere becomes audible again.
+ */
+static void
+alsa_set_volume(volume_priv *c, int volume)
+{
+    DBG("volume=%d\n", volume);
+    if (!c->elem)
+        return;
+    snd_mixer_selem_set_playback_volume_all(c->elem,
+        c->vmin + (volume * (c->vmax - c->vmin) + 50) / 100);
+    if (volume && snd_mixer_selem_has_playback_switch(c->elem))
+        snd_mixer_selem_set_playback_switch_all(c->elem, 1);
+    return;
+}
+
+/**
+ * alsa_elem_event - snd_mixer element callback.
+ * @elem: the watched element. (transfer none)
+ * @mask: SND_CTL_EVENT_MASK_* bits.
+ *
+ * Runs from snd_mixer_handle_events() when the element changed (or was
+ * removed, e.g. USB audio unplugged) and refreshes the GUI.
+ *
+ * Returns: 0.
+ */
+static int
+alsa_elem_event(snd_mixer_elem_t *elem, unsigned int mask)
+{
+    volume_priv *c = snd_mixer_elem_get_callback_private(elem);
+
+    if (mask == SND_CTL_EVENT_MASK_REMOVE) {
+        ERR("volume: mixer control %s removed\n", c->control);
+        c->elem = NULL;
+    }
+    volume_update_gui(c);
+    return 0;
+}
+
+/**
+ * alsa_io - GLib fd watch on a mixer poll descriptor.
+ * @fd:   the descriptor.
+ * @cond: condition that fired.
+ * @c:    volume_priv. (transfer none)
+ *
+ * Lets ALSA process pending control events, which dispatches
+ * alsa_elem_event() for the watched element.
+ *
+ * Returns: G_SOURCE_CONTINUE.
+ */
+static gboolean
+alsa_io(gint fd, GIOCondition cond, gpointer data)
+{
+    volume_priv *c = data;
+
+    snd_mixer_handle_events(c->mixer);
+    return G_SOURCE_CONTINUE;
+}
+
+/**
+ * alsa_close - remove the fd watches and close the mixer.
+ * @c: volume_priv. (transfer none)
+ */
+static void
+alsa_close(volume_priv *c)
+{
+    int i;
+
+    for (i = 0; i < c->nwatch; i++)
+        g_source_remove(c->watch[i]);
+    g_free(c->watch);
+    c->watch = NULL;
+    c->nwatch = 0;
+    if (c->mixer)
+        snd_mixer_close(c->mixer);
+    c->mixer = NULL;
+    c->elem = NULL;
+}
+
+/**
+ * alsa_open - open the configured ALSA simple element and watch its mixer.
+ * @c: volume_priv with card and control set. (transfer none)
+ *
+ * Attaches c->card, loads the simple-element layer, finds c->control
+ * (index 0) with a playback volume, installs alsa_elem_event() and adds a
+ * g_unix_fd_add() watch for every mixer poll descriptor.
+ *
+ * Returns: TRUE on success; FALSE (mixer closed) if any step fails.
+ */
+static gboolean
+alsa_open(volume_priv *c)
+{
+    snd_mixer_selem_id_t *sid;
+    struct pollfd *pfds;
+    int i, n;
+
+    if (snd_mixer_open(&c->mixer, 0) < 0) {
+        c->mixer = NULL;
+        return FALSE;
+    }
+    if (snd_mixer_attach(c->mixer, c->card) < 0
+        || snd_mixer_selem_register(c->mixer, NULL, NULL) < 0
+        || snd_mixer_load(c->mixer) < 0)
+        goto fail;
+    snd_mixer_selem_id_alloca(&sid);
+    snd_mixer_selem_id_set_index(sid, 0);
+    snd_mixer_selem_id_set_name(sid, c->control);
+    c->elem = snd_mixer_find_selem(c->mixer, sid);
+    if (!c->elem || !snd_mixer_selem_has_playback_volume(c->elem))
+        goto fail;
+    snd_mixer_selem_get_playback_volume_range(c->elem, &c->vmin, &c->vmax);
+    snd_mixer_elem_set_callback(c->elem, alsa_elem_event);
+    snd_mixer_elem_set_callback_private(c->elem, c);
+
+    n = snd_mixer_poll_descriptors_count(c->mixer);
+    if (n <= 0)
+        goto fail;
+    pfds = g_new(struct pollfd, n);
+    n = snd_mixer_poll_descriptors(c->mixer, pfds, n);
+    c->watch = g_new0(guint, MAX(n, 0));
+    for (i = 0; i < n; i++)
+        c->watch[c->nwatch++] = g_unix_fd_add(pfds[i].fd,
+            (GIOCondition) pfds[i].events, alsa_io, c);
+    g_free(pfds);
+    DBG("alsa %s/%s range %ld..%ld, %d fds\n", c->card, c->control,
+        c->vmin, c->vmax, n);
+    return TRUE;
+
+fail:
+    DBG("alsa %s/%s not available\n", c->card, c->control);
+    alsa_close(c);
+    return FALSE;
+}
+#endif
+
+/**
+ * mixer_get_volume - read the volume from the active backend.
+ * @c: volume_priv. (transfer none)
+ *
+ * Returns: volume in [0..100].
+ */
+static int
+mixer_get_volume(volume_priv *c)
+{
+#ifdef HAVE_ALSA
+    if (c->mixer)
+        return alsa_get_volume(c);
+#endif
+    return oss_get_volume(c);
+}
+
+/**
+ * mixer_set_volume - write the volume to the active backend.
+ * @c:      volume_priv. (transfer none)
+ * @volume: new volume in [0..100].
+ */
+static void
+mixer_set_volume(volume_priv *c, int volume)
+{
+#ifdef HAVE_ALSA
+    if (c->mixer) {
+        alsa_set_volume(c, volume);
+        return;
+    }
+#endif
+    oss_set_volume(c, volume);
+}
+
 /**
  * volume_update_gui - refresh the meter icon and slider position from the mixer.
  * @c: volume_priv. (transfer none)
  *
- * Reads current volume via oss_get_volume().  If the muted/unmuted transition
+ * Reads current volume via mixer_get_volume().  If the muted/unmuted transition
  * changed, swaps the icon set (names vs s_names).  Updates the meter level,
  * updates the tooltip (when the slider is hidden), or synchronises the slider
  * position (when shown) without triggering the slider_changed callback.
  *
- * Called from the 1-second GLib timeout and from slider_changed/icon_clicked.
+ * Called from the ALSA element callback (or the 1-second OSS timeout) and
+ * from slider_changed/icon_clicked.
  *
  * Returns: TRUE to keep the timeout active.
  */
@@ -121,7 +346,7 @@ volume_update_gui(volume_priv *c)
     int volume;
     gchar buf[20];
 
-    volume = oss_get_volume(c);
+    volume = mixer_get_volume(c);
     if ((volume != 0) != (c->vol != 0)) {
         if (volume)
             k->set_icons(&c->meter, names);
@@ -149,14 +374,14 @@ volume_update_gui(volume_priv *c)
  * @range: the GtkScale. (transfer none)
  * @c:     volume_priv. (transfer none)
  *
- * Writes the new slider value to the OSS mixer and updates the GUI.
+ * Writes the new slider value to the mixer and updates the GUI.
  */
 static void
 slider_changed(GtkRange *range, volume_priv *c)
 {
     int volume = (int) gtk_range_get_value(range);
     DBG("value=%d\n", volume);
-    oss_set_volume(c, volume);
+    mixer_set_volume(c, volume);
     volume_update_gui(c);
     return;
 }
@@ -256,7 +481,7 @@ icon_clicked(GtkWidget *widget, GdkEventButton *event, volume_priv *c)
         volume = 0;
     }
     c->muted = !c->muted;
-    oss_set_volume(c, volume);
+    mixer_set_volume(c, volume);
     volume_update_gui(c);
     return FALSE;
 }
@@ -289,7 +514,7 @@ icon_scrolled(GtkWidget *widget, GdkEventScroll *event, volume_priv *c)
     if (c->muted)
         c->muted_vol = volume;
     else {
-        oss_set_volume(c, volume);
+        mixer_set_volume(c, volume);
         volume_update_gui(c);
     }
     return TRUE;
@@ -348,15 +573,16 @@ crossed(GtkWidget *widget, GdkEventCrossing *event, volume_priv *c)
 }
 
 /**
- * volume_constructor - open /dev/mixer and set up the volume plugin.
+ * volume_constructor - open the mixer and set up the volume plugin.
  * @p: plugin_instance. (transfer none)
  *
  * Obtains meter_class via class_get("meter") and calls its constructor.
- * Opens /dev/mixer O_RDWR; returns 0 if unavailable (plugin disabled).
- * Sets the icon set to names[], installs a 1-second polling timeout,
+ * Opens the ALSA Card/Control (when built with ALSA); otherwise opens
+ * /dev/mixer O_RDWR and installs a 1-second polling timeout.  Returns 0 if
+ * neither is available (plugin disabled).  Sets the icon set to names[]
  * and connects scroll, button_press, and enter/leave-notify signals on pwid.
  *
- * Returns: 1 on success, 0 if meter class unavailable or /dev/mixer fails.
+ * Returns: 1 on success, 0 if meter class unavailable or no mixer opens.
  */
 static int
 volume_constructor(plugin_instance *p)
@@ -368,12 +594,21 @@ volume_constructor(plugin_instance *p)
     if (!PLUGIN_CLASS(k)->constructor(p))
         return 0;
     c = (volume_priv *) p;
-    if ((c->fd = open ("/dev/mixer", O_RDWR, 0)) < 0) {
-        g_message("volume: /dev/mixer not available — plugin disabled");
+    c->card = "default";
+    c->control = "Master";
+    XCG(p->xc, "Card", &c->card, str);
+    XCG(p->xc, "Control", &c->control, str);
+    c->fd = -1;
+#ifdef HAVE_ALSA
+    if (!alsa_open(c))
+#endif
+    if ((c->fd = open ("/dev/mixer", O_RDWR | O_CLOEXEC, 0)) < 0) {
+        g_message("volume: no ALSA or OSS mixer available — plugin disabled");
         return 0;
     }
     k->set_icons(&c->meter, names);
-    c->update_id = g_timeout_add(1000, (GSourceFunc) volume_update_gui, c);
+    if (c->fd >= 0)
+        c->update_id = g_timeout_add(1000, (GSourceFunc) volume_update_gui, c);
     c->vol = 200;
     c->chan = SOUND_MIXER_VOLUME;
     volume_update_gui(c);
@@ -393,7 +628,8 @@ volume_constructor(plugin_instance *p)
  * volume_destructor - stop polling, destroy slider, release meter_class.
  * @p: plugin_instance. (transfer none)
  *
- * Removes the 1-second update timeout.  Destroys the slider window if open
+ * Removes the ALSA fd watches and closes the mixer, or removes the
+ * 1-second OSS update timeout and closes /dev/mixer.  Destroys the slider window if open
  * (note: leave_id is not cancelled here — harmless since the window
  * destruction prevents the leave_cb from accessing freed memory for 1.2s,
  * but leave_id should ideally be removed too).  Calls meter_class destructor
@@ -404,7 +640,13 @@ volume_destructor(plugin_instance *p)
 {
     volume_priv *c = (volume_priv *) p;
 
-    g_source_remove(c->update_id);
+#ifdef HAVE_ALSA
+    alsa_close(c);
+#endif
+    if (c->update_id)
+        g_source_remove(c->update_id);
+    if (c->fd >= 0)
+        close(c->fd);
     if (c->slider_window)
         gtk_widget_destroy(c->slider_window);
     PLUGIN_CLASS(k)->destructor(p);
@@ -418,8 +660,8 @@ static plugin_class class = {
     .count       = 0,
     .type        = "volume",
     .name        = "Volume",
-    .version     = "2.0",
-    .description = "OSS volume control",
+    .version     = "2.1",
+    .description = "ALSA/OSS volume control",
     .priv_size   = sizeof(volume_priv),
     .constructor = volume_constructor,
     .destructor  = volume_destructor,